@@ -81,6 +81,10 @@ pub fn build(b: *std.Build) void {
         "src/sdl/sdl_image.c",
         "src/sdl/sdl_effects.c",
         "src/sdl/sdl_draw.c",
+        "src/sdl/sdl_atlas.c",
+        "src/sdl/sdl_diskcache.c",
+        "src/sdl/sdl_pack.c",
+        "src/sdl/sdl_archive.c",
         "src/sdl/sound.c",
 
         // HELPERS
@@ -355,7 +359,7 @@ pub fn build(b: *std.Build) void {
         b.getInstallStep().dependOn(&amod_install.step);
     }
 
-    // Helper tools (anicopy, convert) are built via Makefile instead of Zig
+    // Helper tools (anicopy, convert, mkpack) are built via Makefile instead of Zig
 
     const run = b.addRunArtifact(exe);
     if (b.args) |args| run.addArgs(args);
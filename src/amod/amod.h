@@ -309,6 +309,7 @@ DLL_IMPORT int sdl_scale;
 DLL_IMPORT int sdl_frames;
 DLL_IMPORT int sdl_multi;
 DLL_IMPORT int sdl_cache_size;
+DLL_IMPORT int sdl_cache_budget;
 
 // --- Game Options ---
 DLL_IMPORT uint64_t game_options;
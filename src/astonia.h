@@ -164,6 +164,8 @@ extern char *localdata;
 #define GO_LOWLIGHT   (1ull << 17) // Simplify Light calculations for slow CPUs
 #define GO_NOMAP      (1ull << 18) // Disable minimap completely
 #define GO_WHEELSPEED (1ull << 19) // Mouse wheel toggles movement speed (fast/normal/stealth)
+#define GO_HELPOUT    (1ull << 20) // Render thread decodes sprites it waits for instead of idling
+#define GO_GPULIGHT   (1ull << 21) // Apply directional map light when drawing instead of caching each combination
 
 #define GO_NOTSET (1ull << 63) // No -o given on command line
 
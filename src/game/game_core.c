@@ -175,6 +175,9 @@ void dl_play(void)
 	qsort(dlsort, (size_t)dlused, sizeof(DL *), dl_qcmp);
 	qs_time += SDL_GetTicks() - start;
 
+	// Runs of sprites on the same atlas page become one draw call, and so do
+	// the pixels and lines of the effects between them
+	render_batch_begin();
 	for (d = 0; d < dlused && !quit; d++) {
 		if (dlsort[d]->call == 0) {
 			render_sprite_fx(&dlsort[d]->renderfx, dlsort[d]->x, dlsort[d]->y - dlsort[d]->h);
@@ -218,14 +221,16 @@ void dl_play(void)
 			}
 		}
 	}
+	render_batch_end();
 
 	dlused = 0;
 }
 
 void sdl_pre_add(unsigned int sprite, signed char sink, unsigned char freeze, unsigned char scale, char cr, char cg,
-    char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl);
+    char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl,
+    int priority);
 
-void dl_prefetch(void)
+void dl_prefetch(int priority)
 {
 	void helper_add_dl(int attick, DL **dl, int dlused);
 	int d;
@@ -238,7 +243,7 @@ void dl_prefetch(void)
 			    dlsort[d]->renderfx.scale, dlsort[d]->renderfx.cr, dlsort[d]->renderfx.cg, dlsort[d]->renderfx.cb,
 			    dlsort[d]->renderfx.clight, dlsort[d]->renderfx.sat, dlsort[d]->renderfx.c1, dlsort[d]->renderfx.c2,
 			    dlsort[d]->renderfx.c3, dlsort[d]->renderfx.shine, dlsort[d]->renderfx.ml, dlsort[d]->renderfx.ll,
-			    dlsort[d]->renderfx.rl, dlsort[d]->renderfx.ul, dlsort[d]->renderfx.dl);
+			    dlsort[d]->renderfx.rl, dlsort[d]->renderfx.ul, dlsort[d]->renderfx.dl, priority);
 		}
 	}
 
@@ -16,6 +16,7 @@
 #include "game/game_private.h"
 #include "gui/gui.h"
 #include "client/client.h"
+#include "sdl/sdl.h"
 
 static int trans_x(int frx, int fry, int tox, int toy, int step, uint32_t start)
 {
@@ -1466,7 +1467,8 @@ void prefetch_game(tick_t attick)
 	set_map_values(map2, attick);
 	set_mapadd(-map2[mapmn(MAPDX / 2, MAPDY / 2)].xadd, -map2[mapmn(MAPDX / 2, MAPDY / 2)].yadd);
 	display_game_map(map2);
-	dl_prefetch();
+	// the tick just decoded is shown next if it is the only one queued
+	dl_prefetch(q_size <= 1 ? SDL_PRE_NEXT_TICK : SDL_PRE_SPECULATIVE);
 
 #ifdef TICKPRINT
 	printf("Prefetch %u\n", attick);
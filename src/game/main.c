@@ -258,11 +258,17 @@ void display_usage(void)
 	const char *help =
 	    "The Astonia Client can only be started from the command line or with a specially created shortcut.\n\n"
 	    "Usage: moac -u playername -p password -d url\n ... [-w width] [-h height]\n"
-	    " ... [-m threads] [-o options]\n ... [-k framespersecond]\n\n"
+	    " ... [-m threads] [-o options]\n ... [-k framespersecond] [-b cachebudget] [-i imagebudget]\n"
+	    " ... [-s diskcache]\n\n"
 	    "url being, for example, \"server.astonia.com\" or \"192.168.77.132\" (without the quotes).\n\n"
 	    "width and height are the desired window size. If this matches the desktop size the client "
 	    "will start in windowed borderless pseudo-fullscreen mode.\n\n"
 	    "threads is the number of background threads the game should use. Use 0 to disable. Default is 4.\n\n"
+	    "cachebudget is the memory the texture cache may use, in megabytes. Use 0 for no limit. Default is 512.\n\n"
+	    "imagebudget is the memory the decoded graphics may use, in megabytes. Use 0 for no limit. "
+	    "Default is 256.\n\n"
+	    "diskcache is the size of the file keeping processed sprites between sessions, in megabytes. "
+	    "Use 0 to disable. Default is 0.\n\n"
 	    "options is a bitfield.\nBit 0 (value of 1) enables the Dark GUI by Tegra.\n"
 	    "Bit 1 enables the context menu.\nBit 2 the new keybindings.\nBit 3 the smaller bottom GUI.\n"
 	    "Bit 4 the sliding away of the top GUI.\nBit 5 enables the bigger health/mana bars.\n"
@@ -276,6 +282,9 @@ void display_usage(void)
 	    "Bit 16 makes the sliding top bar less sensitive.\n"
 	    "Bit 17 reduces lighting effects (more performance, less pretty).\n"
 	    "Bit 18 disables the minimap.\n"
+	    "Bit 20 lets the display thread decode sprites it is waiting for itself instead of idling.\n"
+	    "Bit 21 applies the directional map light while drawing instead of keeping a texture per light "
+	    "combination (less memory, more GPU work).\n"
 	    "Default depends on screen height.\n\n"
 	    "framespersecond will set the display rate in frames per second.\n\n";
 
@@ -386,12 +395,53 @@ int parse_args(int argc, char *argv[])
 			}
 			break;
 		case 'c':
-			// Legacy flag: cache size is now statically allocated (MAX_TEXCACHE = 8000).
-			// Accept but ignore this flag for backward compatibility.
+			// Initial number of texture cache slots; the cache grows from
+			// there as long as it stays within the budget (-b)
 			if (!val && i + 1 < argc) {
 				val = argv[++i];
 			}
-			// Silently ignored - cache is compile-time fixed
+			if (val) {
+				long c = strtol(val, &end, 10);
+				if (c > 0 && c <= INT_MAX) {
+					sdl_cache_size = (int)c;
+				}
+			}
+			break;
+		case 'b':
+			// Texture cache budget in megabytes, 0 for no limit
+			if (!val && i + 1 < argc) {
+				val = argv[++i];
+			}
+			if (val) {
+				long b = strtol(val, &end, 10);
+				if (b >= 0 && b <= INT_MAX) {
+					sdl_cache_budget = (int)b;
+				}
+			}
+			break;
+		case 'i':
+			// Decoded image budget in megabytes, 0 for no limit
+			if (!val && i + 1 < argc) {
+				val = argv[++i];
+			}
+			if (val) {
+				long b = strtol(val, &end, 10);
+				if (b >= 0 && b <= INT_MAX) {
+					sdl_image_budget = (int)b;
+				}
+			}
+			break;
+		case 's':
+			// Sprite disk cache size in megabytes, 0 to disable
+			if (!val && i + 1 < argc) {
+				val = argv[++i];
+			}
+			if (val) {
+				long d = strtol(val, &end, 10);
+				if (d >= 0 && d <= 4096) {
+					sdl_disk_cache = (int)d;
+				}
+			}
 			break;
 		case 'k':
 			if (!val && i + 1 < argc) {
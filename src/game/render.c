@@ -250,7 +250,8 @@ DLL_EXPORT int render_sprite_fx(RenderFX *fx, int scrx, int scry)
 	if (fx->alpha) {
 		sdl_tex_alpha(stx, fx->alpha);
 	}
-	sdl_blit(stx, scrx, scry, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
+	sdl_blit_light(
+	    stx, fx->ml, fx->ll, fx->rl, fx->ul, fx->dl, scrx, scry, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
 	if (fx->alpha) {
 		sdl_tex_alpha(stx, 255);
 	}
@@ -263,6 +264,27 @@ DLL_EXPORT int render_sprite_fx(RenderFX *fx, int scrx, int scry)
 	return 1;
 }
 
+/**
+ * Collect sprites that sit on the same atlas page into batched geometry
+ * until render_batch_end(). Pixels, lines and filled rectangles are
+ * batched too. Drawing anything else in between must call
+ * render_batch_flush() first to keep the draw order.
+ */
+void render_batch_begin(void)
+{
+	sdl_batch_begin();
+}
+
+void render_batch_flush(void)
+{
+	sdl_batch_flush();
+}
+
+void render_batch_end(void)
+{
+	sdl_batch_end();
+}
+
 /**
  * Render a sprite with basic effects (internal helper function).
  * Simplified version of render_sprite_fx() for internal use with minimal parameters.
@@ -1522,6 +1544,14 @@ struct letter {
 static struct letter text_storage[MAXTEXTLINES * MAXTEXTLETTERS];
 struct letter *text = text_storage;
 
+// The visible lines are drawn into an offscreen target and drawn again only
+// after render_add_text(), scrolling, a font switch or when the renderer
+// lost the target. Every other frame the chat window is one blit.
+#define TEXTTARGET_MARGIN 12 // Room for glyphs reaching past the window
+
+static int text_target = -1, text_target_sy;
+static int text_dirty = 1, text_drawn_line, text_drawn_large, text_drawn_resets;
+
 unsigned short palette[256];
 
 /**
@@ -1566,23 +1596,20 @@ void render_set_textfont(int nr)
 	}
 	bzero(text, MAXTEXTLINES * MAXTEXTLETTERS * sizeof(struct letter));
 	textnextline = textdisplayline = textlines = 0;
+	text_dirty = 1;
 }
 
-/**
- * Render the chat window text.
- * Displays visible lines from the circular text buffer with color coding and links.
- */
-void render_display_text(void)
+// Draw the visible lines with the top left corner of the window at sx, sy
+static void render_text_lines(int sx, int sy)
 {
 	int n, m, rn, x, y, pos;
 	char buf[256], *bp;
 	unsigned short lastcolor = (unsigned short)-1;
 
-	for (n = textdisplayline, y = doty(DOT_TXT); y <= doty(DOT_TXT) + TEXTDISPLAY_SY - TEXTDISPLAY_DY;
-	    n++, y += TEXTDISPLAY_DY) {
+	for (n = textdisplayline, y = sy; y <= sy + TEXTDISPLAY_SY - TEXTDISPLAY_DY; n++, y += TEXTDISPLAY_DY) {
 		rn = n % MAXTEXTLINES;
 
-		x = dotx(DOT_TXT);
+		x = sx;
 		pos = rn * MAXTEXTLETTERS;
 
 		bp = buf;
@@ -1607,7 +1634,7 @@ void render_display_text(void)
 			if (text[pos].c < 32) {
 				int i;
 
-				x = ((int)text[pos].c) * 12 + dotx(DOT_TXT);
+				x = ((int)text[pos].c) * 12 + sx;
 
 				// better display for numbers
 				for (i = pos + 1; isdigit(text[i].c) || text[i].c == '-'; i++) {
@@ -1630,6 +1657,54 @@ void render_display_text(void)
 	}
 }
 
+/**
+ * Render the chat window text.
+ * Displays visible lines from the circular text buffer with color coding and links.
+ */
+void render_display_text(void)
+{
+	int large = (game_options & GO_LARGE) != 0;
+
+	if (text_target == -1 || text_target_sy != TEXTDISPLAY_SY) {
+		if (text_target != -1) {
+			sdl_destroy_render_target(text_target);
+		}
+		text_target =
+		    sdl_create_render_target(TEXTDISPLAY_SX + TEXTTARGET_MARGIN, TEXTDISPLAY_SY + TEXTTARGET_MARGIN);
+		text_target_sy = TEXTDISPLAY_SY;
+		text_dirty = 1;
+	}
+	if (text_target == -1) {
+		render_text_lines(dotx(DOT_TXT), doty(DOT_TXT));
+		return;
+	}
+
+	if (text_dirty || text_drawn_line != textdisplayline || text_drawn_large != large ||
+	    text_drawn_resets != sdl_target_resets) {
+		int old_x_offset = x_offset, old_y_offset = y_offset;
+
+		render_push_clip();
+		render_set_clip(0, 0, TEXTDISPLAY_SX + TEXTTARGET_MARGIN, TEXTDISPLAY_SY + TEXTTARGET_MARGIN);
+		x_offset = y_offset = 0;
+
+		sdl_set_render_target(text_target);
+		sdl_clear_render_target(text_target);
+		render_text_lines(0, 0);
+		sdl_set_render_target(-1);
+
+		x_offset = old_x_offset;
+		y_offset = old_y_offset;
+		render_pop_clip();
+
+		text_dirty = 0;
+		text_drawn_line = textdisplayline;
+		text_drawn_large = large;
+		text_drawn_resets = sdl_target_resets;
+	}
+
+	sdl_render_target_to_screen(text_target, dotx(DOT_TXT) + x_offset, doty(DOT_TXT) + y_offset, 255);
+}
+
 /**
  * Add a line of text to the chat window.
  * Handles word wrapping, color codes, and clickable links.
@@ -1641,6 +1716,7 @@ void render_add_text(char *ptr)
 	int x = 0, tmp;
 	char buf[256];
 
+	text_dirty = 1;
 	pos = textnextline * MAXTEXTLETTERS;
 	bzero(text + pos, sizeof(struct letter) * MAXTEXTLETTERS);
 
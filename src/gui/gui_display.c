@@ -242,6 +242,9 @@ display_graphs:;
 
 	if (display_vc) {
 		extern long long texc_miss, texc_pre; // mem_tex,
+		extern long long texc_hits[2], texc_evicts[2]; // [0] probation, [1] protected
+		extern int texc_collapsed;
+		extern long long atlas_blits, atlas_batches;
 		extern uint64_t sdl_backgnd_wait, sdl_backgnd_work, sdl_time_preload, sdl_time_load, gui_time_network;
 		extern uint64_t gui_frametime, gui_ticktime;
 		extern uint64_t sdl_time_pre1, sdl_time_pre2, sdl_time_pre3, sdl_time_mutex, sdl_time_alloc, sdl_time_make_main;
@@ -263,6 +266,20 @@ display_graphs:;
 		// MB",mem_tex/(1024.0*1024.0));
 		render_text_fmt(px, py += 10, IRGB(8, 31, 8), RENDER_TEXT_LEFT | RENDER_TEXT_FRAMED | RENDER_TEXT_NOCACHE,
 		    "Mem: %5.2f MB", (double)get_memory_usage() / (1024.0 * 1024.0));
+		// Texture cache per frame, hits and evictions by class: seen once
+		// (probation) / drawn repeatedly (protected), misses by draw / prefetch.
+		// Then the light variants currently sharing an entry, and atlas
+		// sprites drawn per frame / draw calls they took.
+		render_text_fmt(px, py += 10, IRGB(8, 31, 8), RENDER_TEXT_LEFT | RENDER_TEXT_FRAMED | RENDER_TEXT_NOCACHE,
+		    "Hit %lld/%lld", texc_hits[0], texc_hits[1]);
+		render_text_fmt(px, py += 10, IRGB(8, 31, 8), RENDER_TEXT_LEFT | RENDER_TEXT_FRAMED | RENDER_TEXT_NOCACHE,
+		    "Miss %lld/%lld", texc_miss, texc_pre);
+		render_text_fmt(px, py += 10, IRGB(8, 31, 8), RENDER_TEXT_LEFT | RENDER_TEXT_FRAMED | RENDER_TEXT_NOCACHE,
+		    "Evict %lld/%lld", texc_evicts[0], texc_evicts[1]);
+		render_text_fmt(px, py += 10, IRGB(8, 31, 8), RENDER_TEXT_LEFT | RENDER_TEXT_FRAMED | RENDER_TEXT_NOCACHE,
+		    "Shared %d", texc_collapsed);
+		render_text_fmt(px, py += 10, IRGB(8, 31, 8), RENDER_TEXT_LEFT | RENDER_TEXT_FRAMED | RENDER_TEXT_NOCACHE,
+		    "Batch %lld/%lld", atlas_blits, atlas_batches);
 
 #if 0
 	    if (pre_in>=pre_3) size=pre_in-pre_3;
@@ -444,6 +461,9 @@ display_graphs:;
 		sdl_time_alloc = 0;
 		texc_miss = 0;
 		texc_pre = 0;
+		texc_hits[0] = texc_hits[1] = 0;
+		texc_evicts[0] = texc_evicts[1] = 0;
+		atlas_blits = atlas_batches = 0;
 		sdl_time_make_main = 0;
 		gui_time_network = 0;
 #if 0
@@ -0,0 +1,449 @@
+/*
+ * Part of Astonia Client (c) Daniel Brockhaus. Please read license.txt.
+ *
+ * mkpack.exe
+ *
+ * Builds the sprite packs res/gx1.pak ... res/gx4.pak from res/gx1.zip ... res/gx4.zip plus their _patch and
+ * _mod archives. A pack holds every sprite already decoded and cropped, so the client doesn't need to inflate
+ * and decode PNGs anymore. See src/sdl/sdl_pack.h for the format.
+ *
+ * Usage: mkpack.exe [1|2|3|4] ...
+ *
+ * Without arguments all four packs are built. Needs to be run from the main folder. Existing packs are
+ * overwritten. The client ignores a pack once one of its archives changed, so run it again after updating them.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <png.h>
+#include <zip.h>
+#include <sys/stat.h>
+
+#include "../sdl/sdl_pack.h"
+
+#define MAXSPRITE 250000
+
+#define IRGBA(r, g, b, a) (((uint32_t)(a) << 24) | ((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 0))
+
+struct png_helper {
+	zip_file_t *zp;
+	unsigned char **row;
+	int xres;
+	int yres;
+	int bpp;
+
+	png_structp png_ptr;
+	png_infop info_ptr;
+};
+
+struct image {
+	uint32_t *pixel; // xres * yres * scale * scale
+	int xres, yres, xoff, yoff;
+};
+
+static void png_helper_read(png_structp ps, png_bytep buf, png_size_t len)
+{
+	zip_fread(png_get_io_ptr(ps), buf, len);
+}
+
+// Decode filename from zip, accepting the same PNGs the client does
+static int png_load_helper(struct png_helper *p, zip_t *zip, const char *filename)
+{
+	int tmp;
+
+	p->zp = zip_fopen(zip, filename, 0);
+	if (!p->zp) {
+		return -1;
+	}
+
+	p->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (!p->png_ptr) {
+		zip_fclose(p->zp);
+		return -1;
+	}
+	p->info_ptr = png_create_info_struct(p->png_ptr);
+	if (!p->info_ptr) {
+		png_destroy_read_struct(&p->png_ptr, NULL, NULL);
+		zip_fclose(p->zp);
+		return -1;
+	}
+	if (setjmp(png_jmpbuf(p->png_ptr))) {
+		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, NULL);
+		zip_fclose(p->zp);
+		return -1;
+	}
+
+	png_set_read_fn(p->png_ptr, p->zp, png_helper_read);
+	png_set_strip_16(p->png_ptr);
+	png_read_png(p->png_ptr, p->info_ptr, PNG_TRANSFORM_PACKING, NULL);
+	zip_fclose(p->zp);
+
+	p->row = png_get_rows(p->png_ptr, p->info_ptr);
+	p->xres = (int)png_get_image_width(p->png_ptr, p->info_ptr);
+	p->yres = (int)png_get_image_height(p->png_ptr, p->info_ptr);
+	tmp = (int)png_get_rowbytes(p->png_ptr, p->info_ptr);
+
+	if (tmp == p->xres * 3) {
+		p->bpp = 24;
+	} else if (tmp == p->xres * 4) {
+		p->bpp = 32;
+	} else {
+		p->bpp = 0;
+	}
+
+	if (!p->row || !p->bpp || png_get_bit_depth(p->png_ptr, p->info_ptr) != 8 ||
+	    png_get_channels(p->png_ptr, p->info_ptr) != p->bpp / 8) {
+		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, NULL);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int png_visible(struct png_helper *p, int x, int y)
+{
+	unsigned char *c = &p->row[y][x * (p->bpp / 8)];
+
+	if (p->bpp == 32 && c[3] == 0) {
+		return 0;
+	}
+	return !(c[0] == 255 && c[1] == 0 && c[2] == 255);
+}
+
+static uint32_t png_pixel(struct png_helper *p, int x, int y)
+{
+	unsigned char *c;
+	int r, g, b, a;
+
+	if (x >= p->xres || y >= p->yres) {
+		return 0;
+	}
+	c = &p->row[y][x * (p->bpp / 8)];
+	r = c[0];
+	g = c[1];
+	b = c[2];
+	a = p->bpp == 32 ? c[3] : 255;
+
+	if (r == 255 && g == 0 && b == 255) {
+		a = 0;
+	}
+	if (!a) {
+		r = g = b = 0;
+	}
+	return IRGBA(r, g, b, a);
+}
+
+// Crop the image to its visible pixels. Does what sdl_load_image_png() (scale 1) and sdl_load_image_png_() (high
+// res archives) in src/sdl/sdl_image.c do, so the client gets the same image from the pack.
+static int load_image(struct image *im, zip_t *zip, const char *filename, int scale)
+{
+	struct png_helper p;
+	int x, y, sx, sy, ex, ey, w, h;
+
+	if (png_load_helper(&p, zip, filename)) {
+		return -1;
+	}
+
+	sx = p.xres;
+	sy = p.yres;
+	ex = 0;
+	ey = 0;
+	for (y = 0; y < p.yres; y++) {
+		for (x = 0; x < p.xres; x++) {
+			if (!png_visible(&p, x, y)) {
+				continue;
+			}
+			if (x < sx) {
+				sx = x;
+			}
+			if (x > ex) {
+				ex = x;
+			}
+			if (y < sy) {
+				sy = y;
+			}
+			if (y > ey) {
+				ey = y;
+			}
+		}
+	}
+
+	if (scale > 1) {
+		// Borders on multiples of the scale, never shrinking the visible part
+		sx = (sx / scale) * scale;
+		sy = (sy / scale) * scale;
+		ex = ((ex + scale) / scale) * scale;
+		ey = ((ey + scale) / scale) * scale;
+		w = ex > sx ? ex - sx : 0;
+		h = ey > sy ? ey - sy : 0;
+	} else {
+		w = ex >= sx ? ex - sx + 1 : 0;
+		h = ey >= sy ? ey - sy + 1 : 0;
+	}
+
+	im->pixel = malloc((size_t)(w * h + 1) * sizeof(uint32_t));
+	if (!im->pixel) {
+		png_destroy_read_struct(&p.png_ptr, &p.info_ptr, NULL);
+		return -1;
+	}
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			im->pixel[x + y * w] = png_pixel(&p, sx + x, sy + y);
+		}
+	}
+
+	im->xres = w / scale;
+	im->yres = h / scale;
+	im->xoff = (int16_t)(-(p.xres / 2) + sx) / scale;
+	im->yoff = (int16_t)(-(p.yres / 2) + sy) / scale;
+
+	png_destroy_read_struct(&p.png_ptr, &p.info_ptr, NULL);
+
+	return 0;
+}
+
+// Runs of transparent and copied pixels, see PACK_RLE. Short transparent runs are copied, the run header would
+// cost more. Returns the size in bytes, or 0 if it isn't smaller than raw.
+static size_t encode_rle(const uint32_t *pixel, size_t n, uint32_t *out)
+{
+	size_t pos = 0, len = 0;
+
+	while (pos < n) {
+		size_t skip = 0, copy = 0;
+
+		while (pos + skip < n && !pixel[pos + skip]) {
+			skip++;
+		}
+		while (pos + skip + copy < n) {
+			size_t zeros = 0;
+			while (pos + skip + copy + zeros < n && !pixel[pos + skip + copy + zeros] && zeros < 3) {
+				zeros++;
+			}
+			if (zeros == 3 || (zeros && pos + skip + copy + zeros == n)) {
+				break;
+			}
+			copy += zeros ? zeros : 1;
+		}
+
+		if (len + 2 + copy >= n) {
+			return 0;
+		}
+		out[len++] = (uint32_t)skip;
+		out[len++] = (uint32_t)copy;
+		memcpy(out + len, pixel + pos + skip, copy * sizeof(uint32_t));
+		len += copy;
+		pos += skip + copy;
+	}
+
+	return len * sizeof(uint32_t);
+}
+
+static void stamp_source(struct sdl_pack_source *src, const char *name)
+{
+	struct stat st;
+
+	snprintf(src->name, sizeof(src->name), "%s", name);
+	if (stat(name, &st) == 0) {
+		src->size = (int64_t)st.st_size;
+		src->mtime = (int64_t)st.st_mtime;
+	} else {
+		src->size = -1;
+		src->mtime = 0;
+	}
+}
+
+static int make_pack(int scale)
+{
+	static unsigned char present[MAXSPRITE];
+	struct sdl_pack_header ph;
+	struct sdl_pack_entry *entry;
+	zip_t *zip[PACK_SOURCES];
+	char name[PACK_SOURCES][64], filename[64], tmpname[80];
+	uint32_t candidates = 0, *rle = NULL;
+	size_t rle_size = 0;
+	uint64_t offset;
+	FILE *fp;
+	int i, err = 0;
+
+	memset(&ph, 0, sizeof(ph));
+	ph.magic = PACK_MAGIC;
+	ph.version = PACK_VERSION;
+	ph.scale = (uint32_t)scale;
+
+	// Searched in the same order as the client does
+	snprintf(name[0], sizeof(name[0]), "res/gx%d_mod.zip", scale);
+	snprintf(name[1], sizeof(name[1]), "res/gx%d_patch.zip", scale);
+	snprintf(name[2], sizeof(name[2]), "res/gx%d.zip", scale);
+
+	memset(present, 0, sizeof(present));
+	for (i = 0; i < PACK_SOURCES; i++) {
+		stamp_source(&ph.source[i], name[i]);
+		zip[i] = zip_open(name[i], ZIP_RDONLY, NULL);
+		if (!zip[i]) {
+			continue;
+		}
+		zip_int64_t n = zip_get_num_entries(zip[i], 0);
+		for (zip_int64_t j = 0; j < n; j++) {
+			const char *zname = zip_get_name(zip[i], (zip_uint64_t)j, 0);
+			unsigned int sprite;
+			char check[32];
+
+			if (!zname || sscanf(zname, "%u.png", &sprite) != 1 || sprite >= MAXSPRITE) {
+				continue;
+			}
+			snprintf(check, sizeof(check), "%08u.png", sprite);
+			if (strcmp(check, zname) || present[sprite]) {
+				continue;
+			}
+			present[sprite] = 1;
+			candidates++;
+		}
+	}
+	if (!zip[2]) {
+		fprintf(stderr, "Cannot open %s, skipping gx%d.pak\n", name[2], scale);
+		for (i = 0; i < PACK_SOURCES; i++) {
+			if (zip[i]) {
+				zip_close(zip[i]);
+			}
+		}
+		return -1;
+	}
+
+	entry = calloc(candidates + 1, sizeof(*entry));
+	snprintf(filename, sizeof(filename), "res/gx%d.pak", scale);
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+	fp = fopen(tmpname, "wb");
+	if (!entry || !fp) {
+		fprintf(stderr, "Cannot create %s\n", tmpname);
+		free(entry);
+		if (fp) {
+			fclose(fp);
+		}
+		for (i = 0; i < PACK_SOURCES; i++) {
+			if (zip[i]) {
+				zip_close(zip[i]);
+			}
+		}
+		return -1;
+	}
+
+	// The pixel data goes after room for all candidates, entries of sprites that fail to load stay unused
+	offset = sizeof(ph) + (uint64_t)candidates * sizeof(*entry);
+	fseek(fp, (long)offset, SEEK_SET);
+
+	for (unsigned int sprite = 0; sprite < MAXSPRITE && !err; sprite++) {
+		struct sdl_pack_entry *pe = &entry[ph.count];
+		struct image im;
+		size_t n, size;
+
+		if (!present[sprite]) {
+			continue;
+		}
+		snprintf(filename, sizeof(filename), "%08u.png", sprite);
+		for (i = 0; i < PACK_SOURCES; i++) {
+			if (zip[i] && load_image(&im, zip[i], filename, scale) == 0) {
+				break;
+			}
+		}
+		if (i == PACK_SOURCES) {
+			fprintf(stderr, "Skipping %s, it cannot be loaded\n", filename);
+			continue;
+		}
+
+		n = (size_t)im.xres * (size_t)im.yres * (size_t)(scale * scale);
+		if (n > rle_size) {
+			free(rle);
+			rle_size = n;
+			rle = malloc(rle_size * sizeof(uint32_t));
+			if (!rle) {
+				fprintf(stderr, "Out of memory\n");
+				err = 1;
+				free(im.pixel);
+				break;
+			}
+		}
+
+		pe->offset = offset;
+		pe->sprite = sprite;
+		pe->xres = (uint16_t)im.xres;
+		pe->yres = (uint16_t)im.yres;
+		pe->xoff = (int16_t)im.xoff;
+		pe->yoff = (int16_t)im.yoff;
+		size = n ? encode_rle(im.pixel, n, rle) : 0;
+		if (size) {
+			pe->method = PACK_RLE;
+			err = fwrite(rle, 1, size, fp) != size;
+		} else {
+			pe->method = PACK_RAW;
+			size = n * sizeof(uint32_t);
+			err = fwrite(im.pixel, 1, size, fp) != size;
+		}
+		pe->size = (uint32_t)size;
+		offset += size;
+		ph.count++;
+
+		free(im.pixel);
+	}
+
+	fseek(fp, 0, SEEK_SET);
+	if (fwrite(&ph, sizeof(ph), 1, fp) != 1 || fwrite(entry, sizeof(*entry), ph.count, fp) != ph.count) {
+		err = 1;
+	}
+	if (fclose(fp)) {
+		err = 1;
+	}
+
+	for (i = 0; i < PACK_SOURCES; i++) {
+		if (zip[i]) {
+			zip_close(zip[i]);
+		}
+	}
+	free(entry);
+	free(rle);
+
+	snprintf(filename, sizeof(filename), "res/gx%d.pak", scale);
+	if (err) {
+		fprintf(stderr, "Error writing %s\n", tmpname);
+		remove(tmpname);
+		return -1;
+	}
+	remove(filename);
+	if (rename(tmpname, filename)) {
+		fprintf(stderr, "Cannot rename %s to %s\n", tmpname, filename);
+		return -1;
+	}
+
+	printf("%s: %u sprites, %llu bytes\n", filename, ph.count, (unsigned long long)offset);
+
+	return 0;
+}
+
+int main(int argc, char *args[])
+{
+	int n, scale, ret = 0;
+
+	if (argc == 1) {
+		for (scale = 1; scale < 5; scale++) {
+			if (make_pack(scale)) {
+				ret = 1;
+			}
+		}
+		return ret;
+	}
+
+	for (n = 1; n < argc; n++) {
+		scale = atoi(args[n]);
+		if (scale < 1 || scale > 4) {
+			printf("%s: [1|2|3|4] ...\n", args[0]);
+			return 1;
+		}
+		if (make_pack(scale)) {
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -36,10 +36,18 @@
 #define SDL_MOUM_MDOWN 6
 #define SDL_MOUM_WHEEL 7
 
+// Texture prefetch priorities (sdl_pre_add)
+#define SDL_PRE_NOW         0 // needed for the frame being drawn
+#define SDL_PRE_NEXT_TICK   1 // needed for the next tick to be displayed
+#define SDL_PRE_SPECULATIVE 2 // further ahead in the tick queue
+
 struct renderfont;
 typedef struct renderfont RenderFont;
 
 DLL_EXPORT extern int sdl_cache_size;
+DLL_EXPORT extern int sdl_cache_budget;
+DLL_EXPORT extern int sdl_image_budget;
+DLL_EXPORT extern int sdl_disk_cache;
 DLL_EXPORT extern int sdl_scale;
 DLL_EXPORT extern int sdl_frames;
 DLL_EXPORT extern int sdl_multi;
@@ -97,6 +105,11 @@ int sdlt_xres(int cache_index);
 int sdlt_yres(int cache_index);
 void sdl_blit(
     int cache_index, int sx, int sy, int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset);
+void sdl_blit_light(int cache_index, char ml, char ll, char rl, char ul, char dl, int sx, int sy, int clipsx,
+    int clipsy, int clipex, int clipey, int x_offset, int y_offset);
+void sdl_batch_begin(void);
+void sdl_batch_flush(void);
+void sdl_batch_end(void);
 int sdl_drawtext(int sx, int sy, unsigned short int color, int flags, const char *text, struct renderfont *font,
     int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset);
 // Basic drawing primitives
@@ -190,6 +203,7 @@ void sdl_destroy_render_target(int target_id);
 int sdl_set_render_target(int target_id);
 void sdl_render_target_to_screen(int target_id, int x, int y, unsigned char alpha);
 void sdl_clear_render_target(int target_id);
+extern int sdl_target_resets; // Counts the times the renderer lost the contents of all targets
 
 void sdl_flush_textinput(void);
 void sdl_dump(FILE *fp);
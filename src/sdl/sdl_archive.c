@@ -0,0 +1,296 @@
+/*
+ * Part of Astonia Client (c) Daniel Brockhaus. Please read license.txt.
+ *
+ * SDL - Shared Archive Module
+ *
+ * Reads the graphics archives (gx*.zip) without libzip. Every archive is
+ * mapped into memory once and its central directory parsed into a table at
+ * startup. All workers read from the same mapping and table, which never
+ * change after sdl_archive_init(), so no locking is needed. Each read
+ * inflates with its own z_stream on the caller's stack.
+ *
+ * Only what the graphics archives use is supported: stored and deflated
+ * entries, no encryption, no ZIP64.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#define ZLIB_CONST
+#include <zlib.h>
+#include <SDL3/SDL.h>
+
+#include "dll.h"
+#include "astonia.h"
+#include "sdl/sdl.h"
+#include "sdl/sdl_private.h"
+
+struct sdl_archive sdl_gx[2][GX_SOURCES];
+
+#define ZIP_EOCD_SIG    0x06054b50
+#define ZIP_CENTRAL_SIG 0x02014b50
+#define ZIP_LOCAL_SIG   0x04034b50
+#define ZIP_EOCD_SIZE   22
+#define ZIP_CENTRAL_LEN 46
+#define ZIP_LOCAL_LEN   30
+
+static uint16_t rd16(const unsigned char *p)
+{
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t rd32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Find the end of central directory record. It is followed by a comment of
+// at most 65535 bytes, so search backwards from the end.
+static const unsigned char *archive_eocd(const struct sdl_mapping *m)
+{
+	size_t low;
+
+	if (m->size < ZIP_EOCD_SIZE) {
+		return NULL;
+	}
+	low = m->size > ZIP_EOCD_SIZE + 65535 ? m->size - ZIP_EOCD_SIZE - 65535 : 0;
+	for (size_t pos = m->size - ZIP_EOCD_SIZE + 1; pos-- > low;) {
+		const unsigned char *p = m->data + pos;
+		if (rd32(p) == ZIP_EOCD_SIG && pos + ZIP_EOCD_SIZE + rd16(p + 20) == m->size) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+// Map filename and read its central directory. Returns 1 on success, 0 if
+// it doesn't exist or is not an archive we can read.
+int sdl_archive_open(struct sdl_archive *a, const char *filename)
+{
+	const unsigned char *eocd, *p, *end;
+	uint32_t cnt;
+
+	memset(a, 0, sizeof(*a));
+	if (!sdl_map_file(&a->map, filename)) {
+		return 0;
+	}
+
+	eocd = archive_eocd(&a->map);
+	if (!eocd) {
+		warn("%s is not a zip archive", filename);
+		sdl_unmap_file(&a->map);
+		return 0;
+	}
+	cnt = rd16(eocd + 10);
+	if (cnt == 0xffff || rd32(eocd + 16) == 0xffffffff || rd16(eocd + 4) || rd16(eocd + 6)) {
+		warn("%s: ZIP64 and multi-part archives are not supported", filename);
+		sdl_unmap_file(&a->map);
+		return 0;
+	}
+	if (rd32(eocd + 16) > (size_t)(eocd - a->map.data) ||
+	    rd32(eocd + 12) > (size_t)(eocd - a->map.data) - rd32(eocd + 16)) {
+		warn("%s: damaged central directory", filename);
+		sdl_unmap_file(&a->map);
+		return 0;
+	}
+	p = a->map.data + rd32(eocd + 16);
+	end = p + rd32(eocd + 12);
+
+	a->entry = xmalloc(cnt * sizeof(struct sdl_archive_entry), MEM_SDL_BASE);
+	if (!a->entry && cnt) {
+		sdl_unmap_file(&a->map);
+		return 0;
+	}
+
+	for (a->count = 0; a->count < cnt; a->count++) {
+		struct sdl_archive_entry *e = &a->entry[a->count];
+		size_t len;
+
+		if ((size_t)(end - p) < ZIP_CENTRAL_LEN || rd32(p) != ZIP_CENTRAL_SIG) {
+			break;
+		}
+		len = ZIP_CENTRAL_LEN + (size_t)rd16(p + 28) + rd16(p + 30) + rd16(p + 32);
+		if ((size_t)(end - p) < len) {
+			break;
+		}
+		e->flags = rd16(p + 8);
+		e->method = rd16(p + 10);
+		e->crc = rd32(p + 16);
+		e->comp_size = rd32(p + 20);
+		e->size = rd32(p + 24);
+		e->name_len = rd16(p + 28);
+		e->offset = rd32(p + 42);
+		e->name = (uint32_t)(p + ZIP_CENTRAL_LEN - a->map.data);
+		p += len;
+	}
+	if (a->count != cnt) {
+		warn("%s: damaged central directory, using %u of %u files", filename, a->count, cnt);
+	}
+
+	return 1;
+}
+
+void sdl_archive_close(struct sdl_archive *a)
+{
+	if (a->entry) {
+		xfree(a->entry);
+	}
+	sdl_unmap_file(&a->map);
+	memset(a, 0, sizeof(*a));
+}
+
+// Name of entry i, not zero terminated
+const char *sdl_archive_name(const struct sdl_archive *a, uint32_t i, int *len)
+{
+	*len = a->entry[i].name_len;
+	return (const char *)a->map.data + a->entry[i].name;
+}
+
+// Index of the entry called name, or -1. A linear search, use it for the
+// odd lookup only.
+int64_t sdl_archive_find(const struct sdl_archive *a, const char *name)
+{
+	size_t n = strlen(name);
+
+	for (uint32_t i = 0; i < a->count; i++) {
+		if (a->entry[i].name_len == n && !memcmp(a->map.data + a->entry[i].name, name, n)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Buffers for inflated entries. These are made and freed on the texture
+// workers, so they come from MALLOC() like the other worker side allocations;
+// xmalloc() keeps its statistics without a lock.
+static void *archive_alloc(size_t size)
+{
+#ifdef SDL_FAST_MALLOC
+	return MALLOC(size);
+#else
+	return xmalloc(size, MEM_TEMP);
+#endif
+}
+
+static void archive_free(void *ptr)
+{
+#ifdef SDL_FAST_MALLOC
+	FREE(ptr);
+#else
+	xfree(ptr);
+#endif
+}
+
+// Get the contents of entry i. Stored entries point into the mapping,
+// deflated ones are inflated into a buffer that sdl_archive_release() frees.
+// Returns -1 on error. Safe to call from the texture workers as long as
+// SDL_FAST_MALLOC is set, see archive_alloc().
+int sdl_archive_read(const struct sdl_archive *a, uint32_t i, struct sdl_archive_file *f)
+{
+	const struct sdl_archive_entry *e = &a->entry[i];
+	const unsigned char *lh;
+	z_stream zs;
+	size_t pos;
+	int ret;
+
+	memset(f, 0, sizeof(*f));
+
+	if (e->flags & 1) {
+		warn("archive entry %.*s is encrypted", e->name_len, a->map.data + e->name);
+		return -1;
+	}
+	if (e->offset > a->map.size || a->map.size - e->offset < ZIP_LOCAL_LEN ||
+	    rd32(lh = a->map.data + e->offset) != ZIP_LOCAL_SIG) {
+		warn("archive entry %.*s is damaged", e->name_len, a->map.data + e->name);
+		return -1;
+	}
+	pos = e->offset + ZIP_LOCAL_LEN + rd16(lh + 26) + rd16(lh + 28);
+	if (pos > a->map.size || a->map.size - pos < e->comp_size) {
+		warn("archive entry %.*s is damaged", e->name_len, a->map.data + e->name);
+		return -1;
+	}
+
+	switch (e->method) {
+	case 0: // stored
+		if (e->comp_size != e->size) {
+			warn("archive entry %.*s is damaged", e->name_len, a->map.data + e->name);
+			return -1;
+		}
+		f->data = a->map.data + pos;
+		break;
+
+	case 8: // deflated
+		f->buf = archive_alloc(e->size ? e->size : 1);
+		if (!f->buf) {
+			return -1;
+		}
+		memset(&zs, 0, sizeof(zs));
+		if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+			archive_free(f->buf);
+			f->buf = NULL;
+			return -1;
+		}
+		zs.next_in = a->map.data + pos;
+		zs.avail_in = e->comp_size;
+		zs.next_out = f->buf;
+		zs.avail_out = e->size;
+		ret = inflate(&zs, Z_FINISH);
+		inflateEnd(&zs);
+		if (ret != Z_STREAM_END || zs.total_out != e->size) {
+			warn("archive entry %.*s is damaged", e->name_len, a->map.data + e->name);
+			archive_free(f->buf);
+			f->buf = NULL;
+			return -1;
+		}
+		f->data = f->buf;
+		break;
+
+	default:
+		warn("archive entry %.*s uses unsupported method %d", e->name_len, a->map.data + e->name, e->method);
+		return -1;
+	}
+
+	if (crc32(0, f->data, e->size) != e->crc) {
+		warn("archive entry %.*s has a bad checksum", e->name_len, a->map.data + e->name);
+		sdl_archive_release(f);
+		return -1;
+	}
+	f->size = e->size;
+
+	return 0;
+}
+
+void sdl_archive_release(struct sdl_archive_file *f)
+{
+	if (f->buf) {
+		archive_free(f->buf);
+	}
+	memset(f, 0, sizeof(*f));
+}
+
+// Open the standard (gx1) and, when scaling, the high res (gx2..gx4)
+// graphics archives. Missing ones are left empty.
+void sdl_archive_init(void)
+{
+	static const char *suffix[GX_SOURCES] = {"", "_patch", "_mod"};
+	char filename[80];
+
+	for (int level = 0; level < 2; level++) {
+		if (level && (sdl_scale < 2 || sdl_scale > 4)) {
+			break;
+		}
+		for (int src = 0; src < GX_SOURCES; src++) {
+			snprintf(filename, sizeof(filename), "res/gx%d%s.zip", level ? sdl_scale : 1, suffix[src]);
+			sdl_archive_open(&sdl_gx[level][src], filename);
+		}
+	}
+}
+
+void sdl_archive_exit(void)
+{
+	for (int level = 0; level < 2; level++) {
+		for (int src = 0; src < GX_SOURCES; src++) {
+			sdl_archive_close(&sdl_gx[level][src]);
+		}
+	}
+}
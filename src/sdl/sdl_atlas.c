@@ -0,0 +1,163 @@
+/*
+ * Part of Astonia Client (c) Daniel Brockhaus. Please read license.txt.
+ *
+ * SDL - Sprite Atlas Module
+ *
+ * Shared atlas pages for small sprite textures. Each page is cut into cells
+ * of one size class, so freeing a sprite is clearing a bit and any other
+ * sprite of that class can take the cell.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+
+#include "dll.h"
+#include "astonia.h"
+#include "sdl/sdl.h"
+#include "sdl/sdl_private.h"
+
+struct sdl_atlas_page sdl_atlas[ATLAS_MAX_PAGES];
+int sdl_atlas_pages = 0;
+long long mem_atlas = 0;
+
+// Smallest cell size holding n pixels
+static int atlas_cell_size(int n)
+{
+	int size = ATLAS_MIN_CELL;
+
+	while (size < n) {
+		size <<= 1;
+	}
+	return size;
+}
+
+static int atlas_cell_count(const struct sdl_atlas_page *ap)
+{
+	return (ATLAS_PAGE_SIZE / ap->cell_w) * (ATLAS_PAGE_SIZE / ap->cell_h);
+}
+
+// Forget all pages. Like sdl_tx_init() this doesn't destroy anything,
+// see sdl_atlas_exit() for that.
+void sdl_atlas_init(void)
+{
+	for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+		sdl_atlas[i].tex = NULL;
+		sdl_atlas[i].cell_w = sdl_atlas[i].cell_h = 0;
+		sdl_atlas[i].used = 0;
+	}
+	sdl_atlas_pages = 0;
+	mem_atlas = 0;
+}
+
+void sdl_atlas_exit(void)
+{
+	for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+		if (sdl_atlas[i].tex) {
+			SDL_DestroyTexture(sdl_atlas[i].tex);
+		}
+	}
+	sdl_atlas_init();
+}
+
+// Lowest free cell of the page, or -1 if it is full
+static int atlas_find_cell(const struct sdl_atlas_page *ap)
+{
+	int cells = atlas_cell_count(ap);
+
+	if (ap->used >= cells) {
+		return -1;
+	}
+	// Bits past the last cell stay 0, but a lower one is free
+	for (int i = 0; i < (cells + 63) / 64; i++) {
+		if (ap->cells[i] != ~0ull) {
+			return i * 64 + __builtin_ctzll(~ap->cells[i]);
+		}
+	}
+	return -1;
+}
+
+// Reserve a cell for a w x h sprite. Returns the page and stores the cell
+// position in x, y, or returns ATLAS_NONE if the sprite is too large or all
+// pages of its size class are full and no page is left to start another.
+// Main thread only, like all texture calls.
+int sdl_atlas_alloc(int w, int h, uint16_t *x, uint16_t *y)
+{
+	struct sdl_atlas_page *ap;
+	int cell_w, cell_h, page, unused = ATLAS_NONE, cell = -1;
+
+	if (w <= 0 || h <= 0 || w > ATLAS_MAX_CELL || h > ATLAS_MAX_CELL) {
+		return ATLAS_NONE;
+	}
+	cell_w = atlas_cell_size(w);
+	cell_h = atlas_cell_size(h);
+
+	for (page = 0; page < ATLAS_MAX_PAGES; page++) {
+		ap = &sdl_atlas[page];
+		if (!ap->tex) {
+			if (unused == ATLAS_NONE) {
+				unused = page;
+			}
+			continue;
+		}
+		if (ap->cell_w == cell_w && ap->cell_h == cell_h && (cell = atlas_find_cell(ap)) != -1) {
+			break;
+		}
+	}
+
+	if (cell == -1) {
+		if (unused == ATLAS_NONE) {
+			return ATLAS_NONE;
+		}
+		page = unused;
+		ap = &sdl_atlas[page];
+		ap->tex = SDL_CreateTexture(
+		    sdlren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+		if (!ap->tex) {
+			warn("SDL_texture Error: %s in atlas page %d", SDL_GetError(), page);
+			return ATLAS_NONE;
+		}
+		SDL_SetTextureBlendMode(ap->tex, SDL_BLENDMODE_BLEND);
+		ap->cell_w = (uint16_t)cell_w;
+		ap->cell_h = (uint16_t)cell_h;
+		ap->used = 0;
+		memset(ap->cells, 0, sizeof(ap->cells));
+		sdl_atlas_pages++;
+		// The whole page counts against sdl_cache_budget, padding and free cells included
+		mem_atlas += (long long)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * (long long)sizeof(uint32_t);
+		__atomic_add_fetch(&mem_tex, (long long)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * (long long)sizeof(uint32_t),
+		    __ATOMIC_RELAXED);
+		cell = 0;
+	}
+
+	ap->cells[cell / 64] |= 1ull << (cell % 64);
+	ap->used++;
+
+	*x = (uint16_t)(cell % (ATLAS_PAGE_SIZE / cell_w) * cell_w);
+	*y = (uint16_t)(cell / (ATLAS_PAGE_SIZE / cell_w) * cell_h);
+
+	return page;
+}
+
+// Give back the cell at x, y. Queued geometry may still show the old
+// contents of the cell, so it is drawn before the cell can be reused.
+void sdl_atlas_free(int page, int x, int y)
+{
+	struct sdl_atlas_page *ap = &sdl_atlas[page];
+	int cell = y / ap->cell_h * (ATLAS_PAGE_SIZE / ap->cell_w) + x / ap->cell_w;
+
+	sdl_batch_flush();
+
+	ap->cells[cell / 64] &= ~(1ull << (cell % 64));
+	ap->used--;
+
+	if (!ap->used) {
+		SDL_DestroyTexture(ap->tex);
+		ap->tex = NULL;
+		sdl_atlas_pages--;
+		mem_atlas -= (long long)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * (long long)sizeof(uint32_t);
+		__atomic_sub_fetch(&mem_tex, (long long)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * (long long)sizeof(uint32_t),
+		    __ATOMIC_RELAXED);
+	}
+}
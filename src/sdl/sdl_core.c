@@ -10,7 +10,6 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <zip.h>
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_timer.h>
 #include <SDL3_mixer/SDL_mixer.h>
@@ -30,14 +29,6 @@ SDL_Renderer *sdlren = NULL;
 // Cursors
 static SDL_Cursor *curs[20];
 
-// Zip archives for graphics
-zip_t *sdl_zip1 = NULL;
-zip_t *sdl_zip2 = NULL;
-zip_t *sdl_zip1p = NULL;
-zip_t *sdl_zip2p = NULL;
-zip_t *sdl_zip1m = NULL;
-zip_t *sdl_zip2m = NULL;
-
 // Prefetch threading (shared with sdl_texture.c)
 SDL_Semaphore *prework = NULL;
 SDL_Mutex *premutex = NULL;
@@ -51,12 +42,13 @@ DLL_EXPORT int sdl_scale = 1;
 DLL_EXPORT int sdl_frames = 0;
 DLL_EXPORT int sdl_multi = 4;
 DLL_EXPORT int sdl_cache_size = 8000;
+DLL_EXPORT int sdl_cache_budget = 512;
+DLL_EXPORT int sdl_image_budget = 256;
+DLL_EXPORT int sdl_disk_cache = 0;
 DLL_EXPORT int __yres = YRES0;
 
 // Worker thread management
 
-struct zip_handles;
-struct zip_handles *worker_zips = NULL;
 SDL_AtomicInt worker_quit;
 SDL_Thread **worker_threads = NULL;
 
@@ -75,12 +67,18 @@ void sdl_dump(FILE *fp)
 	fprintf(fp, "sdl_frames: %d\n", sdl_frames);
 	fprintf(fp, "sdl_multi: %d\n", sdl_multi);
 	fprintf(fp, "sdl_cache_size: %d (max=%d)\n", sdl_cache_size, MAX_TEXCACHE);
+	fprintf(fp, "sdl_cache_budget: %d MB\n", sdl_cache_budget);
+	fprintf(fp, "sdl_image_budget: %d MB\n", sdl_image_budget);
+	fprintf(fp, "sdlt_slots: %d\n", sdlt_slots);
 
 	fprintf(fp, "mem_png: %lld\n", (long long)__atomic_load_n(&mem_png, __ATOMIC_RELAXED));
 	fprintf(fp, "mem_tex: %lld\n", (long long)__atomic_load_n(&mem_tex, __ATOMIC_RELAXED));
 	fprintf(fp, "texc_hit: %lld\n", texc_hit);
 	fprintf(fp, "texc_miss: %lld\n", texc_miss);
 	fprintf(fp, "texc_pre: %lld\n", texc_pre);
+	fprintf(fp, "texc_collapsed: %d\n", texc_collapsed);
+	fprintf(fp, "atlas pages: %d (%lld bytes)\n", sdl_atlas_pages, mem_atlas);
+	fprintf(fp, "disk cache: %d MB, %lld hits, %lld stores\n", sdl_disk_cache, dc_hits, dc_stores);
 
 	fprintf(fp, "\n");
 }
@@ -91,7 +89,6 @@ void sdl_dump(FILE *fp)
 
 int sdl_init(int width, int height, char *title, int monitor)
 {
-	int i;
 	int num_displays;
 	SDL_DisplayID *displays;
 	SDL_DisplayID display_id;
@@ -213,29 +210,8 @@ int sdl_init(int width, int height, char *title, int monitor)
 
 	SDL_SetRenderVSync(sdlren, 1);
 
-	// Initialize hash table (statically allocated)
-	for (i = 0; i < MAX_TEXHASH; i++) {
-		sdlt_cache[i] = STX_NONE;
-	}
-
-	// Initialize texture cache (statically allocated)
-	for (i = 0; i < MAX_TEXCACHE; i++) {
-		// Initialize flags atomically
-		uint16_t *flags_ptr = (uint16_t *)&sdlt[i].flags;
-		__atomic_store_n(flags_ptr, 0, __ATOMIC_RELAXED);
-		sdlt[i].prev = i - 1;
-		sdlt[i].next = i + 1;
-		sdlt[i].hnext = STX_NONE;
-		sdlt[i].hprev = STX_NONE;
-		// Initialize new fields:
-		// Generation starts at 1 (0 is reserved for "never valid for jobs")
-		sdlt[i].generation = 1;
-		sdlt[i].work_state = TX_WORK_IDLE;
-	}
-	sdlt[0].prev = STX_NONE;
-	sdlt[MAX_TEXCACHE - 1].next = STX_NONE;
-	sdlt_best = 0;
-	sdlt_last = MAX_TEXCACHE - 1;
+	// Initialize hash table and texture cache (statically allocated)
+	sdl_tx_init();
 
 	// Initialize the new texture job queue
 	tex_jobs_init();
@@ -339,28 +315,22 @@ int sdl_init(int width, int height, char *title, int monitor)
 
 	sdl_create_cursors();
 
-	sdl_zip1 = zip_open("res/gx1.zip", ZIP_RDONLY, NULL);
-	sdl_zip1p = zip_open("res/gx1_patch.zip", ZIP_RDONLY, NULL);
-	sdl_zip1m = zip_open("res/gx1_mod.zip", ZIP_RDONLY, NULL);
-
-	switch (sdl_scale) {
-	case 2:
-		sdl_zip2 = zip_open("res/gx2.zip", ZIP_RDONLY, NULL);
-		sdl_zip2p = zip_open("res/gx2_patch.zip", ZIP_RDONLY, NULL);
-		sdl_zip2m = zip_open("res/gx2_mod.zip", ZIP_RDONLY, NULL);
-		break;
-	case 3:
-		sdl_zip2 = zip_open("res/gx3.zip", ZIP_RDONLY, NULL);
-		sdl_zip2p = zip_open("res/gx3_patch.zip", ZIP_RDONLY, NULL);
-		sdl_zip2m = zip_open("res/gx3_mod.zip", ZIP_RDONLY, NULL);
-		break;
-	case 4:
-		sdl_zip2 = zip_open("res/gx4.zip", ZIP_RDONLY, NULL);
-		sdl_zip2p = zip_open("res/gx4_patch.zip", ZIP_RDONLY, NULL);
-		sdl_zip2m = zip_open("res/gx4_mod.zip", ZIP_RDONLY, NULL);
-		break;
-	default:
-		break;
+	sdl_light_init();
+	sdl_archive_init();
+	sdl_pack_init();
+	sdl_zip_index_init();
+
+	if (sdl_disk_cache > 0) {
+		char filename[MAX_PATH];
+
+		if (localdata) {
+			snprintf(filename, sizeof(filename), "%s%s", localdata, "spritecache.dat");
+		} else {
+			snprintf(filename, sizeof(filename), "%s", "bin/data/spritecache.dat");
+		}
+		if (!sdl_dc_init(filename, sdl_disk_cache)) {
+			sdl_disk_cache = 0;
+		}
 	}
 
 	if (game_options & GO_SOUND) {
@@ -407,142 +377,31 @@ int sdl_init(int width, int height, char *title, int monitor)
 		char buf[80];
 		int n;
 
-		// Allocate worker zip handles
-		worker_zips = xmalloc((size_t)sdl_multi * sizeof(struct zip_handles), MEM_SDL_BASE);
-		if (!worker_zips) {
-			fail("Out of memory for worker zip handles");
+		worker_threads = xmalloc((size_t)sdl_multi * sizeof(SDL_Thread *), MEM_SDL_BASE);
+		if (!worker_threads) {
+			fail("Out of memory for thread handles");
 			sdl_multi = 0;
 		} else {
-			// Open zip handles for each worker
+			// Create all threads
 			for (n = 0; n < sdl_multi; n++) {
-				worker_zips[n].zip1 = zip_open("res/gx1.zip", ZIP_RDONLY, NULL);
-				worker_zips[n].zip1p = zip_open("res/gx1_patch.zip", ZIP_RDONLY, NULL);
-				worker_zips[n].zip1m = zip_open("res/gx1_mod.zip", ZIP_RDONLY, NULL);
-
-				switch (sdl_scale) {
-				case 2:
-					worker_zips[n].zip2 = zip_open("res/gx2.zip", ZIP_RDONLY, NULL);
-					worker_zips[n].zip2p = zip_open("res/gx2_patch.zip", ZIP_RDONLY, NULL);
-					worker_zips[n].zip2m = zip_open("res/gx2_mod.zip", ZIP_RDONLY, NULL);
-					break;
-				case 3:
-					worker_zips[n].zip2 = zip_open("res/gx3.zip", ZIP_RDONLY, NULL);
-					worker_zips[n].zip2p = zip_open("res/gx3_patch.zip", ZIP_RDONLY, NULL);
-					worker_zips[n].zip2m = zip_open("res/gx3_mod.zip", ZIP_RDONLY, NULL);
-					break;
-				case 4:
-					worker_zips[n].zip2 = zip_open("res/gx4.zip", ZIP_RDONLY, NULL);
-					worker_zips[n].zip2p = zip_open("res/gx4_patch.zip", ZIP_RDONLY, NULL);
-					worker_zips[n].zip2m = zip_open("res/gx4_mod.zip", ZIP_RDONLY, NULL);
-					break;
-				default:
-					break;
-				}
-
-				if (!worker_zips[n].zip1) {
-					warn("Worker %d: Failed to open res/gx1.zip - aborting initialization", n);
-					// Clean up already opened zips
+				sprintf(buf, "moac background worker %d", n);
+				worker_threads[n] = SDL_CreateThread(sdl_pre_backgnd, buf, (void *)(long long)n);
+				if (!worker_threads[n]) {
+					warn("Failed to create worker thread %d", n);
+					// Signal quit and join already created threads
+					SDL_SetAtomicInt(&worker_quit, 1);
 					for (int i = 0; i < n; i++) {
-						if (worker_zips[i].zip1) {
-							zip_close(worker_zips[i].zip1);
-						}
-						if (worker_zips[i].zip1p) {
-							zip_close(worker_zips[i].zip1p);
-						}
-						if (worker_zips[i].zip1m) {
-							zip_close(worker_zips[i].zip1m);
-						}
-						if (worker_zips[i].zip2) {
-							zip_close(worker_zips[i].zip2);
-						}
-						if (worker_zips[i].zip2p) {
-							zip_close(worker_zips[i].zip2p);
-						}
-						if (worker_zips[i].zip2m) {
-							zip_close(worker_zips[i].zip2m);
+						if (worker_threads[i]) {
+							SDL_WaitThread(worker_threads[i], NULL);
 						}
 					}
-					xfree(worker_zips);
-					worker_zips = NULL;
+					// Clean up
+					xfree(worker_threads);
+					worker_threads = NULL;
 					sdl_multi = 0;
 					break;
 				}
 			}
-
-			// Only create threads if all zip handles succeeded
-			if (sdl_multi > 0) {
-				worker_threads = xmalloc((size_t)sdl_multi * sizeof(SDL_Thread *), MEM_SDL_BASE);
-				if (!worker_threads) {
-					fail("Out of memory for thread handles");
-					// Clean up zip handles
-					for (n = 0; n < sdl_multi; n++) {
-						if (worker_zips[n].zip1) {
-							zip_close(worker_zips[n].zip1);
-						}
-						if (worker_zips[n].zip1p) {
-							zip_close(worker_zips[n].zip1p);
-						}
-						if (worker_zips[n].zip1m) {
-							zip_close(worker_zips[n].zip1m);
-						}
-						if (worker_zips[n].zip2) {
-							zip_close(worker_zips[n].zip2);
-						}
-						if (worker_zips[n].zip2p) {
-							zip_close(worker_zips[n].zip2p);
-						}
-						if (worker_zips[n].zip2m) {
-							zip_close(worker_zips[n].zip2m);
-						}
-					}
-					xfree(worker_zips);
-					worker_zips = NULL;
-					sdl_multi = 0;
-				} else {
-					// Create all threads
-					for (n = 0; n < sdl_multi; n++) {
-						sprintf(buf, "moac background worker %d", n);
-						worker_threads[n] = SDL_CreateThread(sdl_pre_backgnd, buf, (void *)(long long)n);
-						if (!worker_threads[n]) {
-							warn("Failed to create worker thread %d", n);
-							// Signal quit and join already created threads
-							SDL_SetAtomicInt(&worker_quit, 1);
-							for (int i = 0; i < n; i++) {
-								if (worker_threads[i]) {
-									SDL_WaitThread(worker_threads[i], NULL);
-								}
-							}
-							// Clean up
-							xfree(worker_threads);
-							worker_threads = NULL;
-							for (int i = 0; i < sdl_multi; i++) {
-								if (worker_zips[i].zip1) {
-									zip_close(worker_zips[i].zip1);
-								}
-								if (worker_zips[i].zip1p) {
-									zip_close(worker_zips[i].zip1p);
-								}
-								if (worker_zips[i].zip1m) {
-									zip_close(worker_zips[i].zip1m);
-								}
-								if (worker_zips[i].zip2) {
-									zip_close(worker_zips[i].zip2);
-								}
-								if (worker_zips[i].zip2p) {
-									zip_close(worker_zips[i].zip2p);
-								}
-								if (worker_zips[i].zip2m) {
-									zip_close(worker_zips[i].zip2m);
-								}
-							}
-							xfree(worker_zips);
-							worker_zips = NULL;
-							sdl_multi = 0;
-							break;
-						}
-					}
-				}
-			}
 		}
 	}
 
@@ -567,6 +426,7 @@ int sdl_clear(void)
 
 int sdl_render(void)
 {
+	sdl_batch_flush();
 	SDL_RenderPresent(sdlren);
 	sdl_frames++;
 	return 1;
@@ -595,51 +455,6 @@ void sdl_exit(void)
 		worker_threads = NULL;
 	}
 
-	// Close worker zip handles
-	if (worker_zips) {
-		for (int n = 0; n < sdl_multi; n++) {
-			if (worker_zips[n].zip1) {
-				zip_close(worker_zips[n].zip1);
-			}
-			if (worker_zips[n].zip1p) {
-				zip_close(worker_zips[n].zip1p);
-			}
-			if (worker_zips[n].zip1m) {
-				zip_close(worker_zips[n].zip1m);
-			}
-			if (worker_zips[n].zip2) {
-				zip_close(worker_zips[n].zip2);
-			}
-			if (worker_zips[n].zip2p) {
-				zip_close(worker_zips[n].zip2p);
-			}
-			if (worker_zips[n].zip2m) {
-				zip_close(worker_zips[n].zip2m);
-			}
-		}
-		xfree(worker_zips);
-		worker_zips = NULL;
-	}
-
-	if (sdl_zip1) {
-		zip_close(sdl_zip1);
-	}
-	if (sdl_zip1m) {
-		zip_close(sdl_zip1m);
-	}
-	if (sdl_zip1p) {
-		zip_close(sdl_zip1p);
-	}
-	if (sdl_zip2) {
-		zip_close(sdl_zip2);
-	}
-	if (sdl_zip2m) {
-		zip_close(sdl_zip2m);
-	}
-	if (sdl_zip2p) {
-		zip_close(sdl_zip2p);
-	}
-
 	if (prework) {
 		SDL_DestroySemaphore(prework);
 		prework = NULL;
@@ -659,6 +474,12 @@ void sdl_exit(void)
 
 	// Clean up mod textures (gated behind DEVELOPER for address sanitizer)
 	sdl_cleanup_mod_textures();
+	sdl_atlas_exit();
+	sdl_text_exit();
+	sdl_particle_exit();
+	sdl_dc_exit();
+	sdl_pack_exit();
+	sdl_archive_exit();
 
 #ifdef DEVELOPER
 	sdl_dump_spritecache();
@@ -714,6 +535,10 @@ void sdl_loop(void)
 		case SDL_EVENT_MOUSE_WHEEL:
 			gui_sdl_mouseproc(event.wheel.x, event.wheel.y, SDL_MOUM_WHEEL);
 			break;
+		case SDL_EVENT_RENDER_TARGETS_RESET:
+		case SDL_EVENT_RENDER_DEVICE_RESET:
+			sdl_target_resets++;
+			break;
 		case SDL_EVENT_WINDOW_FOCUS_GAINED:
 #ifdef ENABLE_DRAGHACK
 			float x, y;
@@ -921,54 +746,9 @@ void sdl_set_cursor(int cursor)
 	SDL_SetCursor(curs[cursor]);
 }
 
-// Worker function to process jobs from the queue
-// Used in single-threaded mode (called from main thread)
-// Returns 1 if work was found and processed, 0 if queue was empty or no work
-// was done because it was called from a multi-threaded context.
-int if_single_thread_process_one_job(void)
-{
-	// This function is ONLY for single-threaded mode
-	// In multi-threaded mode, worker threads run their own loop
-	if (sdl_multi) {
-		return 0;
-	}
-
-	// Pop a job from the queue (non-blocking)
-	texture_job_t job;
-	if (!tex_jobs_pop(&job, 0)) {
-		return 0; // Queue empty
-	}
-
-	int cache_index = job.cache_index;
-	struct sdl_texture *tex = &sdlt[cache_index];
-
-	// Single-threaded: no races possible, generation check is sufficient
-	// If generation changed, the slot was evicted and reused - abandon this work
-	if (tex->generation != job.generation) {
-		return 0;
-	}
-
-	// Mark in-worker (no lock needed in single-threaded mode)
-	tex->work_state = TX_WORK_IN_WORKER;
-
-	// Do the actual work: load image and do stages 1+2
-	unsigned int sprite = tex->sprite;
-
-	if (sdl_ic_load(sprite, NULL) < 0) {
-		// Failed: mark idle and leave DIDMAKE unset
-		// Generation can't change under us in single-threaded mode.
-		return 0;
-	}
-
-	// Stage 1 + 2
-	sdl_make(tex, &sdli[sprite], 1);
-	sdl_make(tex, &sdli[sprite], 2);
-
-	return 1;
-}
-
 void sdl_pre_add(unsigned int sprite, signed char sink, unsigned char freeze, unsigned char scale, char cr, char cg,
-    char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl)
+    char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl,
+    int priority)
 {
 	Uint64 start;
 
@@ -999,55 +779,94 @@ void sdl_pre_add(unsigned int sprite, signed char sink, unsigned char freeze, un
 	// Single-threaded: do the CPU work inline
 	if (!sdl_multi) {
 		if (!(flags_load(slot) & SF_DIDMAKE)) {
-			unsigned int sprite_id = slot->sprite;
-			if (sdl_ic_load(sprite_id, NULL) >= 0) {
-				sdl_make(slot, &sdli[sprite_id], 1);
-				sdl_make(slot, &sdli[sprite_id], 2);
+			if (sdl_make_pixels(slot) >= 0) {
+				tex_ready_push(cache_index, slot->generation);
 			}
 		}
 		return;
 	}
 
-	// Multi-threaded: enqueue background job
-	SDL_LockMutex(g_tex_jobs.mutex);
-
-	// Check if already queued or in-progress
-	if (slot->work_state != TX_WORK_IDLE) {
-		SDL_UnlockMutex(g_tex_jobs.mutex);
+	// Multi-threaded: enqueue background job, unless already queued or in-progress
+	if (work_state_load(slot) != TX_WORK_IDLE) {
 		return;
 	}
 
-	// Check if queue is full
-	if (g_tex_jobs.count >= TEX_JOB_CAPACITY) {
+	// Add job to queue
+	if (!tex_jobs_push(cache_index, priority)) {
 #ifdef DEVELOPER
 		static uint64_t last_log_time = 0;
 		uint64_t now = SDL_GetTicks();
 		if (now - last_log_time > 1000) {
-			warn("Texture job queue full: capacity=%d, dropping preload for sprite %u", TEX_JOB_CAPACITY, sprite);
+			warn("Texture job queue full: capacity=%d, priority=%d, dropping preload for sprite %u",
+			    TEX_JOB_QUEUES * TEX_JOB_QUEUE_CAPACITY, priority, sprite);
 			last_log_time = now;
 		}
 #endif
-		SDL_UnlockMutex(g_tex_jobs.mutex);
 		return;
 	}
 
-	// Add job to queue
-	texture_job_t *job = &g_tex_jobs.jobs[g_tex_jobs.tail];
-	job->cache_index = cache_index;
-	job->generation = slot->generation;
-	job->kind = TEXTURE_JOB_MAKE_STAGES_1_2;
+	// Wake a worker
+	SDL_SignalSemaphore(prework);
+}
 
-	g_tex_jobs.tail = (g_tex_jobs.tail + 1) % TEX_JOB_CAPACITY;
-	g_tex_jobs.count++;
+// The render thread needs this entry now: move its job to the front.
+// If the job is still queued at a lower priority it is queued again as
+// SDL_PRE_NOW (the old copy is skipped by the worker that pops it later).
+// If no job exists - the preload was dropped because the queue was full -
+// one is created.
+void sdl_pre_promote(int cache_index)
+{
+	struct sdl_texture *slot = &sdlt[cache_index];
+	int queued = 0;
+
+	if (!sdl_multi) {
+		return;
+	}
 
-	// Mark as queued
-	slot->work_state = TX_WORK_QUEUED;
+	// A worker may finish the old job right after this check; the new copy
+	// then finds SF_DIDMAKE set and is dropped by the worker taking it.
+	if (!(flags_load(slot) & SF_DIDMAKE)) {
+		uint8_t wstate = work_state_load(slot);
+		if ((wstate == TX_WORK_QUEUED && slot->priority != SDL_PRE_NOW) || wstate == TX_WORK_IDLE) {
+			queued = tex_jobs_push(cache_index, SDL_PRE_NOW);
+		}
+	}
 
-	SDL_SignalCondition(g_tex_jobs.cond);
-	SDL_UnlockMutex(g_tex_jobs.mutex);
+	if (queued) {
+		SDL_SignalSemaphore(prework);
+	}
+}
 
-	// Wake a worker
-	SDL_SignalSemaphore(prework);
+// The render thread needs this entry now and would rather work than wait:
+// claim the job unless a worker already runs it, and do stages 1+2 here.
+// The copy still sitting in the queue goes stale (no longer TX_WORK_QUEUED).
+// Returns 1 if the work was done (or attempted) here, 0 if a worker has it.
+int sdl_pre_help(int cache_index)
+{
+	struct sdl_texture *slot = &sdlt[cache_index];
+
+	if (sdl_multi) {
+		if (flags_load(slot) & SF_DIDMAKE) {
+			return 0;
+		}
+		if (!work_state_claim(slot, TX_WORK_QUEUED, TX_WORK_IN_WORKER) &&
+		    !work_state_claim(slot, TX_WORK_IDLE, TX_WORK_IN_WORKER)) {
+			return 0;
+		}
+		// A worker may have finished it between the check and the claim
+		if (flags_load(slot) & SF_DIDMAKE) {
+			work_state_store(slot, TX_WORK_IDLE);
+			return 1;
+		}
+	}
+
+	sdl_make_pixels(slot);
+
+	if (sdl_multi) {
+		work_state_store(slot, TX_WORK_IDLE);
+	}
+
+	return 1;
 }
 
 long long sdl_time_mutex = 0;
@@ -1068,23 +887,33 @@ int sdl_pre_do(void)
 
 	start = SDL_GetTicks();
 
-	// Single-threaded: process jobs from queue (will no-op if called from multi)
-	if_single_thread_process_one_job();
+	// Give back memory if the cache grew past its byte budget
+	sdl_tx_trim();
+	sdl_ic_trim();
 
-	// Main thread: upload any textures where CPU work is done (SF_DIDMAKE) but
+	// Main thread: upload textures whose CPU work is done (SF_DIDMAKE) but
 	// GPU upload hasn't happened (!SF_DIDTEX)
 	// This is stage 3: creating the actual SDL_Texture
+	// Workers push finished entries onto g_tex_ready, so we only look at
+	// slots that actually have work instead of scanning the whole cache.
 	const int max_uploads_per_call = 64; // Safety bound to avoid stalling frame
+	int cache_index;
+	uint32_t generation;
 
-	for (int i = 0; i < MAX_TEXCACHE && uploads < max_uploads_per_call; i++) {
-		struct sdl_texture *slot = &sdlt[i];
+	while (uploads < max_uploads_per_call && tex_ready_pop(&cache_index, &generation)) {
+		struct sdl_texture *slot = &sdlt[cache_index];
+
+		// Slot was evicted and reused since the push - stale entry
+		if (slot->generation != generation) {
+			continue;
+		}
 
 		uint16_t flags = flags_load(slot);
 		if (!(flags & SF_SPRITE)) {
 			continue;
 		}
 
-		// Worker did stage 1+2, GPU upload hasn't happened yet
+		// Might already be uploaded by tex_entry_ensure_ready()
 		if ((flags & SF_DIDMAKE) && !(flags & SF_DIDTEX)) {
 			unsigned int sprite = slot->sprite;
 			sdl_make(slot, &sdli[sprite], 3);
@@ -1100,11 +929,49 @@ int sdl_pre_do(void)
 
 uint64_t sdl_backgnd_wait = 0, sdl_backgnd_work = 0, sdl_backgnd_jobs = 0;
 
+// Run one job taken from the queues.
+// Returns 1 if the job was claimed, 0 if it was stale.
+static int sdl_pre_run_job(const texture_job_t *job)
+{
+	int cache_index = job->cache_index;
+	struct sdl_texture *tex = &sdlt[cache_index];
+
+	// Check generation: if stale, skip
+	if (tex->generation != job->generation) {
+		return 0;
+	}
+
+	// Claim the slot. A promoted job leaves a stale copy in a lower priority
+	// ring; whoever takes it second finds the slot no longer queued and skips it.
+	if (!work_state_claim(tex, TX_WORK_QUEUED, TX_WORK_IN_WORKER)) {
+		return 0;
+	}
+
+	// If the slot was evicted and queued again between the generation check
+	// and the claim, we simply do the new job. The generation can't change
+	// while we hold the slot.
+	uint32_t generation = tex->generation;
+
+	// On failure leave DIDMAKE unset, allow main thread to handle fallback
+	if (!(flags_load(tex) & SF_DIDMAKE) && sdl_make_pixels(tex) >= 0) {
+		// Stages 1 + 2 done. Hand over to the main thread for stage 3. If the ready queue is
+		// full the entry is still uploaded on demand when it gets drawn.
+		tex_ready_push(cache_index, generation);
+	}
+
+	// CPU work done; GPU creation is main-thread
+	work_state_store(tex, TX_WORK_IDLE);
+	tex_jobs_notify_done(cache_index, generation);
+
+	return 1;
+}
+
 int sdl_pre_backgnd(void *ptr)
 {
 	int worker_id = (int)(long long)ptr;
-	struct zip_handles *zips = worker_zips ? &worker_zips[worker_id] : NULL;
+	texture_job_t jobs[TEX_JOB_BATCH];
 	uint64_t wait_start, work_start;
+	int n;
 
 	SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_LOW);
 
@@ -1126,56 +993,30 @@ int sdl_pre_backgnd(void *ptr)
 
 		work_start = SDL_GetTicks();
 
-		// Pop a job from the queue
-		texture_job_t job;
-		if (!tex_jobs_pop(&job, 0)) {
-			// No work found
-			continue;
-		}
-
-		int cache_index = job.cache_index;
-		struct sdl_texture *tex = &sdlt[cache_index];
-
-		// Check generation: if stale, skip
-		if (tex->generation != job.generation) {
-			continue;
-		}
-
-		// Mark in-worker
-		SDL_LockMutex(g_tex_jobs.mutex);
-		if (tex->generation != job.generation) {
-			SDL_UnlockMutex(g_tex_jobs.mutex);
-			continue;
-		}
-		tex->work_state = TX_WORK_IN_WORKER;
-		SDL_UnlockMutex(g_tex_jobs.mutex);
-
-		// Do the actual work: load image and do stages 1+2
-		unsigned int sprite = tex->sprite;
-
-		if (sdl_ic_load(sprite, zips) < 0) {
-			// Failed: leave DIDMAKE unset, allow main thread to handle fallback
-			SDL_LockMutex(g_tex_jobs.mutex);
-			if (tex->generation == job.generation) {
-				tex->work_state = TX_WORK_IDLE;
+		// Keep taking batches (own queue first, then stolen) until all queues
+		// are empty. Each push posts one wakeup, so the wakeups for jobs we
+		// took in a batch later find nothing to do and cost next to nothing.
+		while ((n = tex_jobs_take(worker_id, jobs, TEX_JOB_BATCH)) > 0) {
+			for (int i = 0; i < n; i++) {
+				// The render thread is waiting for something: do that before
+				// the rest of the batch.
+				if (i > 0 && tex_jobs_urgent()) {
+					texture_job_t urgent;
+					if (tex_jobs_take(worker_id, &urgent, 1) && sdl_pre_run_job(&urgent)) {
+						sdl_backgnd_jobs++;
+					}
+				}
+				if (sdl_pre_run_job(&jobs[i])) {
+					sdl_backgnd_jobs++;
+				}
 			}
-			SDL_UnlockMutex(g_tex_jobs.mutex);
-			continue;
-		}
 
-		// Stage 1 + 2
-		sdl_make(tex, &sdli[sprite], 1);
-		sdl_make(tex, &sdli[sprite], 2);
-
-		SDL_LockMutex(g_tex_jobs.mutex);
-		if (tex->generation == job.generation) {
-			// CPU work done; GPU creation is main-thread
-			tex->work_state = TX_WORK_IDLE;
+			if (quit || SDL_GetAtomicInt(&worker_quit)) {
+				return 0;
+			}
 		}
-		SDL_UnlockMutex(g_tex_jobs.mutex);
 
 		sdl_backgnd_work += SDL_GetTicks() - work_start;
-		sdl_backgnd_jobs++;
 	}
 
 	return 0;
@@ -0,0 +1,396 @@
+/*
+ * Part of Astonia Client (c) Daniel Brockhaus. Please read license.txt.
+ *
+ * SDL - Sprite Disk Cache Module
+ *
+ * Keeps the pixels sdl_make() built for frequently used sprite variants in a
+ * memory-mapped file, so that after a restart they don't need to be decoded
+ * and processed again.
+ *
+ * The file holds a header, an open addressing index keyed by everything
+ * sdl_make() depends on, and a ring of pixel data. New pixels are written at
+ * the head of the ring and entries the head has run over are stale. The
+ * cache is thrown away if the graphics archives changed or the client didn't
+ * shut down cleanly.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "dll.h"
+#include "astonia.h"
+#include "sdl/sdl.h"
+#include "sdl/sdl_private.h"
+
+#define DC_MAGIC   0x31435344 // "DSC1"
+#define DC_VERSION 1
+#define DC_SLOTS   32768 // Index entries, a power of two
+#define DC_PROBE   8 // Index entries searched per key
+#define DC_ADMIT   2 // Pixels are stored when a key is made this often
+#define DC_ALIGN   4096 // Start of the pixel data in the file
+
+// Everything the output of sdl_make() depends on besides the archives
+struct dc_key {
+	uint32_t sprite;
+	uint16_t c1, c2, c3, shine;
+	int16_t cr, cg, cb, light, sat;
+	int8_t sink, ml, ll, rl, ul, dl;
+	uint8_t freeze, scale, sdl_scale, lighter;
+};
+
+struct dc_entry {
+	struct dc_key key;
+	uint64_t pos; // Ring position of the pixels, see dc_header.head
+	uint32_t size; // Bytes of pixels, 0 if not stored (yet)
+	uint32_t uses; // Times the key was made, 0 for an empty entry
+	uint16_t xres, yres;
+	int16_t xoff, yoff;
+};
+
+struct dc_header {
+	uint32_t magic, version;
+	uint32_t slots;
+	uint32_t dirty; // Set while the file is open, a crash leaves it set
+	uint64_t stamp; // Sizes and times of the archives, see dc_stamp()
+	uint64_t data_size;
+	uint64_t head; // Bytes ever written to the ring, the write position is head % data_size
+	uint64_t reserved[3];
+};
+
+static unsigned char *dc_map = NULL;
+static size_t dc_map_size;
+static struct dc_header *dc_head;
+static struct dc_entry *dc_index;
+static unsigned char *dc_data;
+static SDL_Mutex *dc_mutex = NULL;
+#ifdef _WIN32
+static HANDLE dc_file = INVALID_HANDLE_VALUE;
+static HANDLE dc_mapping = NULL;
+#else
+static int dc_fd = -1;
+#endif
+
+long long dc_hits = 0, dc_stores = 0;
+
+static uint64_t dc_fnv(uint64_t h, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	for (size_t i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// Fingerprint of everything sdl_make() reads from disk. Missing files count
+// too, so adding a patch archive or a sprite pack invalidates the cache as well.
+static uint64_t dc_stamp(void)
+{
+	static const char *const files[] = {"res/gx1.zip", "res/gx1_patch.zip", "res/gx1_mod.zip", "res/gx2.zip",
+	    "res/gx2_patch.zip", "res/gx2_mod.zip", "res/gx3.zip", "res/gx3_patch.zip", "res/gx3_mod.zip", "res/gx4.zip",
+	    "res/gx4_patch.zip", "res/gx4_mod.zip", "res/gx1.pak", "res/gx2.pak", "res/gx3.pak", "res/gx4.pak",
+	    "res/config/character_variants.json",
+	    "res/config/animated_variants.json", "res/config/sprite_metadata.json"};
+	uint64_t h = 14695981039346656037ull;
+
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+		SDL_PathInfo info;
+		int64_t v[2] = {0, 0};
+
+		if (SDL_GetPathInfo(files[i], &info)) {
+			v[0] = (int64_t)info.size;
+			v[1] = (int64_t)info.modify_time;
+		}
+		h = dc_fnv(h, files[i], strlen(files[i]));
+		h = dc_fnv(h, v, sizeof(v));
+	}
+	return h;
+}
+
+static void dc_reset(uint64_t stamp, uint64_t data_size)
+{
+	memset(dc_map, 0, (size_t)((unsigned char *)dc_data - dc_map));
+	dc_head->magic = DC_MAGIC;
+	dc_head->version = DC_VERSION;
+	dc_head->slots = DC_SLOTS;
+	dc_head->stamp = stamp;
+	dc_head->data_size = data_size;
+	dc_head->head = 0;
+}
+
+static void dc_unmap(void)
+{
+#ifdef _WIN32
+	if (dc_map) {
+		FlushViewOfFile(dc_map, 0);
+		UnmapViewOfFile(dc_map);
+	}
+	if (dc_mapping) {
+		CloseHandle(dc_mapping);
+		dc_mapping = NULL;
+	}
+	if (dc_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(dc_file);
+		dc_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (dc_map) {
+		msync(dc_map, dc_map_size, MS_SYNC);
+		munmap(dc_map, dc_map_size);
+	}
+	if (dc_fd != -1) {
+		close(dc_fd);
+		dc_fd = -1;
+	}
+#endif
+	dc_map = NULL;
+}
+
+// Open (or create) the cache file with room for megabytes of pixels.
+// Returns 1 on success, 0 if the cache stays off.
+int sdl_dc_init(const char *filename, int megabytes)
+{
+	size_t index_size = sizeof(struct dc_header) + DC_SLOTS * sizeof(struct dc_entry);
+	size_t data_offset = (index_size + DC_ALIGN - 1) / DC_ALIGN * DC_ALIGN;
+	uint64_t data_size = (uint64_t)megabytes * 1024 * 1024;
+	uint64_t stamp;
+
+	if (megabytes <= 0 || dc_map) {
+		return 0;
+	}
+	dc_map_size = data_offset + (size_t)data_size;
+
+#ifdef _WIN32
+	dc_file = CreateFileA(
+	    filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (dc_file == INVALID_HANDLE_VALUE) {
+		warn("Cannot open sprite disk cache %s", filename);
+		return 0;
+	}
+	dc_mapping = CreateFileMappingA(dc_file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)dc_map_size >> 32),
+	    (DWORD)(dc_map_size & 0xffffffffu), NULL);
+	if (dc_mapping) {
+		dc_map = MapViewOfFile(dc_mapping, FILE_MAP_ALL_ACCESS, 0, 0, dc_map_size);
+	}
+#else
+	dc_fd = open(filename, O_RDWR | O_CREAT, 0644);
+	if (dc_fd == -1) {
+		warn("Cannot open sprite disk cache %s", filename);
+		return 0;
+	}
+	// One client at a time, like the share mode 0 above on Windows. A second
+	// one would reset the file under the first one's feet.
+	if (flock(dc_fd, LOCK_EX | LOCK_NB)) {
+		note("Sprite disk cache %s is in use by another client, not using it", filename);
+		close(dc_fd);
+		dc_fd = -1;
+		return 0;
+	}
+	if (ftruncate(dc_fd, (off_t)dc_map_size) == 0) {
+		dc_map = mmap(NULL, dc_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, dc_fd, 0);
+		if (dc_map == MAP_FAILED) {
+			dc_map = NULL;
+		}
+	}
+#endif
+	if (!dc_map) {
+		warn("Cannot map sprite disk cache %s (%d MB)", filename, megabytes);
+		dc_unmap();
+		return 0;
+	}
+
+	dc_mutex = SDL_CreateMutex();
+	if (!dc_mutex) {
+		dc_unmap();
+		return 0;
+	}
+
+	dc_head = (struct dc_header *)dc_map;
+	dc_index = (struct dc_entry *)(dc_map + sizeof(struct dc_header));
+	dc_data = dc_map + data_offset;
+
+	stamp = dc_stamp();
+	if (dc_head->magic != DC_MAGIC || dc_head->version != DC_VERSION || dc_head->slots != DC_SLOTS ||
+	    dc_head->dirty || dc_head->stamp != stamp || dc_head->data_size != data_size) {
+		if (dc_head->magic == DC_MAGIC) {
+			note("Sprite disk cache is outdated, starting over");
+		}
+		dc_reset(stamp, data_size);
+	}
+	dc_head->dirty = 1;
+
+	return 1;
+}
+
+void sdl_dc_exit(void)
+{
+	if (!dc_map) {
+		return;
+	}
+	dc_head->dirty = 0;
+	dc_unmap();
+	SDL_DestroyMutex(dc_mutex);
+	dc_mutex = NULL;
+}
+
+static void dc_make_key(const struct sdl_texture *st, struct dc_key *key)
+{
+	memset(key, 0, sizeof(*key));
+	key->sprite = st->sprite;
+	key->c1 = st->c1;
+	key->c2 = st->c2;
+	key->c3 = st->c3;
+	key->shine = st->shine;
+	key->cr = st->cr;
+	key->cg = st->cg;
+	key->cb = st->cb;
+	key->light = st->light;
+	key->sat = st->sat;
+	key->sink = st->sink;
+	key->ml = st->ml;
+	key->ll = st->ll;
+	key->rl = st->rl;
+	key->ul = st->ul;
+	key->dl = st->dl;
+	key->freeze = st->freeze;
+	key->scale = st->scale;
+	key->sdl_scale = (uint8_t)sdl_scale;
+	// sdl_light() brightens everything with these
+	key->lighter = (uint8_t)(((game_options & GO_LIGHTER) ? 1 : 0) | ((game_options & GO_LIGHTER2) ? 2 : 0));
+}
+
+// The pixels of e are still there unless the head went round since
+static int dc_valid(const struct dc_entry *e)
+{
+	return e->size && e->pos + dc_head->data_size >= dc_head->head;
+}
+
+// How much we'd lose by replacing e: nothing for an empty entry, little for
+// one whose pixels are gone, else its use count
+static uint64_t dc_worth(const struct dc_entry *e)
+{
+	if (!e->uses) {
+		return 0;
+	}
+	return dc_valid(e) ? (uint64_t)e->uses << 32 : e->uses;
+}
+
+// Index entry of key, or if it isn't there the entry in the probe window to
+// replace with it, see dc_worth(). Needs dc_mutex.
+static struct dc_entry *dc_slot(const struct dc_key *key, int *found)
+{
+	uint64_t h = dc_fnv(14695981039346656037ull, key, sizeof(*key));
+	struct dc_entry *victim = NULL;
+
+	for (int i = 0; i < DC_PROBE; i++) {
+		struct dc_entry *e = &dc_index[(h + (uint64_t)i) & (DC_SLOTS - 1)];
+		if (e->uses && !memcmp(&e->key, key, sizeof(*key))) {
+			*found = 1;
+			return e;
+		}
+		if (!victim || dc_worth(e) < dc_worth(victim)) {
+			victim = e;
+		}
+	}
+	*found = 0;
+	return victim;
+}
+
+// Fill st with its pixels from the disk cache instead of stages 1 and 2 of
+// sdl_make(). Returns 1 if it did. Safe to call from the workers.
+int sdl_dc_fetch(struct sdl_texture *st)
+{
+	struct dc_key key;
+	struct dc_entry *e;
+	uint32_t *pixel = NULL;
+	int found;
+
+	if (!dc_map || (flags_load(st) & SF_DIDALLOC)) {
+		return 0;
+	}
+	dc_make_key(st, &key);
+
+	SDL_LockMutex(dc_mutex);
+	e = dc_slot(&key, &found);
+	if (found && dc_valid(e)) {
+#ifdef SDL_FAST_MALLOC
+		pixel = MALLOC(e->size);
+#else
+		pixel = xmalloc(e->size, MEM_SDL_PIXEL);
+#endif
+		if (pixel) {
+			memcpy(pixel, dc_data + e->pos % dc_head->data_size, e->size);
+			st->xres = e->xres;
+			st->yres = e->yres;
+			st->xoff = e->xoff;
+			st->yoff = e->yoff;
+		}
+	}
+	SDL_UnlockMutex(dc_mutex);
+
+	if (!pixel) {
+		return 0;
+	}
+	st->pixel = pixel;
+	uint16_t *flags_ptr = (uint16_t *)&st->flags;
+	__atomic_fetch_or(flags_ptr, SF_DIDALLOC | SF_DIDMAKE, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&dc_hits, 1, __ATOMIC_RELAXED);
+
+	return 1;
+}
+
+// Count that st was made, and keep its pixels once that happened DC_ADMIT
+// times, so that sprites seen only once don't push out the others.
+// Safe to call from the workers.
+void sdl_dc_store(struct sdl_texture *st)
+{
+	struct dc_key key;
+	struct dc_entry *e;
+	uint64_t size, pos;
+	int found;
+
+	if (!dc_map || !(flags_load(st) & SF_DIDMAKE) || !st->pixel) {
+		return;
+	}
+	size = (uint64_t)st->xres * st->yres * sizeof(uint32_t) * (uint64_t)sdl_scale * (uint64_t)sdl_scale;
+	dc_make_key(st, &key);
+
+	SDL_LockMutex(dc_mutex);
+	e = dc_slot(&key, &found);
+	if (!found) {
+		memset(e, 0, sizeof(*e));
+		e->key = key;
+	}
+	if (e->uses < UINT32_MAX) {
+		e->uses++;
+	}
+	if (e->uses >= DC_ADMIT && !dc_valid(e) && size && size <= dc_head->data_size / 4) {
+		// Don't wrap inside the pixels, start over at the front instead
+		pos = dc_head->head;
+		if (pos % dc_head->data_size + size > dc_head->data_size) {
+			pos += dc_head->data_size - pos % dc_head->data_size;
+		}
+		memcpy(dc_data + pos % dc_head->data_size, st->pixel, (size_t)size);
+		dc_head->head = pos + size;
+
+		e->pos = pos;
+		e->size = (uint32_t)size;
+		e->xres = st->xres;
+		e->yres = st->yres;
+		e->xoff = st->xoff;
+		e->yoff = st->yoff;
+		__atomic_add_fetch(&dc_stores, 1, __ATOMIC_RELAXED);
+	}
+	SDL_UnlockMutex(dc_mutex);
+}
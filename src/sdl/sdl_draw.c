@@ -40,20 +40,15 @@
 // Current blend mode for rendering operations (used by all drawing functions)
 static SDL_BlendMode current_blend_mode = SDL_BLENDMODE_BLEND;
 
-static void sdl_blit_tex(
-    SDL_Texture *tex, int sx, int sy, int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset)
+// Clip a w x h texture (in texture pixels) drawn at sx, sy and work out the
+// source and destination rectangles. Returns 0 if nothing is left.
+static int sdl_blit_rects(int w, int h, int sx, int sy, int clipsx, int clipsy, int clipex, int clipey, int x_offset,
+    int y_offset, SDL_FRect *sr, SDL_FRect *dr)
 {
 	int addx = 0, addy = 0;
-	float f_dx, f_dy;
-	SDL_FRect dr, sr;
-	Uint64 start = SDL_GetTicks();
-
-	SDL_GetTextureSize(tex, &f_dx, &f_dy);
-	int dx = (int)f_dx;
-	int dy = (int)f_dy;
+	int dx = w / sdl_scale;
+	int dy = h / sdl_scale;
 
-	dx /= sdl_scale;
-	dy /= sdl_scale;
 	if (sx < clipsx) {
 		addx = clipsx - sx;
 		dx -= addx;
@@ -70,30 +65,487 @@ static void sdl_blit_tex(
 	if (sy + dy >= clipey) {
 		dy = clipey - sy;
 	}
+	if (dx <= 0 || dy <= 0) {
+		return 0;
+	}
 	dx *= sdl_scale;
 	dy *= sdl_scale;
 
-	dr.x = (float)((sx + x_offset) * sdl_scale);
-	dr.w = (float)dx;
-	dr.y = (float)((sy + y_offset) * sdl_scale);
-	dr.h = (float)dy;
+	dr->x = (float)((sx + x_offset) * sdl_scale);
+	dr->w = (float)dx;
+	dr->y = (float)((sy + y_offset) * sdl_scale);
+	dr->h = (float)dy;
 
-	sr.x = (float)(addx * sdl_scale);
-	sr.w = (float)dx;
-	sr.y = (float)(addy * sdl_scale);
-	sr.h = (float)dy;
+	sr->x = (float)(addx * sdl_scale);
+	sr->w = (float)dx;
+	sr->y = (float)(addy * sdl_scale);
+	sr->h = (float)dy;
+
+	return 1;
+}
+
+static void sdl_blit_tex(
+    SDL_Texture *tex, int sx, int sy, int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset)
+{
+	float f_dx, f_dy;
+	SDL_FRect dr, sr;
+	Uint64 start = SDL_GetTicks();
+
+	sdl_batch_flush();
+	SDL_GetTextureSize(tex, &f_dx, &f_dy);
+	if (sdl_blit_rects((int)f_dx, (int)f_dy, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset, &sr, &dr)) {
+		SDL_RenderTexture(sdlren, tex, &sr, &dr);
+	}
+
+	sdl_time_blit += (long long)(SDL_GetTicks() - start);
+}
+
+// Atlas sprites queued by sdl_blit_entry(). Consecutive quads on the same page
+// are drawn with one SDL_RenderGeometry(). Glyphs and particles are queued the
+// same way from their own atlas textures. Pixels, lines and rectangles are
+// queued as quads without a texture, grouped by the blend mode they were drawn
+// with. Outside sdl_batch_begin() and sdl_batch_end() everything is drawn
+// right away.
+static struct {
+	int active;
+	SDL_Texture *tex;
+	SDL_BlendMode blend; // Only used without a texture
+	int quads;
+	int sprites; // Atlas sprites among the quads, for atlas_batches
+	SDL_Vertex vertices[BATCH_MAX_QUADS * 4];
+	int indices[BATCH_MAX_QUADS * 6];
+} batch;
+
+long long atlas_blits = 0, atlas_batches = 0;
+
+// Start collecting atlas sprites, text and primitives. Sprites with their own
+// texture flush the batch themselves, any other drawing before sdl_batch_end()
+// must call sdl_batch_flush() first or it ends up below the queued quads.
+void sdl_batch_begin(void)
+{
+	batch.active = 1;
+}
+
+void sdl_batch_flush(void)
+{
+	if (batch.quads) {
+		if (batch.sprites) {
+			atlas_batches++;
+		}
+		if (!batch.tex) {
+			SDL_SetRenderDrawBlendMode(sdlren, batch.blend);
+		}
+		SDL_RenderGeometry(sdlren, batch.tex, batch.vertices, batch.quads * 4, batch.indices, batch.quads * 6);
+		if (!batch.tex && batch.blend != current_blend_mode) {
+			SDL_SetRenderDrawBlendMode(sdlren, current_blend_mode);
+		}
+		batch.quads = 0;
+		batch.sprites = 0;
+	}
+}
+
+void sdl_batch_end(void)
+{
+	sdl_batch_flush();
+	batch.active = 0;
+}
+
+// Queue quads drawn from tex (NULL for untextured ones). sprites is the number
+// of atlas sprites they make up, glyphs and particles are not counted.
+static void sdl_batch_add(SDL_Texture *tex, const SDL_Vertex *vertices, const int *indices, int quads, int sprites)
+{
+	if (batch.tex != tex || (!tex && batch.blend != current_blend_mode) || batch.quads + quads > BATCH_MAX_QUADS) {
+		sdl_batch_flush();
+		batch.tex = tex;
+		batch.blend = current_blend_mode;
+	}
+
+	int base = batch.quads * 4;
+	memcpy(batch.vertices + base, vertices, (size_t)quads * 4 * sizeof(SDL_Vertex));
+	for (int i = 0; i < quads * 6; i++) {
+		batch.indices[batch.quads * 6 + i] = indices[i] + base;
+	}
+	batch.quads += quads;
+	batch.sprites += sprites;
+	atlas_blits += sprites;
+
+	if (!batch.active) {
+		sdl_batch_flush();
+	}
+}
+
+// Untextured quads collected by one drawing call, handed to the batch in one
+// go by sdl_prim_done().
+static struct {
+	int quads;
+	SDL_Vertex vertices[PRIM_QUADS * 4];
+	int indices[PRIM_QUADS * 6];
+} prim;
+
+static void sdl_prim_done(void)
+{
+	if (prim.quads) {
+		sdl_batch_add(NULL, prim.vertices, prim.indices, prim.quads, 0);
+		prim.quads = 0;
+	}
+}
+
+// Queue a quad with its corners clockwise from the top left, in screen pixels
+static void sdl_prim_quad(float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3, int r, int g,
+    int b, int a)
+{
+	SDL_FColor color = {(float)r / 255.0f, (float)g / 255.0f, (float)b / 255.0f, (float)a / 255.0f};
+	SDL_Vertex *v;
+	int *ind;
+
+	if (prim.quads == PRIM_QUADS) {
+		sdl_prim_done();
+	}
+
+	v = prim.vertices + prim.quads * 4;
+	v[0].position = (SDL_FPoint){x0, y0};
+	v[1].position = (SDL_FPoint){x1, y1};
+	v[2].position = (SDL_FPoint){x2, y2};
+	v[3].position = (SDL_FPoint){x3, y3};
+	for (int i = 0; i < 4; i++) {
+		v[i].color = color;
+		v[i].tex_coord = (SDL_FPoint){0.0f, 0.0f};
+	}
+
+	ind = prim.indices + prim.quads * 6;
+	ind[0] = prim.quads * 4;
+	ind[1] = prim.quads * 4 + 1;
+	ind[2] = prim.quads * 4 + 2;
+	ind[3] = prim.quads * 4;
+	ind[4] = prim.quads * 4 + 2;
+	ind[5] = prim.quads * 4 + 3;
+	prim.quads++;
+}
+
+static void sdl_prim_rect(float x, float y, float w, float h, int r, int g, int b, int a)
+{
+	sdl_prim_quad(x, y, x + w, y, x + w, y + h, x, y + h, r, g, b, a);
+}
+
+// A line one screen pixel thick, both end pixels included like
+// SDL_RenderLine(). The quad runs through the pixel centres and is one pixel
+// thick along the minor axis, which covers the same pixels as Bresenham's
+// line up to rounding.
+static void sdl_prim_line(float fx, float fy, float tx, float ty, int r, int g, int b, int a)
+{
+	float dx = tx - fx, dy = ty - fy, s;
+
+	if (fabsf(dx) >= fabsf(dy)) {
+		if (dx < 0) {
+			sdl_prim_line(tx, ty, fx, fy, r, g, b, a);
+			return;
+		}
+		s = dx > 0 ? dy / dx : 0.0f;
+		fy += 0.5f - s * 0.5f;
+		ty += 0.5f + s * 0.5f;
+		tx += 1.0f;
+		sdl_prim_quad(fx, fy - 0.5f, tx, ty - 0.5f, tx, ty + 0.5f, fx, fy + 0.5f, r, g, b, a);
+	} else {
+		if (dy < 0) {
+			sdl_prim_line(tx, ty, fx, fy, r, g, b, a);
+			return;
+		}
+		s = dx / dy;
+		fx += 0.5f - s * 0.5f;
+		tx += 0.5f + s * 0.5f;
+		ty += 1.0f;
+		sdl_prim_quad(fx - 0.5f, fy, fx + 0.5f, fy, tx + 0.5f, ty, tx - 0.5f, ty, r, g, b, a);
+	}
+}
+
+// sdl_make() rounds the lower edges of the floor diamond down to whole
+// pixels. Moving the edges up by this much puts every pixel centre on the
+// same side of them as the rounding does.
+#define LIGHT_EDGE 0.75f
+
+// A line y = k * x + b in texture pixels, used to cut the light mesh
+struct light_line {
+	float k, b;
+};
+
+static float light_line_y(const struct light_line *l, float x)
+{
+	return l->k * x + l->b;
+}
+
+// Blend weights of ml, ll, rl, ul, dl at (x,y), as sdl_make() computes them
+// per pixel. The weights are linear inside each mesh cell, (px,py) is a point
+// inside the cell and picks the branch, so that (x,y) may lie on its border.
+static void light_weights(float x, float y, float px, float py, float *w)
+{
+	float s = (float)sdl_scale;
+
+	// Lower edges of the diamond, see LIGHT_EDGE
+	if (py < 10 * s - LIGHT_EDGE + (20 * s - fabsf(20 * s - px)) / 2) {
+		// Floor tile or top of a wall tile
+		w[1] = px / 2 < 20 * s - py ? (20 * s - y) - x / 2 : 0;
+		w[2] = px / 2 > 20 * s - py ? x / 2 - (20 * s - y) : 0;
+		w[3] = px / 2 > py ? x / 2 - y : 0;
+		w[4] = px / 2 < py ? y - x / 2 : 0;
+	} else {
+		// Lower part of a wall tile (left side and front)
+		w[1] = px < 10 * s ? 10 * s - x : 0;
+		w[2] = px > 10 * s && px < 20 * s ? x - 10 * s : 0;
+		w[4] = px >= 20 * s && px < 30 * s ? 30 * s - x : 0;
+		w[3] = px > 30 * s && px < 40 * s ? x - 30 * s : 0;
+	}
+	w[0] = 20 * s - (w[1] + w[2] + w[3] + w[4]);
+}
+
+static void light_vertex(SDL_Vertex *v, float x, float y, float px, float py, const float *factor, float alpha,
+    float tex_w, float tex_h)
+{
+	float w[5], c = 0;
+
+	light_weights(x, y, px, py, w);
+	for (int i = 0; i < 5; i++) {
+		c += factor[i] * w[i];
+	}
+	c /= 20.0f * (float)sdl_scale;
+	c = c < 0 ? 0 : (c > 1 ? 1 : c);
+
+	// Back from pixel centres to texture coordinates, see sdl_light_mesh()
+	x += 0.5f;
+	y += 0.5f;
+	v->position.x = x;
+	v->position.y = y;
+	v->color = (SDL_FColor){c, c, c, alpha};
+	v->tex_coord.x = x / tex_w;
+	v->tex_coord.y = y / tex_h;
+}
+
+// Build a mesh for the part sr of a tex_w x tex_h texture whose vertex colours
+// reproduce the directional light of sdl_make(). factor[] holds the
+// sdl_light_factor() of ml, ll, rl, ul, dl. The weights only bend along the
+// diagonals of the floor diamond, along its lower edges and at multiples of
+// 10 pixels (unscaled), so the mesh is cut there and is exact in between.
+// Positions are texture pixels. Returns the number of quads written to
+// vertices[4*n] and indices[6*n], at most LIGHT_MESH_MAX_QUADS.
+int sdl_light_mesh(const SDL_FRect *sr, float tex_w, float tex_h, const float *factor, float alpha,
+    SDL_Vertex *vertices, int *indices)
+{
+	float s = (float)sdl_scale;
+	// sdl_make() lights pixel (x,y) by its integer coordinates, the GPU
+	// interpolates at the centre (x+0.5,y+0.5). Build the mesh in pixel
+	// coordinates so that cell borders and colours land on the same pixels.
+	float x0 = sr->x - 0.5f, y0 = sr->y - 0.5f, x1 = x0 + sr->w, y1 = y0 + sr->h;
+	// Diagonals of the diamond, then its lower edges left and right of the tip
+	const struct light_line lines[4] = {
+	    {-0.5f, 20 * s}, {0.5f, 0}, {0.5f, 10 * s - LIGHT_EDGE}, {-0.5f, 30 * s - LIGHT_EDGE}};
+	float xs[24];
+	int nx = 0, quads = 0;
+
+	if (x1 <= x0 || y1 <= y0) {
+		return 0;
+	}
+
+	// Column borders: the clip rect, the band borders, where a line leaves
+	// the clip rect and where two lines cross
+	xs[nx++] = x0;
+	xs[nx++] = x1;
+	for (int i = 1; i <= 4; i++) {
+		xs[nx++] = (float)i * 10 * s;
+	}
+	for (int i = 0; i < 4; i++) {
+		xs[nx++] = (y0 - lines[i].b) / lines[i].k;
+		xs[nx++] = (y1 - lines[i].b) / lines[i].k;
+		for (int j = i + 1; j < 4; j++) {
+			if (lines[i].k * lines[j].k < 0) { // All slopes are +-1/2
+				xs[nx++] = (lines[j].b - lines[i].b) / (lines[i].k - lines[j].k);
+			}
+		}
+	}
+
+	// Insertion sort, there are only a few
+	for (int i = 1; i < nx; i++) {
+		float v = xs[i];
+		int j = i - 1;
+		while (j >= 0 && xs[j] > v) {
+			xs[j + 1] = xs[j];
+			j--;
+		}
+		xs[j + 1] = v;
+	}
+
+	for (int c = 0; c + 1 < nx; c++) {
+		float xa = xs[c], xb = xs[c + 1], xm = (xa + xb) / 2;
+		const struct light_line *cut[6];
+		const struct light_line top = {0, y0}, bottom = {0, y1};
+		int n = 0;
+
+		if (xa < x0 || xb > x1 || xb - xa < 0.01f) {
+			continue;
+		}
+
+		// The lines crossing this column, sorted top to bottom. None of them
+		// cross each other or the clip rect inside the column.
+		cut[n++] = &top;
+		for (int i = 0; i < 4; i++) {
+			float y = light_line_y(&lines[i], xm);
+			// The lower edge left of the tip only applies there, and vice versa
+			if ((i == 2 && xm > 20 * s) || (i == 3 && xm < 20 * s) || y <= y0 || y >= y1) {
+				continue;
+			}
+			int j = n;
+			while (j > 1 && light_line_y(cut[j - 1], xm) > y) {
+				cut[j] = cut[j - 1];
+				j--;
+			}
+			cut[j] = &lines[i];
+			n++;
+		}
+		cut[n++] = &bottom;
+
+		for (int i = 0; i + 1 < n && quads < LIGHT_MESH_MAX_QUADS; i++) {
+			float ym = (light_line_y(cut[i], xm) + light_line_y(cut[i + 1], xm)) / 2;
+			SDL_Vertex *v = vertices + quads * 4;
+			int *idx = indices + quads * 6;
+			int base = quads * 4;
+
+			light_vertex(v + 0, xa, light_line_y(cut[i], xa), xm, ym, factor, alpha, tex_w, tex_h);
+			light_vertex(v + 1, xb, light_line_y(cut[i], xb), xm, ym, factor, alpha, tex_w, tex_h);
+			light_vertex(v + 2, xb, light_line_y(cut[i + 1], xb), xm, ym, factor, alpha, tex_w, tex_h);
+			light_vertex(v + 3, xa, light_line_y(cut[i + 1], xa), xm, ym, factor, alpha, tex_w, tex_h);
+
+			idx[0] = base;
+			idx[1] = base + 1;
+			idx[2] = base + 2;
+			idx[3] = base;
+			idx[4] = base + 2;
+			idx[5] = base + 3;
+			quads++;
+		}
+	}
 
-	SDL_RenderTexture(sdlren, tex, &sr, &dr);
+	return quads;
+}
+
+// Blit a sprite lit by ml, ll, rl, ul, dl. If the cache entry was built with
+// these lights they are already baked in. Otherwise it holds the unlit sprite
+// (see tex_light_at_draw()) and the light is applied here: a colour modulation
+// if all five are the same, else a mesh whose vertex colours do the blending.
+// Sprites on an atlas page always go through geometry, see sdl_batch_add().
+static void sdl_blit_entry(struct sdl_texture *st, char ml, char ll, char rl, char ul, char dl, int sx, int sy,
+    int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset)
+{
+	SDL_Vertex vertices[LIGHT_MESH_MAX_QUADS * 4];
+	int indices[LIGHT_MESH_MAX_QUADS * 6];
+	float factor[5], alpha, tex_x, tex_y, tex_w, tex_h;
+	SDL_FRect sr, dr;
+	int quads;
+
+	if (!st->tex) {
+		return;
+	}
+
+	int baked = st->ml == ml && st->ll == ll && st->rl == rl && st->ul == ul && st->dl == dl;
+	int uniform = ml == ll && ml == rl && ml == ul && ml == dl;
+
+	if (st->atlas == ATLAS_NONE) {
+		if (baked) {
+			sdl_blit_tex(st->tex, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
+			return;
+		}
+		if (uniform) {
+			float f = sdl_light_factor(ml);
+			SDL_SetTextureColorModFloat(st->tex, f, f, f);
+			sdl_blit_tex(st->tex, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
+			SDL_SetTextureColorModFloat(st->tex, 1.0f, 1.0f, 1.0f);
+			return;
+		}
+	}
+
+	Uint64 start = SDL_GetTicks();
+
+	if (!sdl_blit_rects(st->xres * sdl_scale, st->yres * sdl_scale, sx, sy, clipsx, clipsy, clipex, clipey, x_offset,
+	        y_offset, &sr, &dr)) {
+		return;
+	}
+
+	// Vertex colours replace the texture's colour and alpha modulation
+	alpha = (float)st->alpha / 255.0f;
+	if (baked || uniform) {
+		float c = baked ? 1.0f : sdl_light_factor(ml);
+		for (int i = 0; i < 4; i++) {
+			vertices[i].position.x = i == 1 || i == 2 ? sr.x + sr.w : sr.x;
+			vertices[i].position.y = i >= 2 ? sr.y + sr.h : sr.y;
+			vertices[i].color = (SDL_FColor){c, c, c, alpha};
+			vertices[i].tex_coord.x = vertices[i].position.x;
+			vertices[i].tex_coord.y = vertices[i].position.y;
+		}
+		indices[0] = 0;
+		indices[1] = 1;
+		indices[2] = 2;
+		indices[3] = 0;
+		indices[4] = 2;
+		indices[5] = 3;
+		quads = 1;
+	} else {
+		factor[0] = sdl_light_factor(ml);
+		factor[1] = sdl_light_factor(ll);
+		factor[2] = sdl_light_factor(rl);
+		factor[3] = sdl_light_factor(ul);
+		factor[4] = sdl_light_factor(dl);
+		// Texture coordinates in pixels for now, scaled below
+		quads = sdl_light_mesh(&sr, 1.0f, 1.0f, factor, alpha, vertices, indices);
+	}
+
+	if (st->atlas != ATLAS_NONE) {
+		tex_x = (float)st->atlas_x;
+		tex_y = (float)st->atlas_y;
+		tex_w = tex_h = (float)ATLAS_PAGE_SIZE;
+	} else {
+		tex_x = tex_y = 0;
+		tex_w = (float)(st->xres * sdl_scale);
+		tex_h = (float)(st->yres * sdl_scale);
+	}
+	for (int i = 0; i < quads * 4; i++) {
+		vertices[i].position.x += dr.x - sr.x;
+		vertices[i].position.y += dr.y - sr.y;
+		vertices[i].tex_coord.x = (vertices[i].tex_coord.x + tex_x) / tex_w;
+		vertices[i].tex_coord.y = (vertices[i].tex_coord.y + tex_y) / tex_h;
+	}
+
+	if (st->atlas != ATLAS_NONE) {
+		sdl_batch_add(st->tex, vertices, indices, quads, 1);
+	} else if (quads) {
+		sdl_batch_flush();
+		SDL_RenderGeometry(sdlren, st->tex, vertices, quads * 4, indices, quads * 6);
+	}
 
 	sdl_time_blit += (long long)(SDL_GetTicks() - start);
 }
 
+void sdl_blit_light(int cache_index, char ml, char ll, char rl, char ul, char dl, int sx, int sy, int clipsx,
+    int clipsy, int clipex, int clipey, int x_offset, int y_offset)
+{
+	struct sdl_texture *st = &sdlt[cache_index];
+
+	// Count light variants sharing this entry (light is 0-15)
+	int uniform = ml == ll && ml == rl && ml == ul && ml == dl;
+	uint16_t seen = (uint16_t)(uniform ? 1u << (ml & 15) : 1u);
+	if (!(st->light_seen & seen)) {
+		if (st->light_seen) {
+			texc_collapsed++;
+		}
+		st->light_seen |= seen;
+	}
+
+	sdl_blit_entry(st, ml, ll, rl, ul, dl, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
+}
+
 void sdl_blit(
     int cache_index, int sx, int sy, int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset)
 {
-	if (sdlt[cache_index].tex) {
-		sdl_blit_tex(sdlt[cache_index].tex, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
-	}
+	struct sdl_texture *st = &sdlt[cache_index];
+
+	sdl_blit_entry(st, st->ml, st->ll, st->rl, st->ul, st->dl, sx, sy, clipsx, clipsy, clipex, clipey, x_offset,
+	    y_offset);
 }
 
 SDL_Texture *sdl_maketext(const char *text, struct renderfont *font, uint32_t color, int flags)
@@ -184,10 +636,213 @@ SDL_Texture *sdl_maketext(const char *text, struct renderfont *font, uint32_t co
 	return texture;
 }
 
+// All glyphs of one font variant in white on one texture. Text is drawn as
+// quads tinted with the vertex colour, so every colour shares the atlas.
+struct sdl_glyph {
+	uint16_t x, y, w, h; // Cell on the texture, w and h are multiples of sdl_scale
+};
+
+static struct sdl_glyph_atlas {
+	const struct renderfont *font;
+	SDL_Texture *tex; // NULL if the glyphs didn't fit, the font is cached per string then
+	int w, h;
+	struct sdl_glyph glyph[TEXT_GLYPHS];
+} glyph_atlas[TEXT_ATLAS_MAX];
+static int glyph_atlases = 0;
+
+// Size of the glyph rawrun draws in texture pixels, see sdl_maketext()
+static void glyph_size(const unsigned char *rawrun, int *w, int *h)
+{
+	int x = 0, y = 0;
+
+	*w = *h = 0;
+	if (!rawrun) {
+		return;
+	}
+	while (*rawrun != 255) {
+		if (*rawrun == 254) {
+			y++;
+			x = 0;
+			rawrun++;
+			continue;
+		}
+		x += *rawrun++;
+		*w = max(*w, x + 1);
+		*h = max(*h, y + 1);
+	}
+}
+
+static void glyph_draw(uint32_t *pixel, int pitch, const unsigned char *rawrun)
+{
+	uint32_t *dst = pixel;
+
+	while (*rawrun != 255) {
+		if (*rawrun == 254) {
+			pixel += pitch;
+			dst = pixel;
+			rawrun++;
+			continue;
+		}
+		dst += *rawrun++;
+		*dst = 0xffffffff;
+	}
+}
+
+// Pack the glyphs of font into rows on a new texture
+static int glyph_atlas_make(struct sdl_glyph_atlas *ga, const struct renderfont *font)
+{
+	uint32_t *pixel;
+	int x = 0, y = 0, row = 0, w, h;
+
+	ga->font = font;
+	ga->tex = NULL;
+	ga->w = 0;
+
+	for (int c = 0; c < TEXT_GLYPHS; c++) {
+		struct sdl_glyph *g = &ga->glyph[c];
+
+		glyph_size(font[c].raw, &w, &h);
+		w = (w + sdl_scale - 1) / sdl_scale * sdl_scale;
+		h = (h + sdl_scale - 1) / sdl_scale * sdl_scale;
+		if (x + w > ATLAS_PAGE_SIZE) {
+			x = 0;
+			y += row + 1;
+			row = 0;
+		}
+		g->x = (uint16_t)x;
+		g->y = (uint16_t)y;
+		g->w = (uint16_t)w;
+		g->h = (uint16_t)h;
+		x += w + 1;
+		row = max(row, h);
+		ga->w = max(ga->w, x);
+	}
+	ga->h = y + row;
+	if (ga->w < 1 || ga->h < 1 || ga->h > ATLAS_PAGE_SIZE) {
+		return 0;
+	}
+
+#ifdef SDL_FAST_MALLOC
+	pixel = CALLOC((size_t)ga->w * (size_t)ga->h, sizeof(uint32_t));
+#else
+	pixel = xmalloc((int)((size_t)ga->w * (size_t)ga->h * sizeof(uint32_t)), MEM_SDL_PIXEL2);
+#endif
+	if (!pixel) {
+		return 0;
+	}
+	for (int c = 0; c < TEXT_GLYPHS; c++) {
+		if (ga->glyph[c].w) {
+			glyph_draw(pixel + ga->glyph[c].x + ga->glyph[c].y * ga->w, ga->w, font[c].raw);
+		}
+	}
+
+	ga->tex = SDL_CreateTexture(sdlren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, ga->w, ga->h);
+	if (ga->tex) {
+		SDL_UpdateTexture(ga->tex, NULL, pixel, (int)((size_t)ga->w * sizeof(uint32_t)));
+		SDL_SetTextureBlendMode(ga->tex, SDL_BLENDMODE_BLEND);
+	} else {
+		warn("SDL_texture Error: %s in glyph atlas", SDL_GetError());
+	}
+#ifdef SDL_FAST_MALLOC
+	FREE(pixel);
+#else
+	xfree(pixel);
+#endif
+
+	return ga->tex != NULL;
+}
+
+// The glyph atlas of font, made on first use. NULL if there is none.
+static struct sdl_glyph_atlas *glyph_atlas_get(const struct renderfont *font)
+{
+	static struct sdl_glyph_atlas *last = NULL;
+
+	if (last && last->font == font) {
+		return last->tex ? last : NULL;
+	}
+	for (int i = 0; i < glyph_atlases; i++) {
+		if (glyph_atlas[i].font == font) {
+			last = &glyph_atlas[i];
+			return last->tex ? last : NULL;
+		}
+	}
+	if (glyph_atlases == TEXT_ATLAS_MAX) {
+		return NULL;
+	}
+	last = &glyph_atlas[glyph_atlases++];
+	return glyph_atlas_make(last, font) ? last : NULL;
+}
+
+void sdl_text_exit(void)
+{
+	for (int i = 0; i < glyph_atlases; i++) {
+		if (glyph_atlas[i].tex) {
+			SDL_DestroyTexture(glyph_atlas[i].tex);
+		}
+	}
+	memset(glyph_atlas, 0, sizeof(glyph_atlas));
+	glyph_atlases = 0;
+}
+
+// Draw text as glyph quads, handed to the batch TEXT_QUADS at a time. No
+// allocation once the atlas is made. Returns 0 if the font has no atlas.
+static int sdl_drawtext_glyphs(int sx, int sy, int r, int g, int b, const char *text, const struct renderfont *font,
+    int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset)
+{
+	SDL_Vertex vertices[TEXT_QUADS * 4];
+	int indices[TEXT_QUADS * 6];
+	SDL_FColor color = {(float)r / 255.0f, (float)g / 255.0f, (float)b / 255.0f, 1.0f};
+	struct sdl_glyph_atlas *ga;
+	SDL_FRect sr, dr;
+	int quads = 0;
+	Uint64 start = SDL_GetTicks();
+
+	if (!(ga = glyph_atlas_get(font))) {
+		return 0;
+	}
+
+	for (const char *c = text; *c && *c != RENDER_TEXT_TERMINATOR; c++) {
+		if (*c < 0) {
+			continue;
+		}
+		const struct sdl_glyph *gl = &ga->glyph[(unsigned char)*c];
+
+		if (gl->w &&
+		    sdl_blit_rects(gl->w, gl->h, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset, &sr, &dr)) {
+			SDL_Vertex *v = vertices + quads * 4;
+			float u0 = (gl->x + sr.x) / (float)ga->w, u1 = (gl->x + sr.x + sr.w) / (float)ga->w;
+			float v0 = (gl->y + sr.y) / (float)ga->h, v1 = (gl->y + sr.y + sr.h) / (float)ga->h;
+
+			v[0] = (SDL_Vertex){{dr.x, dr.y}, color, {u0, v0}};
+			v[1] = (SDL_Vertex){{dr.x + dr.w, dr.y}, color, {u1, v0}};
+			v[2] = (SDL_Vertex){{dr.x + dr.w, dr.y + dr.h}, color, {u1, v1}};
+			v[3] = (SDL_Vertex){{dr.x, dr.y + dr.h}, color, {u0, v1}};
+			indices[quads * 6 + 0] = quads * 4 + 0;
+			indices[quads * 6 + 1] = quads * 4 + 1;
+			indices[quads * 6 + 2] = quads * 4 + 2;
+			indices[quads * 6 + 3] = quads * 4 + 0;
+			indices[quads * 6 + 4] = quads * 4 + 2;
+			indices[quads * 6 + 5] = quads * 4 + 3;
+			if (++quads == TEXT_QUADS) {
+				sdl_batch_add(ga->tex, vertices, indices, quads, 0);
+				quads = 0;
+			}
+		}
+		sx += font[(unsigned char)*c].dim;
+	}
+	if (quads) {
+		sdl_batch_add(ga->tex, vertices, indices, quads, 0);
+	}
+
+	sdl_time_blit += (long long)(SDL_GetTicks() - start);
+
+	return 1;
+}
+
 int sdl_drawtext(int sx, int sy, unsigned short int color, int flags, const char *text, struct renderfont *font,
     int clipsx, int clipsy, int clipex, int clipey, int x_offset, int y_offset)
 {
-	int dx, cache_index;
+	int dx, len, cache_index;
 	SDL_Texture *tex;
 	int r, g, b, a;
 	const char *c;
@@ -201,6 +856,26 @@ int sdl_drawtext(int sx, int sy, unsigned short int color, int flags, const char
 	b = B16TO32(color);
 	a = 255;
 
+	for (dx = 0, c = text; *c; c++) {
+		dx += font[(unsigned char)*c].dim;
+	}
+	for (len = 0; text[len] && text[len] != RENDER_TEXT_TERMINATOR;) {
+		len++;
+	}
+
+	if (flags & RENDER_ALIGN_CENTER) {
+		sx -= dx / 2;
+	} else if (flags & RENDER_TEXT_RIGHT) {
+		sx -= dx;
+	}
+
+	// Long strings that stay on screen are cheaper as one cached texture,
+	// the rest is drawn from the glyph atlas without making anything
+	if (((flags & RENDER_TEXT_NOCACHE) || len < TEXT_CACHE_LEN) &&
+	    sdl_drawtext_glyphs(sx, sy, r, g, b, text, font, clipsx, clipsy, clipex, clipey, x_offset, y_offset)) {
+		return sx + dx;
+	}
+
 	if (flags & RENDER_TEXT_NOCACHE) {
 		tex = sdl_maketext(text, font, (uint32_t)IRGBA(r, g, b, a), flags);
 	} else {
@@ -209,17 +884,7 @@ int sdl_drawtext(int sx, int sy, unsigned short int color, int flags, const char
 		tex = sdlt[cache_index].tex;
 	}
 
-	for (dx = 0, c = text; *c; c++) {
-		dx += font[(unsigned char)*c].dim;
-	}
-
 	if (tex) {
-		if (flags & RENDER_ALIGN_CENTER) {
-			sx -= dx / 2;
-		} else if (flags & RENDER_TEXT_RIGHT) {
-			sx -= dx;
-		}
-
 		sdl_blit_tex(tex, sx, sy, clipsx, clipsy, clipex, clipey, x_offset, y_offset);
 
 		if (flags & RENDER_TEXT_NOCACHE) {
@@ -263,8 +928,8 @@ void sdl_rect(int sx, int sy, int ex, int ey, unsigned short int color, int clip
 	rc.y = (float)((sy + y_offset) * sdl_scale);
 	rc.h = (float)((ey - sy) * sdl_scale);
 
-	SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)a);
-	SDL_RenderFillRect(sdlren, &rc);
+	sdl_prim_rect(rc.x, rc.y, rc.w, rc.h, r, g, b, a);
+	sdl_prim_done();
 }
 
 void sdl_shaded_rect(int sx, int sy, int ex, int ey, unsigned short int color, unsigned short alpha, int clipsx,
@@ -300,262 +965,93 @@ void sdl_shaded_rect(int sx, int sy, int ex, int ey, unsigned short int color, u
 	rc.y = (float)((sy + y_offset) * sdl_scale);
 	rc.h = (float)((ey - sy) * sdl_scale);
 
-	SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)a);
-	SDL_SetRenderDrawBlendMode(sdlren, current_blend_mode);
-	SDL_RenderFillRect(sdlren, &rc);
+	sdl_prim_rect(rc.x, rc.y, rc.w, rc.h, r, g, b, a);
+	sdl_prim_done();
 }
 
 void sdl_pixel(int x, int y, unsigned short color, int x_offset, int y_offset)
 {
-	int r, g, b, a, i;
-	SDL_FPoint pt[16];
+	int r, g, b, a;
 
 	r = R16TO32(color);
 	g = G16TO32(color);
 	b = B16TO32(color);
 	a = 255;
 
-	SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)a);
-	switch (sdl_scale) {
-	case 1:
-		SDL_RenderPoint(sdlren, (float)(x + x_offset), (float)(y + y_offset));
-		return;
-	case 2:
-		pt[0].x = (float)((x + x_offset) * sdl_scale);
-		pt[0].y = (float)((y + y_offset) * sdl_scale);
-		pt[1].x = pt[0].x + 1.0f;
-		pt[1].y = pt[0].y;
-		pt[2].x = pt[0].x;
-		pt[2].y = pt[0].y + 1.0f;
-		pt[3].x = pt[0].x + 1.0f;
-		pt[3].y = pt[0].y + 1.0f;
-		i = 4;
-		break;
-	case 3:
-		pt[0].x = (float)((x + x_offset) * sdl_scale);
-		pt[0].y = (float)((y + y_offset) * sdl_scale);
-		pt[1].x = pt[0].x + 1.0f;
-		pt[1].y = pt[0].y;
-		pt[2].x = pt[0].x;
-		pt[2].y = pt[0].y + 1.0f;
-		pt[3].x = pt[0].x + 1.0f;
-		pt[3].y = pt[0].y + 1.0f;
-		pt[4].x = pt[0].x + 2.0f;
-		pt[4].y = pt[0].y;
-		pt[5].x = pt[0].x;
-		pt[5].y = pt[0].y + 2.0f;
-		pt[6].x = pt[0].x + 2.0f;
-		pt[6].y = pt[0].y + 2.0f;
-		pt[7].x = pt[0].x + 2.0f;
-		pt[7].y = pt[0].y + 1.0f;
-		pt[8].x = pt[0].x + 1.0f;
-		pt[8].y = pt[0].y + 2.0f;
-		i = 9;
-		break;
-	case 4:
-		pt[0].x = (float)((x + x_offset) * sdl_scale);
-		pt[0].y = (float)((y + y_offset) * sdl_scale);
-		pt[1].x = pt[0].x + 1.0f;
-		pt[1].y = pt[0].y;
-		pt[2].x = pt[0].x;
-		pt[2].y = pt[0].y + 1.0f;
-		pt[3].x = pt[0].x + 1.0f;
-		pt[3].y = pt[0].y + 1.0f;
-		pt[4].x = pt[0].x + 2.0f;
-		pt[4].y = pt[0].y;
-		pt[5].x = pt[0].x;
-		pt[5].y = pt[0].y + 2.0f;
-		pt[6].x = pt[0].x + 2.0f;
-		pt[6].y = pt[0].y + 2.0f;
-		pt[7].x = pt[0].x + 2.0f;
-		pt[7].y = pt[0].y + 1.0f;
-		pt[8].x = pt[0].x + 1.0f;
-		pt[8].y = pt[0].y + 2.0f;
-		pt[9].x = pt[0].x + 3.0f;
-		pt[9].y = pt[0].y;
-		pt[10].x = pt[0].x + 3.0f;
-		pt[10].y = pt[0].y + 1.0f;
-		pt[11].x = pt[0].x + 3.0f;
-		pt[11].y = pt[0].y + 2.0f;
-		pt[12].x = pt[0].x + 3.0f;
-		pt[12].y = pt[0].y + 3.0f;
-		pt[13].x = pt[0].x;
-		pt[13].y = pt[0].y + 3.0f;
-		pt[14].x = pt[0].x + 1.0f;
-		pt[14].y = pt[0].y + 3.0f;
-		pt[15].x = pt[0].x + 2.0f;
-		pt[15].y = pt[0].y + 3.0f;
-		i = 16;
-		break;
-	default:
-		warn("unsupported scale %d in sdl_pixel()", sdl_scale);
-		return;
-	}
-	SDL_RenderPoints(sdlren, pt, i);
+	sdl_prim_rect((float)((x + x_offset) * sdl_scale), (float)((y + y_offset) * sdl_scale), (float)sdl_scale,
+	    (float)sdl_scale, r, g, b, a);
+	sdl_prim_done();
 }
 
-void sdl_pretty_pixel(int x, int y, unsigned short color, int x_offset, int y_offset)
-{
-	int r, g, b;
-	float px, py;
-	SDL_FPoint pt[16];
-
-	r = R16TO32(color);
-	g = G16TO32(color);
-	b = B16TO32(color);
-
-	px = (float)((x + x_offset) * sdl_scale);
-	py = (float)((y + y_offset) * sdl_scale);
-
-	switch (sdl_scale) {
-	case 1:
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)255);
-		SDL_RenderPoint(sdlren, px, py);
-		break;
-	case 2:
-		SDL_SetRenderDrawColor(sdlren, (Uint8)min(r + 64, 255), (Uint8)min(g + 64, 255), (Uint8)min(b + 64, 255), 255);
-		SDL_RenderPoint(sdlren, px, py);
-
-		pt[0].x = px + 1.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 1.0f;
-
-		pt[2].x = px - 1.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 1.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)128);
-		SDL_RenderPoints(sdlren, pt, 4);
-
-		pt[0].x = px + 2.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 2.0f;
-
-		pt[2].x = px - 2.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 2.0f;
-
-		pt[4].x = px + 1.0f;
-		pt[4].y = py + 1.0f;
-
-		pt[5].x = px + 1.0f;
-		pt[5].y = py - 1.0f;
-
-		pt[6].x = px - 1.0f;
-		pt[6].y = py + 1.0f;
-
-		pt[7].x = px - 1.0f;
-		pt[7].y = py - 1.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)64);
-		SDL_RenderPoints(sdlren, pt, 8);
-		break;
-	case 3:
-	case 4:
-		SDL_SetRenderDrawColor(sdlren, (Uint8)min(r + 64, 255), (Uint8)min(g + 64, 255), (Uint8)min(b + 64, 255), 255);
-		SDL_RenderPoint(sdlren, px, py);
-
-		pt[0].x = px + 1.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 1.0f;
-
-		pt[2].x = px - 1.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 1.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)min(r + 32, 255), (Uint8)min(g + 32, 255), (Uint8)min(b + 32, 255),
-		    sdl_scale == 4 ? 192 : 128);
-		SDL_RenderPoints(sdlren, pt, 4);
-
-		pt[0].x = px + 2.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 2.0f;
-
-		pt[2].x = px - 2.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 2.0f;
-
-		pt[4].x = px + 1.0f;
-		pt[4].y = py + 1.0f;
-
-		pt[5].x = px + 1.0f;
-		pt[5].y = py - 1.0f;
-
-		pt[6].x = px - 1.0f;
-		pt[6].y = py + 1.0f;
-
-		pt[7].x = px - 1.0f;
-		pt[7].y = py - 1.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)sdl_scale == 4 ? 128 : 64);
-		SDL_RenderPoints(sdlren, pt, 8);
-
-		pt[0].x = px + 3.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 3.0f;
-
-		pt[2].x = px - 3.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 3.0f;
-
-		pt[4].x = px + 2.0f;
-		pt[4].y = py + 1.0f;
-
-		pt[5].x = px + 2.0f;
-		pt[5].y = py - 1.0f;
-
-		pt[6].x = px - 2.0f;
-		pt[6].y = py + 1.0f;
-
-		pt[7].x = px - 2.0f;
-		pt[7].y = py - 1.0f;
+// Bless and rain particles are drawn from a small atlas made for the current
+// scale: one cell per shape and brightness layer, so a particle is one quad
+// per layer instead of a dozen or more points. The maps show where the dots
+// go around the particle in the middle, the digit is the ring they belong to.
+static const char *particle_map[PARTICLE_SHAPES][PARTICLE_SIZE] = {
+    {"...3...", "..323..", ".32123.", "3210123", ".32123.", "..323..", "...3..."}, // sdl_pretty_pixel()
+    {".33233.", ".32123.", ".32023.", "..101..", "...1...", ".......", "......."}, // sdl_rain_pixel()
+};
 
-		pt[8].x = px + 1.0f;
-		pt[8].y = py + 2.0f;
+// Alpha and brightness layer (colour + 32 * layer) of each ring by scale. A
+// ring with alpha 0 is not drawn. At scale 1 a particle is a single pixel.
+static const unsigned char particle_alpha[5][4] = {
+    {0, 0, 0, 0}, {255, 0, 0, 0}, {255, 128, 64, 0}, {255, 128, 64, 32}, {255, 192, 128, 64}};
+static const unsigned char particle_layer[5][4] = {{0, 0, 0, 0}, {0, 0, 0, 0}, {2, 0, 0, 0}, {2, 1, 0, 0}, {2, 1, 0, 0}};
 
-		pt[9].x = px + 1.0f;
-		pt[9].y = py - 2.0f;
+static SDL_Texture *particle_tex = NULL;
+static int particle_scale = 0, particle_layers = 0;
 
-		pt[10].x = px - 1.0f;
-		pt[10].y = py + 2.0f;
+static void particle_atlas_make(void)
+{
+	enum { W = PARTICLE_SHAPES * PARTICLE_LAYERS * PARTICLE_CELL };
+	uint32_t pixel[W * PARTICLE_CELL] = {0};
+
+	particle_scale = sdl_scale;
+	particle_layers = 0;
+	for (int shape = 0; shape < PARTICLE_SHAPES; shape++) {
+		for (int y = 0; y < PARTICLE_SIZE; y++) {
+			for (int x = 0; x < PARTICLE_SIZE; x++) {
+				if (particle_map[shape][y][x] == '.') {
+					continue;
+				}
+				int ring = particle_map[shape][y][x] - '0';
+				int alpha = particle_alpha[sdl_scale][ring];
+				int layer = particle_layer[sdl_scale][ring];
+				if (!alpha) {
+					continue;
+				}
+				pixel[(shape * PARTICLE_LAYERS + layer) * PARTICLE_CELL + x + y * W] =
+				    ((uint32_t)alpha << 24) | 0xffffff;
+				particle_layers |= 1 << layer;
+			}
+		}
+	}
 
-		pt[11].x = px - 1.0f;
-		pt[11].y = py - 2.0f;
+	particle_tex = SDL_CreateTexture(sdlren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, W, PARTICLE_CELL);
+	if (particle_tex) {
+		SDL_UpdateTexture(particle_tex, NULL, pixel, (int)(W * sizeof(uint32_t)));
+		SDL_SetTextureBlendMode(particle_tex, SDL_BLENDMODE_BLEND);
+	} else {
+		warn("SDL_texture Error: %s in particle atlas", SDL_GetError());
+	}
+}
 
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)sdl_scale == 4 ? 64 : 32);
-		SDL_RenderPoints(sdlren, pt, 12);
-		break;
-	default:
-		warn("unsupported scale %d in sdl_pixel()", sdl_scale);
-		return;
+void sdl_particle_exit(void)
+{
+	if (particle_tex) {
+		sdl_batch_flush();
+		SDL_DestroyTexture(particle_tex);
+		particle_tex = NULL;
 	}
+	particle_scale = 0;
 }
 
-void sdl_rain_pixel(int x, int y, unsigned short color, int x_offset, int y_offset)
+static void sdl_particle(int shape, int x, int y, unsigned short color, int x_offset, int y_offset)
 {
-	int r, g, b;
-	float px, py;
-	SDL_FPoint pt[16];
+	SDL_Vertex vertices[PARTICLE_LAYERS * 4];
+	int indices[PARTICLE_LAYERS * 6];
+	float px, py, tw = (float)(PARTICLE_SHAPES * PARTICLE_LAYERS * PARTICLE_CELL);
+	int r, g, b, quads = 0;
 
 	r = R16TO32(color);
 	g = G16TO32(color);
@@ -564,119 +1060,59 @@ void sdl_rain_pixel(int x, int y, unsigned short color, int x_offset, int y_offs
 	px = (float)((x + x_offset) * sdl_scale);
 	py = (float)((y + y_offset) * sdl_scale);
 
-	switch (sdl_scale) {
-	case 1:
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)255);
-		SDL_RenderPoint(sdlren, px, py);
-		break;
-	case 2:
-		SDL_SetRenderDrawColor(sdlren, (Uint8)min(r + 64, 255), (Uint8)min(g + 64, 255), (Uint8)min(b + 64, 255), 255);
-		SDL_RenderPoint(sdlren, px, py);
-		SDL_RenderPoint(sdlren, px, py - 1.0f);
-
-		pt[0].x = px + 1.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 1.0f;
-
-		pt[2].x = px - 1.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 2.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)128);
-		SDL_RenderPoints(sdlren, pt, 4);
-
-		pt[0].x = px + 1.0f;
-		pt[0].y = py - 1.0f;
-
-		pt[1].x = px - 1.0f;
-		pt[1].y = py - 1.0f;
-
-		pt[2].x = px - 1.0f;
-		pt[2].y = py - 2.0f;
-
-		pt[3].x = px + 1.0f;
-		pt[3].y = py - 2.0f;
-
-		pt[4].x = px;
-		pt[4].y = py - 3.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)64);
-		SDL_RenderPoints(sdlren, pt, 5);
-		break;
-	case 3:
-	case 4:
-		SDL_SetRenderDrawColor(sdlren, (Uint8)min(r + 64, 255), (Uint8)min(g + 64, 255), (Uint8)min(b + 64, 255), 255);
-		SDL_RenderPoint(sdlren, px, py);
-		SDL_RenderPoint(sdlren, px, py - 1.0f);
-
-		pt[0].x = px + 1.0f;
-		pt[0].y = py;
-
-		pt[1].x = px;
-		pt[1].y = py + 1.0f;
-
-		pt[2].x = px - 1.0f;
-		pt[2].y = py;
-
-		pt[3].x = px;
-		pt[3].y = py - 2.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)min(r + 32, 255), (Uint8)min(g + 32, 255), (Uint8)min(b + 32, 255),
-		    sdl_scale == 4 ? 192 : 128);
-		SDL_RenderPoints(sdlren, pt, 4);
-
-		pt[0].x = px + 1.0f;
-		pt[0].y = py - 1.0f;
-
-		pt[1].x = px - 1.0f;
-		pt[1].y = py - 1.0f;
-
-		pt[2].x = px - 1.0f;
-		pt[2].y = py - 2.0f;
-
-		pt[3].x = px + 1.0f;
-		pt[3].y = py - 2.0f;
-
-		pt[4].x = px;
-		pt[4].y = py - 3.0f;
-
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)sdl_scale == 4 ? 128 : 64);
-		SDL_RenderPoints(sdlren, pt, 5);
-		pt[0].x = px + 2.0f;
-		pt[0].y = py - 1.0f;
-
-		pt[1].x = px - 2.0f;
-		pt[1].y = py - 1.0f;
-
-		pt[2].x = px + 2.0f;
-		pt[2].y = py - 2.0f;
-
-		pt[3].x = px - 2.0f;
-		pt[3].y = py - 2.0f;
-
-		pt[4].x = px + 1.0f;
-		pt[4].y = py - 3.0f;
-
-		pt[5].x = px - 1.0f;
-		pt[5].y = py - 3.0f;
+	if (sdl_scale == 1) {
+		sdl_prim_rect(px, py, 1.0f, 1.0f, r, g, b, 255);
+		sdl_prim_done();
+		return;
+	}
+	if (sdl_scale < 1 || sdl_scale > 4) {
+		warn("unsupported scale %d in sdl_particle()", sdl_scale);
+		return;
+	}
+	if (particle_scale != sdl_scale) {
+		sdl_particle_exit();
+		particle_atlas_make();
+	}
+	if (!particle_tex) {
+		return;
+	}
 
-		pt[6].x = px + 2.0f;
-		pt[6].y = py - 3.0f;
+	px -= (float)(PARTICLE_SIZE / 2);
+	py -= (float)(PARTICLE_SIZE / 2);
+	for (int layer = 0; layer < PARTICLE_LAYERS; layer++) {
+		if (!(particle_layers & (1 << layer))) {
+			continue;
+		}
+		SDL_FColor c = {(float)min(r + layer * 32, 255) / 255.0f, (float)min(g + layer * 32, 255) / 255.0f,
+		    (float)min(b + layer * 32, 255) / 255.0f, 1.0f};
+		float u = (float)((shape * PARTICLE_LAYERS + layer) * PARTICLE_CELL);
+		SDL_Vertex *v = vertices + quads * 4;
+		for (int i = 0; i < 4; i++) {
+			float dx = i == 1 || i == 2 ? (float)PARTICLE_SIZE : 0.0f;
+			float dy = i >= 2 ? (float)PARTICLE_SIZE : 0.0f;
+			v[i].position = (SDL_FPoint){px + dx, py + dy};
+			v[i].color = c;
+			v[i].tex_coord = (SDL_FPoint){(u + dx) / tw, dy / (float)PARTICLE_CELL};
+		}
+		indices[quads * 6 + 0] = quads * 4;
+		indices[quads * 6 + 1] = quads * 4 + 1;
+		indices[quads * 6 + 2] = quads * 4 + 2;
+		indices[quads * 6 + 3] = quads * 4;
+		indices[quads * 6 + 4] = quads * 4 + 2;
+		indices[quads * 6 + 5] = quads * 4 + 3;
+		quads++;
+	}
+	sdl_batch_add(particle_tex, vertices, indices, quads, 0);
+}
 
-		pt[7].x = px - 2.0f;
-		pt[7].y = py - 3.0f;
-		SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)sdl_scale == 4 ? 64 : 32);
-		SDL_RenderPoints(sdlren, pt, 8);
+void sdl_pretty_pixel(int x, int y, unsigned short color, int x_offset, int y_offset)
+{
+	sdl_particle(0, x, y, color, x_offset, y_offset);
+}
 
-		break;
-	default:
-		warn("unsupported scale %d in sdl_pixel()", sdl_scale);
-		return;
-	}
+void sdl_rain_pixel(int x, int y, unsigned short color, int x_offset, int y_offset)
+{
+	sdl_particle(1, x, y, color, x_offset, y_offset);
 }
 
 void sdl_line(int fx, int fy, int tx, int ty, unsigned short color, int clipsx, int clipsy, int clipex, int clipey,
@@ -720,10 +1156,10 @@ void sdl_line(int fx, int fy, int tx, int ty, unsigned short color, int clipsx,
 	fy += y_offset;
 	ty += y_offset;
 
-	SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)a);
 	// TODO: This is a thinner line when scaled up. It looks surprisingly good. Maybe keep it this way?
-	SDL_RenderLine(
-	    sdlren, (float)(fx * sdl_scale), (float)(fy * sdl_scale), (float)(tx * sdl_scale), (float)(ty * sdl_scale));
+	sdl_prim_line(
+	    (float)(fx * sdl_scale), (float)(fy * sdl_scale), (float)(tx * sdl_scale), (float)(ty * sdl_scale), r, g, b, a);
+	sdl_prim_done();
 }
 
 void sdl_bargraph_add(int dx, unsigned char *data, int val)
@@ -737,104 +1173,24 @@ void sdl_bargraph(int sx, int sy, int dx, unsigned char *data, int x_offset, int
 	int n;
 
 	for (n = 0; n < dx; n++) {
-		if (data[n] > 40) {
-			SDL_SetRenderDrawColor(sdlren, 255, 80, 80, 127);
-		} else {
-			SDL_SetRenderDrawColor(sdlren, 80, 255, 80, 127);
-		}
-
-		SDL_RenderLine(sdlren, (float)((sx + n + x_offset) * sdl_scale), (float)((sy + y_offset) * sdl_scale),
-		    (float)((sx + n + x_offset) * sdl_scale), (float)((sy - data[n] + y_offset) * sdl_scale));
+		sdl_prim_line((float)((sx + n + x_offset) * sdl_scale), (float)((sy + y_offset) * sdl_scale),
+		    (float)((sx + n + x_offset) * sdl_scale), (float)((sy - data[n] + y_offset) * sdl_scale),
+		    data[n] > 40 ? 255 : 80, data[n] > 40 ? 80 : 255, 80, 127);
 	}
+	sdl_prim_done();
 }
 
 void sdl_pixel_alpha(int x, int y, unsigned short color, unsigned char alpha, int x_offset, int y_offset)
 {
-	int r, g, b, i;
-	SDL_FPoint pt[16];
+	int r, g, b;
 
 	r = R16TO32(color);
 	g = G16TO32(color);
 	b = B16TO32(color);
 
-	SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)alpha);
-	SDL_SetRenderDrawBlendMode(sdlren, current_blend_mode);
-	switch (sdl_scale) {
-	case 1:
-		SDL_RenderPoint(sdlren, (float)(x + x_offset), (float)(y + y_offset));
-		return;
-	case 2:
-		pt[0].x = (float)((x + x_offset) * sdl_scale);
-		pt[0].y = (float)((y + y_offset) * sdl_scale);
-		pt[1].x = pt[0].x + 1;
-		pt[1].y = pt[0].y;
-		pt[2].x = pt[0].x;
-		pt[2].y = pt[0].y + 1;
-		pt[3].x = pt[0].x + 1;
-		pt[3].y = pt[0].y + 1;
-		i = 4;
-		break;
-	case 3:
-		pt[0].x = (float)((x + x_offset) * sdl_scale);
-		pt[0].y = (float)((y + y_offset) * sdl_scale);
-		pt[1].x = pt[0].x + 1;
-		pt[1].y = pt[0].y;
-		pt[2].x = pt[0].x;
-		pt[2].y = pt[0].y + 1;
-		pt[3].x = pt[0].x + 1;
-		pt[3].y = pt[0].y + 1;
-		pt[4].x = pt[0].x + 2;
-		pt[4].y = pt[0].y;
-		pt[5].x = pt[0].x;
-		pt[5].y = pt[0].y + 2;
-		pt[6].x = pt[0].x + 2;
-		pt[6].y = pt[0].y + 2;
-		pt[7].x = pt[0].x + 2;
-		pt[7].y = pt[0].y + 1;
-		pt[8].x = pt[0].x + 1;
-		pt[8].y = pt[0].y + 2;
-		i = 9;
-		break;
-	case 4:
-		pt[0].x = (float)((x + x_offset) * sdl_scale);
-		pt[0].y = (float)((y + y_offset) * sdl_scale);
-		pt[1].x = pt[0].x + 1;
-		pt[1].y = pt[0].y;
-		pt[2].x = pt[0].x;
-		pt[2].y = pt[0].y + 1;
-		pt[3].x = pt[0].x + 1;
-		pt[3].y = pt[0].y + 1;
-		pt[4].x = pt[0].x + 2;
-		pt[4].y = pt[0].y;
-		pt[5].x = pt[0].x;
-		pt[5].y = pt[0].y + 2;
-		pt[6].x = pt[0].x + 2;
-		pt[6].y = pt[0].y + 2;
-		pt[7].x = pt[0].x + 2;
-		pt[7].y = pt[0].y + 1;
-		pt[8].x = pt[0].x + 1;
-		pt[8].y = pt[0].y + 2;
-		pt[9].x = pt[0].x + 3;
-		pt[9].y = pt[0].y;
-		pt[10].x = pt[0].x + 3;
-		pt[10].y = pt[0].y + 1;
-		pt[11].x = pt[0].x + 3;
-		pt[11].y = pt[0].y + 2;
-		pt[12].x = pt[0].x + 3;
-		pt[12].y = pt[0].y + 3;
-		pt[13].x = pt[0].x;
-		pt[13].y = pt[0].y + 3;
-		pt[14].x = pt[0].x + 1;
-		pt[14].y = pt[0].y + 3;
-		pt[15].x = pt[0].x + 2;
-		pt[15].y = pt[0].y + 3;
-		i = 16;
-		break;
-	default:
-		warn("unsupported scale %d in sdl_pixel_alpha()", sdl_scale);
-		return;
-	}
-	SDL_RenderPoints(sdlren, pt, i);
+	sdl_prim_rect((float)((x + x_offset) * sdl_scale), (float)((y + y_offset) * sdl_scale), (float)sdl_scale,
+	    (float)sdl_scale, r, g, b, alpha);
+	sdl_prim_done();
 }
 
 // Cohen-Sutherland outcodes for line clipping
@@ -951,10 +1307,9 @@ void sdl_line_alpha(int fx, int fy, int tx, int ty, unsigned short color, unsign
 	fy += y_offset;
 	ty += y_offset;
 
-	SDL_SetRenderDrawColor(sdlren, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)alpha);
-	SDL_SetRenderDrawBlendMode(sdlren, current_blend_mode);
-	SDL_RenderLine(
-	    sdlren, (float)(fx * sdl_scale), (float)(fy * sdl_scale), (float)(tx * sdl_scale), (float)(ty * sdl_scale));
+	sdl_prim_line((float)(fx * sdl_scale), (float)(fy * sdl_scale), (float)(tx * sdl_scale), (float)(ty * sdl_scale), r,
+	    g, b, alpha);
+	sdl_prim_done();
 }
 
 void sdl_set_blend_mode(int mode)
@@ -1319,6 +1674,7 @@ struct render_target {
 static struct render_target render_targets[MAX_RENDER_TARGETS];
 static int render_targets_initialized = 0;
 static int current_render_target = -1; // -1 = screen
+int sdl_target_resets = 0;
 
 static void init_render_targets(void)
 {
@@ -1400,6 +1756,9 @@ void sdl_destroy_render_target(int target_id)
 
 int sdl_set_render_target(int target_id)
 {
+	// Queued geometry belongs to the old target
+	sdl_batch_flush();
+
 	if (target_id < 0) {
 		// Reset to screen
 		SDL_SetRenderTarget(sdlren, NULL);
@@ -1427,6 +1786,8 @@ void sdl_render_target_to_screen(int target_id, int x, int y, unsigned char alph
 		return;
 	}
 
+	sdl_batch_flush();
+
 	// Make sure we're rendering to the screen
 	if (current_render_target >= 0) {
 		SDL_SetRenderTarget(sdlren, NULL);
@@ -1457,6 +1818,7 @@ void sdl_clear_render_target(int target_id)
 		return;
 	}
 
+	sdl_batch_flush();
 	SDL_SetRenderTarget(sdlren, render_targets[target_id].tex);
 	SDL_SetRenderDrawColor(sdlren, 0, 0, 0, 0);
 	SDL_RenderClear(sdlren);
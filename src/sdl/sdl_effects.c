@@ -8,8 +8,14 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <SDL3/SDL.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "astonia.h"
 #include "sdl/sdl.h"
@@ -25,18 +31,28 @@
 #define OGET_G(c) ((((unsigned short int)(c)) >> 5) & 0x1F)
 #define OGET_B(c) ((((unsigned short int)(c)) >> 0) & 0x1F)
 
-static inline int light_calc(int val, int light)
+// sdl_light() of one channel for light levels 0 to LIGHT_LEVELS-1, one set
+// for each combination of GO_LIGHTER and GO_LIGHTER2, so that changing the
+// options needs no rebuild. Filled by sdl_light_init(), until then
+// sdl_light() calculates.
+#define LIGHT_LEVELS 16
+static uint8_t light_table[4][LIGHT_LEVELS][256];
+static int light_table_ready;
+
+static void light_map_init(void);
+
+static int light_calc(int val, int light, uint64_t options)
 {
 	int v1, v2, m = 3, d = 4;
 
-	if (game_options & (GO_LIGHTER | GO_LIGHTER2)) {
+	if (options & (GO_LIGHTER | GO_LIGHTER2)) {
 		v1 = val * light / 15;
 		v2 = (int)(val * sqrt(light) / 3.87);
-		if (game_options & GO_LIGHTER) {
+		if (options & GO_LIGHTER) {
 			m--;
 			d--;
 		}
-		if (game_options & GO_LIGHTER2) {
+		if (options & GO_LIGHTER2) {
 			m -= 2;
 			d -= 2;
 		}
@@ -46,8 +62,41 @@ static inline int light_calc(int val, int light)
 	}
 }
 
+static inline int light_set(uint64_t options)
+{
+	return ((options & GO_LIGHTER) ? 1 : 0) | ((options & GO_LIGHTER2) ? 2 : 0);
+}
+
+// Fill the light tables, and the light map for the current sdl_scale
+void sdl_light_init(void)
+{
+	for (int set = 0; set < 4; set++) {
+		uint64_t options = ((set & 1) ? GO_LIGHTER : 0) | ((set & 2) ? GO_LIGHTER2 : 0);
+		for (int light = 0; light < LIGHT_LEVELS; light++) {
+			for (int v = 0; v < 256; v++) {
+				light_table[set][light][v] =
+				    (uint8_t)(light ? light_calc(v, light, options) : min(255, v * 2 + 4));
+			}
+		}
+	}
+	light_table_ready = 1;
+
+	light_map_init();
+}
+
+// The table sdl_light() uses for light with the current options, NULL if
+// light is out of range or there are no tables yet
+const uint8_t *sdl_light_table(int light)
+{
+	if (!light_table_ready || light < 0 || light >= LIGHT_LEVELS) {
+		return NULL;
+	}
+	return light_table[light_set(game_options)][light];
+}
+
 uint32_t sdl_light(int light, uint32_t irgb)
 {
+	const uint8_t *t = sdl_light_table(light);
 	int r, g, b, a;
 
 	r = IGET_R(irgb);
@@ -55,19 +104,37 @@ uint32_t sdl_light(int light, uint32_t irgb)
 	b = IGET_B(irgb);
 	a = IGET_A(irgb);
 
+	if (t) {
+		return IRGBA(t[r], t[g], t[b], a);
+	}
+
 	if (light == 0) {
 		r = min(255, r * 2 + 4);
 		g = min(255, g * 2 + 4);
 		b = min(255, b * 2 + 4);
 	} else {
-		r = light_calc(r, light);
-		g = light_calc(g, light);
-		b = light_calc(b, light);
+		r = light_calc(r, light, game_options);
+		g = light_calc(g, light, game_options);
+		b = light_calc(b, light, game_options);
 	}
 
 	return IRGBA(r, g, b, a);
 }
 
+// sdl_light() as a colour modulation factor, for light applied at draw time.
+// Only valid for light 1-15, light 0 brightens and can't be expressed that way.
+// Close but not bit exact: sdl_light() truncates per channel, the GPU rounds
+// the product. Without GO_LIGHTER/GO_LIGHTER2 a modulated channel is the same
+// or one step brighter, with them it can be a step darker or up to two
+// brighter. A multiply can't reproduce the truncation, so this is the price
+// of sharing one texture between light levels.
+float sdl_light_factor(int light)
+{
+	const uint8_t *t = sdl_light_table(light);
+
+	return (float)(t ? t[255] : light_calc(255, light, game_options)) / 255.0f;
+}
+
 uint32_t sdl_freeze(int freeze, uint32_t irgb)
 {
 	int r, g, b, a;
@@ -296,6 +363,174 @@ uint32_t sdl_colorize_pix2(uint32_t irgb, unsigned short c1v, unsigned short c2v
 	return irgb;
 }
 
+// Channels of sdl_colorize_pix2() that recolour a pixel when they are set,
+// one byte per pixel in the colorize mask of an image
+#define CM_GREEN 1
+#define CM_BLUE  2
+#define CM_RED   4
+
+// Work out for every pixel of an image which channels sdl_colorize_pix2()
+// would apply to it. That only depends on the image, so all colour variants
+// of a sprite can share it instead of looking at the neighbours again.
+// Returns NULL if out of memory.
+static uint8_t *colorize_mask(const uint32_t *pixel, int xres, int yres)
+{
+	const int w = xres * sdl_scale, h = yres * sdl_scale, reach = sdl_scale > 2 ? 2 : 1;
+	uint8_t *mask;
+
+#ifdef SDL_FAST_MALLOC
+	mask = MALLOC((size_t)w * (size_t)h + 1);
+#else
+	mask = xmalloc((size_t)w * (size_t)h + 1, MEM_SDL_PNG);
+#endif
+	if (!mask) {
+		return NULL;
+	}
+
+	// Bits 0-2: the pixel itself has the colour, as would_colorize() sees it.
+	// Bits 3-5: it has enough of it to be recoloured next to such a pixel.
+	for (int i = 0; i < w * h; i++) {
+		double rf, gf, bf, m, rm, gm, bm;
+		uint8_t cm = 0;
+
+		rf = IGET_R(pixel[i]) / 255.0;
+		gf = IGET_G(pixel[i]) / 255.0;
+		bf = IGET_B(pixel[i]) / 255.0;
+
+		m = max(max(rf, gf), bf) + 0.000001;
+		rm = rf / m;
+		gm = gf / m;
+		bm = bf / m;
+
+		if (gm > 0.99 && rm < GREENCOL && bm < GREENCOL) {
+			cm |= CM_GREEN;
+		}
+		if (bm > 0.99 && rm < BLUECOL && gm < BLUECOL) {
+			cm |= CM_BLUE;
+		}
+		if (rm > 0.99 && gm < REDCOL && bm < REDCOL) {
+			cm |= CM_RED;
+		}
+		if (gm > 0.67) {
+			cm |= CM_GREEN << 3;
+		}
+		if (bm > 0.67) {
+			cm |= CM_BLUE << 3;
+		}
+		if (rm > 0.67) {
+			cm |= CM_RED << 3;
+		}
+		mask[i] = cm;
+	}
+
+	// Keep the weak bits next to a strong neighbour, see would_colorize_neigh()
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			uint8_t *cm = &mask[x + y * w], neigh = 0;
+
+			if (!(*cm >> 3)) {
+				continue;
+			}
+			for (int d = 1; d <= reach; d++) {
+				if (x - d >= 0) {
+					neigh |= cm[-d];
+				}
+				if (x + d < w) {
+					neigh |= cm[d];
+				}
+				if (y - d >= 0) {
+					neigh |= cm[-d * w];
+				}
+				if (y + d < h) {
+					neigh |= cm[d * w];
+				}
+			}
+			*cm = (uint8_t)((*cm & 7) | ((*cm & (neigh << 3)) & 0x38) | (*cm & 7) << 3);
+		}
+	}
+
+	for (int i = 0; i < w * h; i++) {
+		mask[i] >>= 3;
+	}
+
+	return mask;
+}
+
+// sdl_colorize_pix2() of a new style sprite with the channels that apply
+// taken from its colorize mask
+static uint32_t colorize_masked(uint32_t irgb, unsigned short c1v, unsigned short c2v, unsigned short c3v, uint8_t cm)
+{
+	double rf, gf, bf;
+	int r, g, b, a;
+
+	if (!((c1v && (cm & CM_GREEN)) || (c2v && (cm & CM_BLUE)) || (c3v && (cm & CM_RED)))) {
+		return irgb;
+	}
+
+	rf = IGET_R(irgb) / 255.0;
+	gf = IGET_G(irgb) / 255.0;
+	bf = IGET_B(irgb) / 255.0;
+	a = IGET_A(irgb);
+
+	if (c1v && (cm & CM_GREEN)) {
+		r = (int)(8.0 * (OGET_R(c1v) * gf + (1.0 - gf) * rf));
+		g = (int)(8.0 * OGET_G(c1v) * gf);
+		b = (int)(8.0 * (OGET_B(c1v) * gf + (1.0 - gf) * bf));
+	} else if (c2v && (cm & CM_BLUE)) {
+		r = (int)(8.0 * (OGET_R(c2v) * bf + (1.0 - bf) * rf));
+		g = (int)(8.0 * (OGET_G(c2v) * bf + (1.0 - bf) * gf));
+		b = (int)(8.0 * OGET_B(c2v) * bf);
+	} else {
+		r = (int)(8.0 * OGET_R(c3v) * rf);
+		g = (int)(8.0 * (OGET_G(c3v) * rf + (1.0 - rf) * gf));
+		b = (int)(8.0 * (OGET_B(c3v) * rf + (1.0 - rf) * bf));
+	}
+
+	return IRGBA(r, g, b, a);
+}
+
+// Colorize all pixels of si with the colours of st into dst, which is as
+// large as si->pixel. New style sprites use the colorize mask of si, which
+// the first variant to get here builds and the others share.
+void sdl_colorize_image(uint32_t *dst, struct sdl_image *si, const struct sdl_texture *st)
+{
+	const int w = si->xres * sdl_scale, h = si->yres * sdl_scale;
+	uint8_t *mask = NULL, *expected = NULL;
+
+	if (st->sprite >= 220000) {
+		mask = __atomic_load_n(&si->cmask, __ATOMIC_ACQUIRE);
+		if (!mask && (mask = colorize_mask(si->pixel, si->xres, si->yres))) {
+			if (__atomic_compare_exchange_n(&si->cmask, &expected, mask, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				extern long long mem_png;
+				__atomic_add_fetch(&mem_png, (long long)w * h, __ATOMIC_RELAXED);
+				__atomic_add_fetch(&si->mem, (uint32_t)(w * h), __ATOMIC_RELAXED);
+			} else {
+				// Another worker was faster
+#ifdef SDL_FAST_MALLOC
+				FREE(mask);
+#else
+				xfree(mask);
+#endif
+				mask = expected;
+			}
+		}
+	}
+
+	if (mask) {
+		for (int i = 0; i < w * h; i++) {
+			dst[i] = colorize_masked(si->pixel[i], st->c1, st->c2, st->c3, mask[i]);
+		}
+		return;
+	}
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			dst[x + y * w] = sdl_colorize_pix2(
+			    si->pixel[x + y * w], st->c1, st->c2, st->c3, x, y, si->xres, si->yres, si->pixel, (int)st->sprite);
+		}
+	}
+}
+
 uint32_t sdl_colorbalance(uint32_t irgb, char cr, char cg, char cb, char light, char sat)
 {
 	int r, g, b, a, grey;
@@ -375,3 +610,580 @@ uint32_t sdl_colorbalance(uint32_t irgb, char cr, char cg, char cb, char light,
 
 	return irgb;
 }
+
+// ============================================================================
+// Effect pipeline of sdl_make()
+// ============================================================================
+
+// The effects as sdl_make() always applied them, testing every effect for
+// every pixel. Used when the tables of sdl_fx_prepare() can't express the
+// light, and as the reference for the kernels.
+void sdl_fx_generic(const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int w, int h)
+{
+	const struct sdl_texture *st = fx->st;
+	uint32_t irgb;
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			irgb = src[x + y * w];
+
+			if (st->cr || st->cg || st->cb || st->light || st->sat) {
+				irgb =
+				    sdl_colorbalance(irgb, (char)st->cr, (char)st->cg, (char)st->cb, (char)st->light, (char)st->sat);
+			}
+			if (st->shine) {
+				irgb = sdl_shine_pix(irgb, st->shine);
+			}
+
+			if (fx->flags & FX_DROPALPHA) {
+				if (IGET_A(irgb) < 255) {
+					irgb = 0;
+				}
+			}
+
+			if (st->ll != st->ml || st->rl != st->ml || st->ul != st->ml || st->dl != st->ml) {
+				int r, g, b, a;
+				int r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0;
+				int g1 = 0, g2 = 0, g3 = 0, g4 = 0, g5 = 0;
+				int b1 = 0, b2 = 0, b3 = 0, b4 = 0, b5 = 0;
+				int v1, v2, v3, v4, v5 = 0;
+				int div;
+
+				if (y < 10 * sdl_scale + (20 * sdl_scale - abs(20 * sdl_scale - x)) / 2) {
+					// This part calculates a floor tile, or the top of a wall tile
+					if (x / 2 < 20 * sdl_scale - y) {
+						v2 = -(x / 2 - (20 * sdl_scale - y));
+						r2 = IGET_R(sdl_light(st->ll, irgb));
+						g2 = IGET_G(sdl_light(st->ll, irgb));
+						b2 = IGET_B(sdl_light(st->ll, irgb));
+					} else {
+						v2 = 0;
+					}
+					if (x / 2 > 20 * sdl_scale - y) {
+						v3 = (x / 2 - (20 * sdl_scale - y));
+						r3 = IGET_R(sdl_light(st->rl, irgb));
+						g3 = IGET_G(sdl_light(st->rl, irgb));
+						b3 = IGET_B(sdl_light(st->rl, irgb));
+					} else {
+						v3 = 0;
+					}
+					if (x / 2 > y) {
+						v4 = (x / 2 - y);
+						r4 = IGET_R(sdl_light(st->ul, irgb));
+						g4 = IGET_G(sdl_light(st->ul, irgb));
+						b4 = IGET_B(sdl_light(st->ul, irgb));
+					} else {
+						v4 = 0;
+					}
+					if (x / 2 < y) {
+						v5 = -(x / 2 - y);
+						r5 = IGET_R(sdl_light(st->dl, irgb));
+						g5 = IGET_G(sdl_light(st->dl, irgb));
+						b5 = IGET_B(sdl_light(st->dl, irgb));
+					} else {
+						v5 = 0;
+					}
+
+					v1 = 20 * sdl_scale - (v2 + v3 + v4 + v5);
+					r1 = IGET_R(sdl_light(st->ml, irgb));
+					g1 = IGET_G(sdl_light(st->ml, irgb));
+					b1 = IGET_B(sdl_light(st->ml, irgb));
+				} else {
+					// This is for the lower part (left side and front as seen on the screen)
+					if (x < 10 * sdl_scale) {
+						v2 = 10 * sdl_scale - x;
+						r2 = IGET_R(sdl_light(st->ll, irgb));
+						g2 = IGET_G(sdl_light(st->ll, irgb));
+						b2 = IGET_B(sdl_light(st->ll, irgb));
+					} else {
+						v2 = 0;
+					}
+
+					if (x > 10 * sdl_scale && x < 20 * sdl_scale) {
+						v3 = x - 10 * sdl_scale;
+						r3 = IGET_R(sdl_light(st->rl, irgb));
+						g3 = IGET_G(sdl_light(st->rl, irgb));
+						b3 = IGET_B(sdl_light(st->rl, irgb));
+					} else {
+						v3 = 0;
+					}
+
+					if (x >= 20 * sdl_scale && x < 30 * sdl_scale) {
+						v5 = 30 * sdl_scale - x;
+						r5 = IGET_R(sdl_light(st->dl, irgb));
+						g5 = IGET_G(sdl_light(st->dl, irgb));
+						b5 = IGET_B(sdl_light(st->dl, irgb));
+					} else {
+						v5 = 0;
+					}
+
+					if (x > 30 * sdl_scale && x < 40 * sdl_scale) {
+						v4 = x - 30 * sdl_scale;
+						r4 = IGET_R(sdl_light(st->ul, irgb));
+						g4 = IGET_G(sdl_light(st->ul, irgb));
+						b4 = IGET_B(sdl_light(st->ul, irgb));
+					} else {
+						v4 = 0;
+					}
+
+					v1 = 20 * sdl_scale - v2 - v3 - v4 - v5;
+
+					r1 = IGET_R(sdl_light(st->ml, irgb));
+					g1 = IGET_G(sdl_light(st->ml, irgb));
+					b1 = IGET_B(sdl_light(st->ml, irgb));
+				}
+
+				div = v1 + v2 + v3 + v4 + v5;
+
+				if (div == 0) {
+					a = 0;
+					r = g = b = 0;
+				} else {
+					a = IGET_A(irgb);
+					r = (r1 * v1 + r2 * v2 + r3 * v3 + r4 * v4 + r5 * v5) / div;
+					g = (g1 * v1 + g2 * v2 + g3 * v3 + g4 * v4 + g5 * v5) / div;
+					b = (b1 * v1 + b2 * v2 + b3 * v3 + b4 * v4 + b5 * v5) / div;
+				}
+
+				irgb = IRGBA(r, g, b, a);
+
+			} else {
+				irgb = sdl_light(st->ml, irgb);
+			}
+
+			if (y >= fx->sink_y) {
+				irgb &= 0xffffff; // zero alpha to make it transparent
+			}
+
+			if (st->freeze) {
+				irgb = sdl_freeze(st->freeze, irgb);
+			}
+
+			dst[x + y * w] = irgb;
+		}
+	}
+}
+
+// Work out which effects st needs and tabulate its light levels. sink is
+// the sink in rows of the unscaled sprite, dropalpha drops pixels that are
+// not fully opaque.
+void sdl_fx_prepare(struct sdl_fx *fx, const struct sdl_texture *st, int sink, int dropalpha)
+{
+	const int level[5] = {st->ml, st->ll, st->rl, st->ul, st->dl};
+	int frz[3] = {0, 0, 0};
+
+	fx->st = st;
+	fx->flags = 0;
+	fx->sink_y = sink ? st->yres * sdl_scale - sink * sdl_scale + 1 : INT32_MAX;
+	fx->linear = 0;
+
+	if (st->cr || st->cg || st->cb || st->light || st->sat) {
+		fx->flags |= FX_BALANCE;
+	}
+	if (st->shine) {
+		fx->flags |= FX_SHINE;
+	}
+	if (dropalpha) {
+		fx->flags |= FX_DROPALPHA;
+	}
+	if (st->ll != st->ml || st->rl != st->ml || st->ul != st->ml || st->dl != st->ml) {
+		fx->flags |= FX_DIRLIGHT;
+		if (st->freeze) {
+			fx->flags |= FX_FREEZE;
+		}
+	} else if (st->freeze) {
+		frz[0] = frz[1] = 255 * st->freeze / (3 * RENDERFX_MAX_FREEZE - 1);
+		frz[2] = 255 * 3 * st->freeze / (3 * RENDERFX_MAX_FREEZE - 1);
+	}
+
+	// sdl_light() treats the channels alike, so one grey pixel per value
+	// gives all of them when it has no table for the level. If a channel
+	// overflows into the next one the tables can't express that.
+	for (int i = 0; i < ((fx->flags & FX_DIRLIGHT) ? 5 : 1); i++) {
+		const uint8_t *t = sdl_light_table(level[i]);
+		if (t) {
+			memcpy(fx->light[i], t, sizeof(fx->light[i]));
+			continue;
+		}
+		for (int v = 0; v < 256; v++) {
+			uint32_t irgb = sdl_light(level[i], IRGB(v, v, v));
+			if (irgb != IRGB(IGET_B(irgb), IGET_B(irgb), IGET_B(irgb))) {
+				fx->flags = FX_GENERIC | (fx->flags & FX_DROPALPHA);
+				return;
+			}
+			fx->light[i][v] = (uint8_t)IGET_B(irgb);
+		}
+	}
+
+	for (int c = 0; c < 3; c++) {
+		for (int v = 0; v < 256; v++) {
+			fx->chan[c][v] = (uint8_t)min(255, fx->light[0][v] + frz[c]);
+		}
+	}
+
+	if (!st->freeze && !(fx->flags & FX_DIRLIGHT) && st->ml > 0 && st->ml <= 15) {
+		fx->linear = st->ml;
+		for (int v = 0; v < 256; v++) {
+			if (fx->light[0][v] != v * st->ml / 15) {
+				fx->linear = 0;
+				break;
+			}
+		}
+	}
+}
+
+// Weights of ml, ll, rl, ul, dl at x, y of a tile sprite, as
+// sdl_fx_generic() works them out. They always add up to 20 * sdl_scale.
+static void light_weights(int x, int y, int *v)
+{
+	v[1] = v[2] = v[3] = v[4] = 0;
+
+	if (y < 10 * sdl_scale + (20 * sdl_scale - abs(20 * sdl_scale - x)) / 2) {
+		if (x / 2 < 20 * sdl_scale - y) {
+			v[1] = 20 * sdl_scale - y - x / 2;
+		}
+		if (x / 2 > 20 * sdl_scale - y) {
+			v[2] = x / 2 - (20 * sdl_scale - y);
+		}
+		if (x / 2 > y) {
+			v[3] = x / 2 - y;
+		}
+		if (x / 2 < y) {
+			v[4] = y - x / 2;
+		}
+	} else {
+		if (x < 10 * sdl_scale) {
+			v[1] = 10 * sdl_scale - x;
+		}
+		if (x > 10 * sdl_scale && x < 20 * sdl_scale) {
+			v[2] = x - 10 * sdl_scale;
+		}
+		if (x >= 20 * sdl_scale && x < 30 * sdl_scale) {
+			v[4] = 30 * sdl_scale - x;
+		}
+		if (x > 30 * sdl_scale && x < 40 * sdl_scale) {
+			v[3] = x - 30 * sdl_scale;
+		}
+	}
+	v[0] = 20 * sdl_scale - v[1] - v[2] - v[3] - v[4];
+}
+
+// light_weights() for the tile width of a sprite, one plane per light. The
+// weights only depend on y above 20 * sdl_scale, so the rows below all use
+// the last one. Wider sprites work out the columns past the map per pixel.
+// Built by sdl_light_init() for the sdl_scale at the time.
+#define LIGHT_MAP_MAX_W (40 * 4)
+#define LIGHT_MAP_MAX_H (20 * 4 + 1)
+static struct {
+	int scale; // 0 if there is no map
+	int w, h;
+	uint16_t magic; // x / (20 * scale) is (x * magic) >> (16 + shift)
+	int shift;
+	uint8_t v[5][LIGHT_MAP_MAX_H][LIGHT_MAP_MAX_W];
+} light_map;
+
+static void light_map_init(void)
+{
+	int v[5], div = 20 * sdl_scale;
+
+	light_map.scale = 0;
+	if (sdl_scale < 1 || sdl_scale > 4) {
+		return;
+	}
+	light_map.w = 40 * sdl_scale;
+	light_map.h = 20 * sdl_scale + 1;
+
+	for (int y = 0; y < light_map.h; y++) {
+		for (int x = 0; x < light_map.w; x++) {
+			light_weights(x, y, v);
+			for (int i = 0; i < 5; i++) {
+				if (v[i] < 0 || v[i] > 255) {
+					return;
+				}
+				light_map.v[i][y][x] = (uint8_t)v[i];
+			}
+		}
+	}
+
+	// The blend is at most 255 * div, find a multiply that divides all of
+	// that exactly
+	for (light_map.shift = 0; light_map.shift < 16; light_map.shift++) {
+		uint32_t m = ((1u << (16 + light_map.shift)) + (uint32_t)div - 1) / (uint32_t)div;
+		int n;
+
+		if (m > 0xffff) {
+			break;
+		}
+		for (n = 0; n <= 255 * div; n++) {
+			if ((uint32_t)n * m >> (16 + light_map.shift) != (uint32_t)(n / div)) {
+				break;
+			}
+		}
+		if (n > 255 * div) {
+			light_map.magic = (uint16_t)m;
+			light_map.scale = sdl_scale;
+			return;
+		}
+	}
+}
+
+// Balance, shine and dropalpha, the effects before the light
+SDL_FORCE_INLINE uint32_t fx_pre(const struct sdl_fx *fx, const unsigned int flags, uint32_t irgb)
+{
+	const struct sdl_texture *st = fx->st;
+
+	if (flags & FX_BALANCE) {
+		irgb = sdl_colorbalance(irgb, (char)st->cr, (char)st->cg, (char)st->cb, (char)st->light, (char)st->sat);
+	}
+	if (flags & FX_SHINE) {
+		irgb = sdl_shine_pix(irgb, st->shine);
+	}
+	if ((flags & FX_DROPALPHA) && IGET_A(irgb) < 255) {
+		irgb = 0;
+	}
+	return irgb;
+}
+
+// One pixel with the effects in flags. Always inlined with flags a
+// constant, so each kernel only has the code for its own effects.
+SDL_FORCE_INLINE uint32_t fx_pixel(const struct sdl_fx *fx, const unsigned int flags, int x, int y, uint32_t irgb)
+{
+	int r, g, b, a, v[5];
+
+	irgb = fx_pre(fx, flags, irgb);
+
+	r = IGET_R(irgb);
+	g = IGET_G(irgb);
+	b = IGET_B(irgb);
+	a = IGET_A(irgb);
+
+	if (!(flags & FX_DIRLIGHT)) {
+		return IRGBA(fx->chan[0][r], fx->chan[1][g], fx->chan[2][b], a);
+	}
+
+	int sr = 0, sg = 0, sb = 0;
+	light_weights(x, y, v);
+	for (int i = 0; i < 5; i++) {
+		sr += fx->light[i][r] * v[i];
+		sg += fx->light[i][g] * v[i];
+		sb += fx->light[i][b] * v[i];
+	}
+	irgb = IRGBA(sr / (20 * sdl_scale), sg / (20 * sdl_scale), sb / (20 * sdl_scale), a);
+
+	if (y >= fx->sink_y) {
+		irgb &= 0xffffff;
+	}
+	if (flags & FX_FREEZE) {
+		irgb = sdl_freeze(fx->st->freeze, irgb);
+	}
+
+	return irgb;
+}
+
+// Blend the five pre-lit colours in lit with the weights in row of the light
+// map into the colour of n pixels of dst, keeping their alpha
+static void light_blend(uint32_t *dst, uint32_t lit[5][LIGHT_MAP_MAX_W], int row, int n)
+{
+	const int div = 20 * light_map.scale;
+	int x = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128(), amask = _mm_set1_epi32((int)0xff000000);
+	const __m128i magic = _mm_set1_epi16((short)light_map.magic);
+	const __m128i shift = _mm_cvtsi32_si128(light_map.shift);
+
+	for (; x + 4 <= n; x += 4) {
+		__m128i lo = zero, hi = zero;
+		for (int i = 0; i < 5; i++) {
+			__m128i c = _mm_loadu_si128((const __m128i *)(lit[i] + x));
+			uint32_t v4;
+			memcpy(&v4, &light_map.v[i][row][x], sizeof(v4));
+			__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)v4), zero);
+			v = _mm_unpacklo_epi16(v, v);
+			lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi32(v, v)));
+			hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi32(v, v)));
+		}
+		lo = _mm_srl_epi16(_mm_mulhi_epu16(lo, magic), shift);
+		hi = _mm_srl_epi16(_mm_mulhi_epu16(hi, magic), shift);
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + x));
+		_mm_storeu_si128((__m128i *)(dst + x),
+		    _mm_or_si128(_mm_and_si128(d, amask), _mm_andnot_si128(amask, _mm_packus_epi16(lo, hi))));
+	}
+#elif defined(__ARM_NEON)
+	const uint32x4_t amask = vdupq_n_u32(0xff000000);
+	const int32x4_t shift = vdupq_n_s32(-(16 + light_map.shift));
+	const uint8x8_t idx_lo = {0, 0, 0, 0, 1, 1, 1, 1}, idx_hi = {2, 2, 2, 2, 3, 3, 3, 3};
+
+	for (; x + 4 <= n; x += 4) {
+		uint16x8_t lo = vdupq_n_u16(0), hi = vdupq_n_u16(0);
+		for (int i = 0; i < 5; i++) {
+			uint8x16_t c = vreinterpretq_u8_u32(vld1q_u32(lit[i] + x));
+			uint32_t v4;
+			memcpy(&v4, &light_map.v[i][row][x], sizeof(v4));
+			uint8x8_t v = vcreate_u8(v4);
+			lo = vmlal_u8(lo, vget_low_u8(c), vtbl1_u8(v, idx_lo));
+			hi = vmlal_u8(hi, vget_high_u8(c), vtbl1_u8(v, idx_hi));
+		}
+		uint16x4_t q[4] = {
+		    vmovn_u32(vshlq_u32(vmull_n_u16(vget_low_u16(lo), light_map.magic), shift)),
+		    vmovn_u32(vshlq_u32(vmull_n_u16(vget_high_u16(lo), light_map.magic), shift)),
+		    vmovn_u32(vshlq_u32(vmull_n_u16(vget_low_u16(hi), light_map.magic), shift)),
+		    vmovn_u32(vshlq_u32(vmull_n_u16(vget_high_u16(hi), light_map.magic), shift)),
+		};
+		uint8x16_t rgb = vcombine_u8(vmovn_u16(vcombine_u16(q[0], q[1])), vmovn_u16(vcombine_u16(q[2], q[3])));
+		uint32x4_t d = vld1q_u32(dst + x);
+		vst1q_u32(dst + x, vbslq_u32(amask, d, vreinterpretq_u32_u8(rgb)));
+	}
+#endif
+
+	for (; x < n; x++) {
+		int sr = 0, sg = 0, sb = 0;
+		for (int i = 0; i < 5; i++) {
+			int v = light_map.v[i][row][x];
+			sr += (int)IGET_R(lit[i][x]) * v;
+			sg += (int)IGET_G(lit[i][x]) * v;
+			sb += (int)IGET_B(lit[i][x]) * v;
+		}
+		dst[x] = (dst[x] & 0xff000000) | IRGB(sr / div, sg / div, sb / div);
+	}
+}
+
+// One row of directional light using the light map: look up the five
+// pre-lit colours per pixel, then blend them with light_blend()
+SDL_FORCE_INLINE void fx_dir_row(
+    const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int w, int y, const unsigned int flags)
+{
+	uint32_t lit[5][LIGHT_MAP_MAX_W];
+	const int n = min(w, light_map.w), row = min(y, light_map.h - 1);
+
+	for (int x = 0; x < n; x++) {
+		uint32_t irgb = fx_pre(fx, flags, src[x]);
+		int r = IGET_R(irgb), g = IGET_G(irgb), b = IGET_B(irgb);
+
+		for (int i = 0; i < 5; i++) {
+			lit[i][x] = IRGB(fx->light[i][r], fx->light[i][g], fx->light[i][b]);
+		}
+		dst[x] = irgb; // only the alpha is kept
+	}
+	light_blend(dst, lit, row, n);
+
+	if (y >= fx->sink_y || (flags & FX_FREEZE)) {
+		for (int x = 0; x < n; x++) {
+			if (y >= fx->sink_y) {
+				dst[x] &= 0xffffff;
+			}
+			if (flags & FX_FREEZE) {
+				dst[x] = sdl_freeze(fx->st->freeze, dst[x]);
+			}
+		}
+	}
+
+	for (int x = n; x < w; x++) {
+		dst[x] = fx_pixel(fx, flags, x, y, src[x]);
+	}
+}
+
+SDL_FORCE_INLINE void fx_run(
+    const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int w, int h, const unsigned int flags)
+{
+	const int map = (flags & FX_DIRLIGHT) && light_map.scale == sdl_scale;
+
+	for (int y = 0; y < h; y++) {
+		if (map) {
+			fx_dir_row(fx, dst + y * w, src + y * w, w, y, flags);
+			continue;
+		}
+		for (int x = 0; x < w; x++) {
+			dst[x + y * w] = fx_pixel(fx, flags, x, y, src[x + y * w]);
+		}
+	}
+}
+
+// Uniform light that is a plain v * linear / 15, the most common case,
+// several pixels at a time. x / 15 is (x * 2185) >> 15 for all x up to
+// 255 * 15. Alpha is multiplied by 15 to keep it.
+static void fx_run_linear(const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int n)
+{
+	const int k = fx->linear, drop = fx->flags & FX_DROPALPHA;
+	int i = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128(), amask = _mm_set1_epi32((int)0xff000000);
+	const __m128i mul = _mm_set_epi16(15, (short)k, (short)k, (short)k, 15, (short)k, (short)k, (short)k);
+	const __m128i div = _mm_set1_epi16(2185 * 2);
+
+	for (; i + 4 <= n; i += 4) {
+		__m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+		if (drop) {
+			p = _mm_and_si128(p, _mm_cmpeq_epi32(_mm_and_si128(p, amask), amask));
+		}
+		__m128i lo = _mm_mulhi_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), mul), div);
+		__m128i hi = _mm_mulhi_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), mul), div);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(__ARM_NEON)
+	const uint32x4_t amask = vdupq_n_u32(0xff000000);
+	const uint8x8_t mul = {(uint8_t)k, (uint8_t)k, (uint8_t)k, 15, (uint8_t)k, (uint8_t)k, (uint8_t)k, 15};
+
+	for (; i + 4 <= n; i += 4) {
+		uint32x4_t p = vld1q_u32(src + i);
+		if (drop) {
+			p = vandq_u32(p, vceqq_u32(vandq_u32(p, amask), amask));
+		}
+		uint8x16_t b = vreinterpretq_u8_u32(p);
+		int16x8_t lo = vqdmulhq_n_s16(vreinterpretq_s16_u16(vmull_u8(vget_low_u8(b), mul)), 2185);
+		int16x8_t hi = vqdmulhq_n_s16(vreinterpretq_s16_u16(vmull_u8(vget_high_u8(b), mul)), 2185);
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi))));
+	}
+#endif
+
+	for (; i < n; i++) {
+		uint32_t irgb = src[i];
+		if (drop && IGET_A(irgb) < 255) {
+			irgb = 0;
+		}
+		dst[i] = IRGBA(fx->chan[0][IGET_R(irgb)], fx->chan[1][IGET_G(irgb)], fx->chan[2][IGET_B(irgb)], IGET_A(irgb));
+	}
+}
+
+#define FX_CASE(f)                                                                                                     \
+	case (f):                                                                                                          \
+		fx_run(fx, dst, src, w, h, (f));                                                                               \
+		break;
+#define FX_CASE2(f)  FX_CASE(f) FX_CASE((f) | 1)
+#define FX_CASE4(f)  FX_CASE2(f) FX_CASE2((f) | 2)
+#define FX_CASE8(f)  FX_CASE4(f) FX_CASE4((f) | 4)
+#define FX_CASE16(f) FX_CASE8(f) FX_CASE8((f) | 8)
+#define FX_CASE32(f) FX_CASE16(f) FX_CASE16((f) | 16)
+
+// Apply the effects prepared by sdl_fx_prepare() to the w x h pixels in src,
+// writing them to dst, which may be src.
+void sdl_fx_apply(const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int w, int h)
+{
+	if (fx->flags & FX_GENERIC) {
+		sdl_fx_generic(fx, dst, src, w, h);
+		return;
+	}
+
+	if (fx->linear == 15 && !fx->flags) {
+		if (dst != src) {
+			memcpy(dst, src, (size_t)w * (size_t)h * sizeof(uint32_t));
+		}
+	} else if (fx->linear && !(fx->flags & ~(unsigned int)FX_DROPALPHA)) {
+		fx_run_linear(fx, dst, src, w * h);
+	} else {
+		switch (fx->flags) {
+			FX_CASE32(0)
+		}
+	}
+
+	// Sink only touches alpha and freeze only colour, so for the kernels
+	// without FX_DIRLIGHT it can come last
+	if (!(fx->flags & FX_DIRLIGHT)) {
+		for (int y = max(0, fx->sink_y); y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				dst[x + y * w] &= 0xffffff;
+			}
+		}
+	}
+}
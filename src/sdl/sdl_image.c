@@ -13,7 +13,11 @@
 #include <math.h>
 #include <SDL3/SDL.h>
 #include <png.h>
-#include <zip.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "dll.h"
 #include "astonia.h"
@@ -79,116 +83,263 @@ uint32_t mix_argb(uint32_t c1, uint32_t c2, float w1, float w2)
 	return IRGBA(r, g, b, a);
 }
 
-void sdl_smoothify(uint32_t *pixel, int xres, int yres, int scale __attribute__((unused)))
+// Weight of the left or top pixel, in 1/256, at each offset into a block of
+// sdl_smoothify(). These are the 0.75f/0.25f etc. mix_argb() used to get.
+static const uint32_t smooth_weight[5][4] = {
+    {0},
+    {0},
+    {256, 128},
+    {256, 171, 85},
+    {256, 192, 128, 64},
+};
+
+// Integer mix_argb(c1, c2, w / 256.0f, 1 - w / 256.0f). For the weights in
+// smooth_weight it gives exactly the same result for every pair of pixels.
+static inline uint32_t smooth_mix(uint32_t c1, uint32_t c2, uint32_t w)
 {
-	int x, y;
-	uint32_t c1, c2, c3, c4;
-
-	switch (scale) {
-	case 2:
-		for (x = 0; x < xres - 2; x += 2) {
-			for (y = 0; y < yres - 2; y += 2) {
-				c1 = pixel[x + y * xres]; // top left
-				c2 = pixel[x + y * xres + 2]; // top right
-				c3 = pixel[x + y * xres + xres * 2]; // bottom left
-				c4 = pixel[x + y * xres + 2 + xres * 2]; // bottom right
-#if 0 // we really only want this for wall tiles
-      // don't interpolate with very transparent pixels
-				if (IGET_A(c1) < 64 || IGET_A(c2) < 64 || IGET_A(c3) < 64 || IGET_A(c4) < 64) {
-					continue;
-				}
-#endif
-				pixel[x + y * xres + 1] = mix_argb(c1, c2, 0.5f, 0.5f);
-				pixel[x + y * xres + xres] = mix_argb(c1, c3, 0.5f, 0.5f);
-				pixel[x + y * xres + 1 + xres] =
-				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.5f, 0.5f);
-			}
+	uint32_t rb, ag;
+
+	if (!((c1 | c2) >> 24)) {
+		return 0;
+	}
+	rb = (((c1 & 0x00ff00ff) * w + (c2 & 0x00ff00ff) * (256 - w)) >> 8) & 0x00ff00ff;
+	ag = (((c1 >> 8) & 0x00ff00ff) * w + ((c2 >> 8) & 0x00ff00ff) * (256 - w)) & 0xff00ff00;
+
+	return rb | ag;
+}
+
+// Interpolate one row of blocks horizontally: dst gets the block corners
+// from src and the pixels between them mixed.
+static void smooth_hrow(uint32_t *dst, const uint32_t *src, int n, int scale)
+{
+	const uint32_t *w = smooth_weight[scale];
+
+	for (int x = 0; x < n; x += scale) {
+		uint32_t c1 = src[x], c2 = src[x + scale];
+		dst[x] = c1;
+		for (int i = 1; i < scale; i++) {
+			dst[x + i] = smooth_mix(c1, c2, w[i]);
 		}
-		break;
-	case 3:
-		for (x = 0; x < xres - 3; x += 3) {
-			for (y = 0; y < yres - 3; y += 3) {
-				c1 = pixel[x + y * xres]; // top left
-				c2 = pixel[x + y * xres + 3]; // top right
-				c3 = pixel[x + y * xres + xres * 3]; // bottom left
-				c4 = pixel[x + y * xres + 3 + xres * 3]; // bottom right
-#if 0 // we really only want this for wall tiles
-      // don't interpolate with very transparent pixels
-				if (IGET_A(c1) < 64 || IGET_A(c2) < 64 || IGET_A(c3) < 64 || IGET_A(c4) < 64) {
-					continue;
-				}
+	}
+}
+
+// dst[x] = smooth_mix(top[x], bottom[x], w) for n pixels
+static void smooth_vrow(uint32_t *dst, const uint32_t *top, const uint32_t *bottom, int n, uint32_t w)
+{
+	int x = 0;
+
+#if defined(__SSE2__)
+	const __m128i mask = _mm_set1_epi32(0x00ff00ff), zero = _mm_setzero_si128();
+	const __m128i w1 = _mm_set1_epi16((short)w), w2 = _mm_set1_epi16((short)(256 - w));
+
+	for (; x + 4 <= n; x += 4) {
+		__m128i t = _mm_loadu_si128((const __m128i *)(top + x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(bottom + x));
+		__m128i clear = _mm_cmpeq_epi32(_mm_srli_epi32(_mm_or_si128(t, b), 24), zero);
+		__m128i rb = _mm_add_epi16(
+		    _mm_mullo_epi16(_mm_and_si128(t, mask), w1), _mm_mullo_epi16(_mm_and_si128(b, mask), w2));
+		__m128i ag = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(t, 8), mask), w1),
+		    _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(b, 8), mask), w2));
+		__m128i c = _mm_or_si128(_mm_srli_epi16(rb, 8), _mm_andnot_si128(mask, ag));
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_andnot_si128(clear, c));
+	}
+#elif defined(__ARM_NEON)
+	const uint32x4_t mask = vdupq_n_u32(0x00ff00ff);
+	const uint16_t w1 = (uint16_t)w, w2 = (uint16_t)(256 - w);
+
+	for (; x + 4 <= n; x += 4) {
+		uint32x4_t t = vld1q_u32(top + x), b = vld1q_u32(bottom + x);
+		uint32x4_t clear = vceqq_u32(vshrq_n_u32(vorrq_u32(t, b), 24), vdupq_n_u32(0));
+		uint16x8_t rb = vaddq_u16(vmulq_n_u16(vreinterpretq_u16_u32(vandq_u32(t, mask)), w1),
+		    vmulq_n_u16(vreinterpretq_u16_u32(vandq_u32(b, mask)), w2));
+		uint16x8_t ag = vaddq_u16(vmulq_n_u16(vreinterpretq_u16_u32(vandq_u32(vshrq_n_u32(t, 8), mask)), w1),
+		    vmulq_n_u16(vreinterpretq_u16_u32(vandq_u32(vshrq_n_u32(b, 8), mask)), w2));
+		uint32x4_t c = vorrq_u32(vreinterpretq_u32_u16(vshrq_n_u16(rb, 8)), vbicq_u32(vreinterpretq_u32_u16(ag), mask));
+		vst1q_u32(dst + x, vbicq_u32(c, clear));
+	}
 #endif
-				pixel[x + y * xres + 1] = mix_argb(c1, c2, 0.667f, 0.333f);
-				pixel[x + y * xres + 2] = mix_argb(c1, c2, 0.333f, 0.667f);
-
-				pixel[x + y * xres + xres * 1] = mix_argb(c1, c3, 0.667f, 0.333f);
-				pixel[x + y * xres + xres * 2] = mix_argb(c1, c3, 0.333f, 0.667f);
-
-				pixel[x + y * xres + 1 + xres * 1] =
-				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.5f, 0.5f);
-				pixel[x + y * xres + 2 + xres * 1] =
-				    mix_argb(mix_argb(c1, c2, 0.333f, 0.667f), mix_argb(c3, c4, 0.333f, 0.667f), 0.667f, 0.333f);
-				pixel[x + y * xres + 1 + xres * 2] =
-				    mix_argb(mix_argb(c1, c2, 0.667f, 0.333f), mix_argb(c3, c4, 0.667f, 0.333f), 0.333f, 0.667f);
-				pixel[x + y * xres + 2 + xres * 2] =
-				    mix_argb(mix_argb(c1, c2, 0.333f, 0.667f), mix_argb(c3, c4, 0.333f, 0.667f), 0.333f, 0.667f);
+
+	for (; x < n; x++) {
+		dst[x] = smooth_mix(top[x], bottom[x], w);
+	}
+}
+
+// Smooth an image blown up by scale: the pixels between the block corners
+// are interpolated from the four corners. Works row by row, one horizontally
+// interpolated row of corners above and one below each row of blocks.
+void sdl_smoothify(uint32_t *pixel, int xres, int yres, int scale)
+{
+	uint32_t *top, *bottom, *tmp;
+	int span, y, j;
+
+	if (scale < 2 || scale > 4) {
+		warn("Unsupported scale %d in sdl_load_image_png()", sdl_scale);
+		return;
+	}
+
+	// The last column and row of corners has no block to their right or below
+	span = xres > scale ? (xres - 1) / scale * scale : 0;
+	if (!span || yres <= scale) {
+		return;
+	}
+	top = MALLOC((size_t)span * 2 * sizeof(uint32_t));
+	if (!top) {
+		return;
+	}
+	bottom = top + span;
+
+	smooth_hrow(top, pixel, span, scale);
+	for (y = 0; y < yres - scale; y += scale) {
+		uint32_t *row = pixel + y * xres, *next = row + scale * xres;
+
+		smooth_hrow(bottom, next, span, scale);
+		memcpy(row, top, (size_t)span * sizeof(uint32_t));
+		for (j = 1; j < scale; j++) {
+			smooth_vrow(row + j * xres, top, bottom, span, smooth_weight[scale][j]);
+		}
+		// The centre pixel of a 3x3 block has always been the plain average
+		if (scale == 3) {
+			for (int x = 0; x < span; x += 3) {
+				row[xres + x + 1] = smooth_mix(
+				    smooth_mix(row[x], row[x + 3], 128), smooth_mix(next[x], next[x + 3], 128), 128);
 			}
 		}
-		break;
-
-	case 4:
-		for (x = 0; x < xres - 4; x += 4) {
-			for (y = 0; y < yres - 4; y += 4) {
-				c1 = pixel[x + y * xres]; // top left
-				c2 = pixel[x + y * xres + 4]; // top right
-				c3 = pixel[x + y * xres + xres * 4]; // bottom left
-				c4 = pixel[x + y * xres + 4 + xres * 4]; // bottom right
-#if 0 // we really only want this for wall tiles
-      // don't interpolate with very transparent pixels
-				if (IGET_A(c1) < 64 || IGET_A(c2) < 64 || IGET_A(c3) < 64 || IGET_A(c4) < 64) {
-					continue;
-				}
+
+		tmp = top;
+		top = bottom;
+		bottom = tmp;
+	}
+
+	FREE(top < bottom ? top : bottom);
+}
+
+// Source columns and weight of the right one for each column of
+// sdl_resample()
+struct resample_col {
+	int x0, x1;
+	uint16_t w1; // 0..256
+};
+
+// One source row interpolated horizontally: four channels per pixel in byte
+// order, each 7 bits fixed point
+static void resample_hrow(uint16_t *dst, const uint32_t *src, const struct resample_col *col, int dw)
+{
+	for (int x = 0; x < dw; x++) {
+		const uint8_t *p = (const uint8_t *)&src[col[x].x0];
+		const uint8_t *q = (const uint8_t *)&src[col[x].x1];
+		uint32_t w1 = col[x].w1, w0 = 256 - w1;
+
+		for (int c = 0; c < 4; c++) {
+			dst[x * 4 + c] = (uint16_t)((p[c] * w0 + q[c] * w1) >> 1);
+		}
+	}
+}
+
+// Mix two rows from resample_hrow() vertically into n bytes of dst
+static void resample_vrow(uint8_t *dst, const uint16_t *top, const uint16_t *bottom, int n, uint32_t w1)
+{
+	uint32_t w0 = 256 - w1;
+	int i = 0;
+
+#if defined(__SSE2__)
+	const __m128i w = _mm_set1_epi32((int)(w1 << 16 | w0));
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i r[4];
+		for (int k = 0; k < 2; k++) {
+			__m128i t = _mm_loadu_si128((const __m128i *)(top + i + k * 8));
+			__m128i b = _mm_loadu_si128((const __m128i *)(bottom + i + k * 8));
+			r[k * 2] = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(t, b), w), 15);
+			r[k * 2 + 1] = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(t, b), w), 15);
+		}
+		_mm_storeu_si128((__m128i *)(dst + i),
+		    _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3])));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t t = vld1q_u16(top + i), b = vld1q_u16(bottom + i);
+		uint32x4_t lo = vmlal_n_u16(vmull_n_u16(vget_low_u16(t), (uint16_t)w0), vget_low_u16(b), (uint16_t)w1);
+		uint32x4_t hi = vmlal_n_u16(vmull_n_u16(vget_high_u16(t), (uint16_t)w0), vget_high_u16(b), (uint16_t)w1);
+		vst1_u8(dst + i, vmovn_u16(vcombine_u16(vshrn_n_u32(lo, 15), vshrn_n_u32(hi, 15))));
+	}
 #endif
-				pixel[x + y * xres + 1] = mix_argb(c1, c2, 0.75f, 0.25f);
-				pixel[x + y * xres + 2] = mix_argb(c1, c2, 0.5f, 0.5f);
-				pixel[x + y * xres + 3] = mix_argb(c1, c2, 0.25f, 0.75f);
-
-				pixel[x + y * xres + xres * 1] = mix_argb(c1, c3, 0.75f, 0.25f);
-				pixel[x + y * xres + xres * 2] = mix_argb(c1, c3, 0.5f, 0.5f);
-				pixel[x + y * xres + xres * 3] = mix_argb(c1, c3, 0.25f, 0.75f);
-
-				pixel[x + y * xres + 1 + xres * 1] =
-				    mix_argb(mix_argb(c1, c2, 0.75f, 0.25f), mix_argb(c3, c4, 0.75f, 0.25f), 0.75f, 0.25f);
-				pixel[x + y * xres + 1 + xres * 2] =
-				    mix_argb(mix_argb(c1, c2, 0.75f, 0.25f), mix_argb(c3, c4, 0.75f, 0.25f), 0.5f, 0.5f);
-				pixel[x + y * xres + 1 + xres * 3] =
-				    mix_argb(mix_argb(c1, c2, 0.75f, 0.25f), mix_argb(c3, c4, 0.75f, 0.25f), 0.25f, 0.75f);
-
-				pixel[x + y * xres + 2 + xres * 1] =
-				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.75f, 0.25f);
-				pixel[x + y * xres + 2 + xres * 2] =
-				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.5f, 0.5f);
-				pixel[x + y * xres + 2 + xres * 3] =
-				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.25f, 0.75f);
-
-				pixel[x + y * xres + 3 + xres * 1] =
-				    mix_argb(mix_argb(c1, c2, 0.25f, 0.75f), mix_argb(c3, c4, 0.25f, 0.75f), 0.75f, 0.25f);
-				pixel[x + y * xres + 3 + xres * 2] =
-				    mix_argb(mix_argb(c1, c2, 0.25f, 0.75f), mix_argb(c3, c4, 0.25f, 0.75f), 0.5f, 0.5f);
-				pixel[x + y * xres + 3 + xres * 3] =
-				    mix_argb(mix_argb(c1, c2, 0.25f, 0.75f), mix_argb(c3, c4, 0.25f, 0.75f), 0.25f, 0.75f);
-			}
+
+	for (; i < n; i++) {
+		dst[i] = (uint8_t)((top[i] * w0 + bottom[i] * w1) >> 15);
+	}
+}
+
+// Bilinear scale of the sw x sh pixels in src to the dw x dh pixels in dst,
+// scale in percent. Samples the same source pixels as sdl_make() always has,
+// with the weights in 1/256 instead of double, which may make a channel one
+// lower. Each source row is interpolated horizontally once and kept while
+// the output rows still need it.
+void sdl_resample(uint32_t *dst, int dw, int dh, const uint32_t *src, int sw, int sh, int scale)
+{
+	struct resample_col *col;
+	uint16_t *hrow[2];
+	int tag[2] = {-1, -1};
+	double ix, iy;
+
+	if (dw <= 0 || dh <= 0) {
+		return;
+	}
+	col = MALLOC((size_t)dw * sizeof(struct resample_col) + (size_t)dw * 8 * sizeof(uint16_t));
+	if (!col) {
+		memset(dst, 0, (size_t)dw * (size_t)dh * sizeof(uint32_t));
+		return;
+	}
+	hrow[0] = (uint16_t *)(col + dw);
+	hrow[1] = hrow[0] + dw * 4;
+
+	for (int x = 0; x < dw; x++) {
+		ix = x * 100.0 / scale;
+		if (ceil(ix) >= sw) {
+			ix = sw - 1.001;
 		}
-		break;
-	default:
-		warn("Unsupported scale %d in sdl_load_image_png()", sdl_scale);
-		break;
+		col[x].x0 = max(0, (int)floor(ix));
+		col[x].x1 = max(0, (int)ceil(ix));
+		col[x].w1 = (uint16_t)((ix - floor(ix)) * 256.0 + 0.5);
+	}
+
+	for (int y = 0; y < dh; y++) {
+		int y0, y1, s0, s1;
+		uint32_t w1;
+
+		iy = y * 100.0 / scale;
+		if (ceil(iy) >= sh) {
+			iy = sh - 1.001;
+		}
+		y0 = max(0, (int)floor(iy));
+		y1 = max(0, (int)ceil(iy));
+		w1 = (uint32_t)((iy - floor(iy)) * 256.0 + 0.5);
+
+		// Keep the row the other one needs
+		s0 = tag[0] == y0 ? 0 : tag[1] == y0 ? 1 : -1;
+		if (s0 < 0) {
+			s0 = tag[0] == y1 ? 1 : 0;
+			resample_hrow(hrow[s0], src + y0 * sw, col, dw);
+			tag[s0] = y0;
+		}
+		s1 = tag[s0] == y1 ? s0 : tag[1 - s0] == y1 ? 1 - s0 : -1;
+		if (s1 < 0) {
+			s1 = 1 - s0;
+			resample_hrow(hrow[s1], src + y1 * sw, col, dw);
+			tag[s1] = y1;
+		}
+
+		resample_vrow((uint8_t *)(dst + y * dw), hrow[s0], hrow[s1], dw * 4, w1);
 	}
+
+	FREE(col);
 }
 
 struct png_helper {
 	char *filename;
-	zip_t *zip;
+	const struct sdl_archive *arch;
+	int64_t index; // entry of the file in arch, or -1 to look up filename
+	struct sdl_archive_file file;
+	size_t pos;
 	unsigned char **row;
 	int xres;
 	int yres;
@@ -200,20 +351,38 @@ struct png_helper {
 
 void png_helper_read(png_structp ps, png_bytep buf, png_size_t len)
 {
-	zip_fread(png_get_io_ptr(ps), buf, len);
+	struct png_helper *p = png_get_io_ptr(ps);
+
+	if (len > p->file.size - p->pos) {
+		png_error(ps, "unexpected end of file");
+	}
+	memcpy(buf, p->file.data + p->pos, len);
+	p->pos += len;
+}
+
+static void png_helper_close(struct png_helper *p, FILE *fp)
+{
+	if (p->arch) {
+		sdl_archive_release(&p->file);
+	}
+	if (fp) {
+		fclose(fp);
+	}
 }
 
 int png_load_helper(struct png_helper *p)
 {
 	FILE *fp = NULL;
-	zip_file_t *zp = NULL;
 	int tmp;
 
-	if (p->zip) {
-		zp = zip_fopen(p->zip, p->filename, 0);
-		if (!zp) {
+	if (p->arch) {
+		if (p->index < 0) {
+			p->index = sdl_archive_find(p->arch, p->filename);
+		}
+		if (p->index < 0 || sdl_archive_read(p->arch, (uint32_t)p->index, &p->file)) {
 			return -1;
 		}
+		p->pos = 0;
 	} else {
 		fp = fopen(p->filename, "rb");
 		if (!fp) {
@@ -223,31 +392,28 @@ int png_load_helper(struct png_helper *p)
 
 	p->png_ptr = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL, NULL, png_malloc_fn, png_free_fn);
 	if (!p->png_ptr) {
-		if (zp) {
-			zip_fclose(zp);
-		}
-		if (fp) {
-			fclose(fp);
-		}
+		png_helper_close(p, fp);
 		warn("create read\n");
 		return -1;
 	}
 
 	p->info_ptr = png_create_info_struct(p->png_ptr);
 	if (!p->info_ptr) {
-		if (zp) {
-			zip_fclose(zp);
-		}
-		if (fp) {
-			fclose(fp);
-		}
+		png_helper_close(p, fp);
 		png_destroy_read_struct(&p->png_ptr, (png_infopp)NULL, (png_infopp)NULL);
 		warn("create info1\n");
 		return -1;
 	}
 
-	if (p->zip) {
-		png_set_read_fn(p->png_ptr, zp, png_helper_read);
+	if (setjmp(png_jmpbuf(p->png_ptr))) {
+		png_helper_close(p, fp);
+		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, (png_infopp)NULL);
+		warn("damaged PNG (%s)", p->filename ? p->filename : "archive");
+		return -1;
+	}
+
+	if (p->arch) {
+		png_set_read_fn(p->png_ptr, p, png_helper_read);
 	} else {
 		png_init_io(p->png_ptr, fp);
 	}
@@ -256,12 +422,7 @@ int png_load_helper(struct png_helper *p)
 
 	p->row = png_get_rows(p->png_ptr, p->info_ptr);
 	if (!p->row) {
-		if (zp) {
-			zip_fclose(zp);
-		}
-		if (fp) {
-			fclose(fp);
-		}
+		png_helper_close(p, fp);
 		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, (png_infopp)NULL);
 		warn("read row\n");
 		return -1;
@@ -277,45 +438,32 @@ int png_load_helper(struct png_helper *p)
 	} else if (tmp == p->xres * 4) {
 		p->bpp = 32;
 	} else {
-		if (zp) {
-			zip_fclose(zp);
-		}
-		if (fp) {
-			fclose(fp);
-		}
+		png_helper_close(p, fp);
 		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, (png_infopp)NULL);
-		warn("rowbytes!=xres*4 (%d, %d, %s)", tmp, p->xres, p->filename);
+		if (p->arch) {
+			int len;
+			const char *name = sdl_archive_name(p->arch, (uint32_t)p->index, &len);
+			warn("rowbytes!=xres*4 (%d, %d, %.*s)", tmp, p->xres, len, name);
+		} else {
+			warn("rowbytes!=xres*4 (%d, %d, %s)", tmp, p->xres, p->filename);
+		}
 		return -1;
 	}
 
 	if (png_get_bit_depth(p->png_ptr, p->info_ptr) != 8) {
-		if (zp) {
-			zip_fclose(zp);
-		}
-		if (fp) {
-			fclose(fp);
-		}
+		png_helper_close(p, fp);
 		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, (png_infopp)NULL);
 		warn("bit depth!=8\n");
 		return -1;
 	}
 	if (png_get_channels(p->png_ptr, p->info_ptr) != p->bpp / 8) {
-		if (zp) {
-			zip_fclose(zp);
-		}
-		if (fp) {
-			fclose(fp);
-		}
+		png_helper_close(p, fp);
 		png_destroy_read_struct(&p->png_ptr, &p->info_ptr, (png_infopp)NULL);
 		warn("channels!=format\n");
 		return -1;
 	}
 
-	if (p->zip) {
-		zip_fclose(zp);
-	} else {
-		fclose(fp);
-	}
+	png_helper_close(p, fp);
 
 	return 0;
 }
@@ -325,15 +473,16 @@ void png_load_helper_exit(struct png_helper *p)
 	png_destroy_read_struct(&p->png_ptr, &p->info_ptr, (png_infopp)NULL);
 }
 
-// Load high res PNG
-int sdl_load_image_png_(struct sdl_image *si, char *filename, zip_t *zip)
+// Load high res PNG, either entry index or filename of arch
+int sdl_load_image_png_(struct sdl_image *si, char *filename, const struct sdl_archive *arch, int64_t index)
 {
 	int x, y, r, g, b, a, sx, sy, ex, ey;
 	uint32_t c;
 	struct png_helper p;
 
-	p.zip = zip;
+	p.arch = arch;
 	p.filename = filename;
+	p.index = index;
 	if (png_load_helper(&p)) {
 		return -1;
 	}
@@ -395,7 +544,8 @@ int sdl_load_image_png_(struct sdl_image *si, char *filename, zip_t *zip)
 	si->pixel = xmalloc((size_t)si->xres * si->yres * sizeof(uint32_t), MEM_SDL_PNG);
 #endif
 	extern long long mem_png;
-	__atomic_add_fetch(&mem_png, (long long)((size_t)si->xres * si->yres * sizeof(uint32_t)), __ATOMIC_RELAXED);
+	si->mem = (uint32_t)((size_t)si->xres * si->yres * sizeof(uint32_t));
+	__atomic_add_fetch(&mem_png, (long long)si->mem, __ATOMIC_RELAXED);
 
 	for (y = 0; y < si->yres; y++) {
 		for (x = 0; x < si->xres; x++) {
@@ -450,14 +600,16 @@ int sdl_load_image_png_(struct sdl_image *si, char *filename, zip_t *zip)
 // Load and up-scale low res PNG
 // TODO: add support for using a 2X image as a base for 4X
 // and possibly the other way around too
-int sdl_load_image_png(struct sdl_image *si, char *filename, zip_t *zip, int smoothify)
+int sdl_load_image_png(
+    struct sdl_image *si, char *filename, const struct sdl_archive *arch, int64_t index, int smoothify)
 {
 	int x, y, r, g, b, a, sx, sy, ex, ey;
 	uint32_t c;
 	struct png_helper p;
 
-	p.zip = zip;
+	p.arch = arch;
 	p.filename = filename;
+	p.index = index;
 	if (png_load_helper(&p)) {
 		return -1;
 	}
@@ -513,9 +665,8 @@ int sdl_load_image_png(struct sdl_image *si, char *filename, zip_t *zip, int smo
 	    xmalloc((size_t)si->xres * si->yres * sizeof(uint32_t) * (size_t)sdl_scale * (size_t)sdl_scale, MEM_SDL_PNG);
 #endif
 	extern long long mem_png;
-	__atomic_add_fetch(&mem_png,
-	    (long long)((size_t)si->xres * (size_t)si->yres * sizeof(uint32_t) * (size_t)sdl_scale * (size_t)sdl_scale),
-	    __ATOMIC_RELAXED);
+	si->mem = (uint32_t)((size_t)si->xres * (size_t)si->yres * sizeof(uint32_t) * (size_t)sdl_scale * (size_t)sdl_scale);
+	__atomic_add_fetch(&mem_png, (long long)si->mem, __ATOMIC_RELAXED);
 
 	for (y = 0; y < si->yres; y++) {
 		for (x = 0; x < si->xres; x++) {
@@ -618,79 +769,187 @@ int do_smoothify(int sprite)
 	return 0; /* Default: no smoothing */
 }
 
-int sdl_load_image(struct sdl_image *si, int sprite, struct zip_handles *zips)
+// Archive entry each sprite is loaded from, for the standard [0] and the
+// high res [1] archives: SPRITE_SRC_* << 28 | entry index, 0 if none.
+// Built once by sdl_zip_index_init() from the tables in sdl_gx.
+#define SPRITE_SRC_BASE  (GX_BASE + 1)
+#define SPRITE_SRC_PATCH (GX_PATCH + 1)
+#define SPRITE_SRC_MOD   (GX_MOD + 1)
+#define SPRITE_SRC_SHIFT 28
+static uint32_t sprite_src[2][MAXSPRITE];
+
+// Record the PNGs of sdl_gx[level][src - 1] (level 0 = standard, 1 = high
+// res). Called from low to high priority, so the archive searched first wins.
+static int zip_index_add(int level, uint32_t src)
 {
-	char filename[1024];
-	zip_t *zip1, *zip1p, *zip1m, *zip2, *zip2p, *zip2m;
-
-	if (zips) {
-		zip1 = zips->zip1;
-		zip1p = zips->zip1p;
-		zip1m = zips->zip1m;
-		zip2 = zips->zip2;
-		zip2p = zips->zip2p;
-		zip2m = zips->zip2m;
-	} else {
-		extern zip_t *sdl_zip1, *sdl_zip2, *sdl_zip1p, *sdl_zip2p, *sdl_zip1m, *sdl_zip2m;
-		zip1 = sdl_zip1;
-		zip1p = sdl_zip1p;
-		zip1m = sdl_zip1m;
-		zip2 = sdl_zip2;
-		zip2p = sdl_zip2p;
-		zip2m = sdl_zip2m;
+	const struct sdl_archive *arch = &sdl_gx[level][src - 1];
+	uint32_t n = arch->count;
+	int cnt = 0;
+
+	if (n >= (1u << SPRITE_SRC_SHIFT)) {
+		warn("Too many files in archive, not all sprites are indexed");
+		n = (1u << SPRITE_SRC_SHIFT) - 1;
+	}
+	for (uint32_t i = 0; i < n; i++) {
+		unsigned int sprite = 0;
+		int len, j;
+		const char *name = sdl_archive_name(arch, i, &len);
+
+		// Exactly "%08d.png", the name sdl_load_image() used to look up
+		if (len != 12 || memcmp(name + 8, ".png", 4)) {
+			continue;
+		}
+		for (j = 0; j < 8 && name[j] >= '0' && name[j] <= '9'; j++) {
+			sprite = sprite * 10 + (unsigned int)(name[j] - '0');
+		}
+		if (j != 8 || sprite >= MAXSPRITE) {
+			continue;
+		}
+		if (!sprite_src[level][sprite]) {
+			cnt++;
+		}
+		sprite_src[level][sprite] = (src << SPRITE_SRC_SHIFT) | i;
+	}
+	return cnt;
+}
+
+// Log the sprite numbers below the highest indexed one that no archive
+// has, as ranges, so missing graphics show up at startup and not one by
+// one as the game asks for them.
+static void zip_index_report_missing(int level)
+{
+	char buf[256];
+	int pos = 0, cnt = 0, last = 0;
+
+	for (int i = MAXSPRITE - 1; i > 0; i--) {
+		if (sprite_src[level][i]) {
+			last = i;
+			break;
+		}
+	}
+
+	for (int i = 1; i < last; i++) {
+		int from = i, n;
+
+		if (sprite_src[level][i]) {
+			continue;
+		}
+		while (i + 1 < last && !sprite_src[level][i + 1]) {
+			i++;
+		}
+		cnt += i - from + 1;
+
+		if (pos > (int)sizeof(buf) - 32) {
+			note("Sprites not in any archive: %s", buf);
+			pos = 0;
+		}
+		if (from == i) {
+			n = snprintf(buf + pos, sizeof(buf) - (size_t)pos, "%s%d", pos ? ", " : "", from);
+		} else {
+			n = snprintf(buf + pos, sizeof(buf) - (size_t)pos, "%s%d-%d", pos ? ", " : "", from, i);
+		}
+		pos += n;
+	}
+	if (pos) {
+		note("Sprites not in any archive: %s", buf);
+	}
+	if (cnt) {
+		note("Sprite index: %d sprites below %d missing", cnt, last);
+	}
+}
+
+// Build the sprite index from the archives in sdl_gx. Archives replaced by
+// a sprite pack are left out.
+void sdl_zip_index_init(void)
+{
+	int std = 0, hires = 0, upscaled = 0;
+
+	memset(sprite_src, 0, sizeof(sprite_src));
+
+	if (!sdl_pack_available(0)) {
+		std += zip_index_add(0, SPRITE_SRC_BASE);
+		std += zip_index_add(0, SPRITE_SRC_PATCH);
+		std += zip_index_add(0, SPRITE_SRC_MOD);
+	}
+	if (!sdl_pack_available(1)) {
+		hires += zip_index_add(1, SPRITE_SRC_BASE);
+		hires += zip_index_add(1, SPRITE_SRC_PATCH);
+		hires += zip_index_add(1, SPRITE_SRC_MOD);
 	}
 
+	if (hires) {
+		for (int i = 0; i < MAXSPRITE; i++) {
+			if (sprite_src[0][i] && !sprite_src[1][i]) {
+				upscaled++;
+			}
+		}
+		note("Sprite index: %d sprites, %d in %dx, %d of them upscaled", std, hires, sdl_scale, upscaled);
+	} else if (std) {
+		note("Sprite index: %d sprites", std);
+	}
+	if (std) {
+		zip_index_report_missing(0);
+	}
+}
+
+#define SPRITE_SRC_ARCHIVE(level, src) (&sdl_gx[level][((src) >> SPRITE_SRC_SHIFT) - 1])
+#define SPRITE_SRC_ENTRY(src)          ((int64_t)((src) & ((1u << SPRITE_SRC_SHIFT) - 1)))
+
+int sdl_load_image(struct sdl_image *si, int sprite)
+{
+	char filename[1024];
+	uint32_t src;
+
 	if (sprite >= MAXSPRITE || sprite < 0) {
 		note("sdl_load_image: illegal sprite %d wanted", sprite);
 		return -1;
 	}
+	si->cmask = NULL;
+	si->mem = 0;
 
 #if 0
 	// get patch png
 	sprintf(filename,"../gfxp/x%d/%08d/%08d.png",sdl_scale,(sprite/1000)*1000,sprite);
-	if (sdl_load_image_png_(si,filename,NULL)==0) return 0;
+	if (sdl_load_image_png_(si,filename,NULL,-1)==0) return 0;
 #endif
 
-	// get high res from archive
-	if (zip2 || zip2p || zip2m) {
-		sprintf(filename, "%08d.png", sprite);
-		if (zip2m && sdl_load_image_png_(si, filename, zip2m) == 0) {
-			return 0; // check mod archive first
-		}
-		if (zip2p && sdl_load_image_png_(si, filename, zip2p) == 0) {
-			return 0; // check patch archive second
+	// get high res from the sprite pack, or from the archive the index names
+	if (sdl_pack_available(1)) {
+		if (sdl_pack_load(si, (unsigned int)sprite, 1, 0) == 0) {
+			return 0;
 		}
-		if (zip2 && sdl_load_image_png_(si, filename, zip2) == 0) {
-			return 0; // check base archive third
+	} else if ((src = sprite_src[1][sprite])) {
+		if (sdl_load_image_png_(si, NULL, SPRITE_SRC_ARCHIVE(1, src), SPRITE_SRC_ENTRY(src)) == 0) {
+			return 0;
 		}
+		warn("Cannot load high res sprite %d", sprite);
 	}
 
 #if 0
 	// get high res from base png folder
 	sprintf(filename,"../gfx/x%d/%08d/%08d.png",sdl_scale,(sprite/1000)*1000,sprite);
-	if (sdl_load_image_png_(si,filename,NULL)==0) return 0;
+	if (sdl_load_image_png_(si,filename,NULL,-1)==0) return 0;
 #endif
 
-	// get standard from archive
-	if (zip1 || zip1p || zip1m) {
-		sprintf(filename, "%08d.png", sprite);
-		if (zip1m && sdl_load_image_png(si, filename, zip1m, do_smoothify(sprite)) == 0) {
+	// get standard from the sprite pack, or from the archive the index names
+	if (sdl_pack_available(0)) {
+		if (sdl_pack_load(si, (unsigned int)sprite, 0, do_smoothify(sprite)) == 0) {
 			return 0;
 		}
-		if (zip1p && sdl_load_image_png(si, filename, zip1p, do_smoothify(sprite)) == 0) {
-			return 0;
-		}
-		if (zip1 && sdl_load_image_png(si, filename, zip1, do_smoothify(sprite)) == 0) {
+	} else if ((src = sprite_src[0][sprite])) {
+		if (sdl_load_image_png(si, NULL, SPRITE_SRC_ARCHIVE(0, src), SPRITE_SRC_ENTRY(src), do_smoothify(sprite)) ==
+		    0) {
 			return 0;
 		}
+		warn("Cannot load sprite %d", sprite);
 	}
 
 #if 0
 	// get standard from base png folder
 	sprintf(filename,"../gfx/x1/%08d/%08d.png",(sprite/1000)*1000,sprite);
-	if (sdl_load_image_png(si,filename,NULL,do_smoothify(sprite))==0) return 0;
+	if (sdl_load_image_png(si,filename,NULL,-1,do_smoothify(sprite))==0) return 0;
 	sprintf(filename,"../gfxp/x1/%08d/%08d.png",(sprite/1000)*1000,sprite);
-	if (sdl_load_image_png(si,filename,NULL,do_smoothify(sprite))==0) return 0;
+	if (sdl_load_image_png(si,filename,NULL,-1,do_smoothify(sprite))==0) return 0;
 #endif
 
 	sprintf(filename, "%08d.png", sprite);
@@ -698,7 +957,7 @@ int sdl_load_image(struct sdl_image *si, int sprite, struct zip_handles *zips)
 
 	// get unknown sprite image
 	sprintf(filename, "%08d.png", 2);
-	if (zip1 && sdl_load_image_png(si, filename, zip1, do_smoothify(sprite)) == 0) {
+	if (sdl_load_image_png(si, filename, &sdl_gx[0][GX_BASE], -1, do_smoothify(sprite)) == 0) {
 		return 0;
 	}
 
@@ -711,7 +970,45 @@ int sdl_load_image(struct sdl_image *si, int sprite, struct zip_handles *zips)
 	return -1;
 }
 
-int sdl_ic_load(unsigned int sprite, struct zip_handles *zips)
+// Loaded images, most recently used first. sdl_ic_get() moves an image to
+// the front, sdl_ic_trim() evicts from the back.
+static SDL_SpinLock ic_lock;
+static int ic_lru_first = -1, ic_lru_last = -1;
+
+// Images are in the list while they are loaded. Needs ic_lock.
+static void ic_lru_unlink(int sprite)
+{
+	struct sdl_image *si = &sdli[sprite];
+
+	if (si->lru_prev != -1) {
+		sdli[si->lru_prev].lru_next = si->lru_next;
+	} else {
+		ic_lru_first = si->lru_next;
+	}
+	if (si->lru_next != -1) {
+		sdli[si->lru_next].lru_prev = si->lru_prev;
+	} else {
+		ic_lru_last = si->lru_prev;
+	}
+}
+
+// Link sprite in at the front. Needs ic_lock.
+static void ic_lru_push(int sprite)
+{
+	struct sdl_image *si = &sdli[sprite];
+
+	si->used_frame = sdl_frames;
+	si->lru_prev = -1;
+	si->lru_next = ic_lru_first;
+	if (ic_lru_first != -1) {
+		sdli[ic_lru_first].lru_prev = sprite;
+	} else {
+		ic_lru_last = sprite;
+	}
+	ic_lru_first = sprite;
+}
+
+int sdl_ic_load(unsigned int sprite)
 {
 #ifdef DEVELOPER
 	uint64_t start = SDL_GetTicks();
@@ -722,20 +1019,9 @@ int sdl_ic_load(unsigned int sprite, struct zip_handles *zips)
 		return -1;
 	}
 
-	// sdli_state is in sdl_core.c, we need to access it
-	// For now, we'll use a helper function or make it extern
-	extern int *sdli_state; // declared in sdl_core.c
-
-	enum {
-		IMG_UNLOADED = 0,
-		IMG_LOADING = 1,
-		IMG_READY = 2,
-		IMG_FAILED = 3,
-	};
-
 	int state;
 retry:
-	state = __atomic_load_n((int *)&sdli_state[sprite], __ATOMIC_ACQUIRE);
+	state = __atomic_load_n(&sdli_state[sprite], __ATOMIC_ACQUIRE);
 
 	if (state == IMG_READY) {
 #ifdef DEVELOPER
@@ -749,8 +1035,8 @@ retry:
 		return -1;
 	}
 
-	if (state == IMG_LOADING) {
-		// Someone else is loading; wait for them
+	if (state == IMG_LOADING || state == IMG_UNLOADING) {
+		// Someone else is loading or evicting it; wait for them
 		SDL_Delay(1);
 		goto retry;
 	}
@@ -758,32 +1044,166 @@ retry:
 	// state == IMG_UNLOADED, try to become the loader
 	int expected = IMG_UNLOADED;
 	if (!__atomic_compare_exchange_n(
-	        (int *)&sdli_state[sprite], &expected, IMG_LOADING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	        &sdli_state[sprite], &expected, IMG_LOADING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
 		// Lost the race, someone else started loading; wait
 		goto retry;
 	}
 
 	// We are the loader now
-	extern struct sdl_image *sdli;
-	if (sdl_load_image(sdli + sprite, (int)sprite, zips) == 0) {
-		__atomic_store_n((int *)&sdli_state[sprite], IMG_READY, __ATOMIC_RELEASE);
+	if (sdl_load_image(sdli + sprite, (int)sprite) == 0) {
+		// Link before publishing, sdl_ic_trim() skips it until it is ready
+		SDL_LockSpinlock(&ic_lock);
+		ic_lru_push((int)sprite);
+		SDL_UnlockSpinlock(&ic_lock);
+		__atomic_store_n(&sdli_state[sprite], IMG_READY, __ATOMIC_RELEASE);
 #ifdef DEVELOPER
 		extern long long sdl_time_load;
 		sdl_time_load += SDL_GetTicks() - start;
 #endif
 		return (int)sprite;
 	} else {
-		__atomic_store_n((int *)&sdli_state[sprite], IMG_FAILED, __ATOMIC_RELEASE);
+		__atomic_store_n(&sdli_state[sprite], IMG_FAILED, __ATOMIC_RELEASE);
+		return -1;
+	}
+}
+
+// Load sprite if needed and keep it from being evicted until sdl_ic_put().
+// Returns NULL if the image could not be loaded.
+// The pin is taken before looking at the state and sdl_ic_trim() looks at
+// the pins after leaving IMG_READY, so one of them always sees the other.
+struct sdl_image *sdl_ic_get(unsigned int sprite)
+{
+	if (sprite >= MAXSPRITE) {
+		note("illegal sprite %d wanted in sdl_ic_get", sprite);
+		return NULL;
+	}
+
+	while (1) {
+		__atomic_add_fetch(&sdli[sprite].pins, 1, __ATOMIC_SEQ_CST);
+		int state = __atomic_load_n(&sdli_state[sprite], __ATOMIC_SEQ_CST);
+
+		if (state == IMG_READY) {
+			SDL_LockSpinlock(&ic_lock);
+			ic_lru_unlink((int)sprite);
+			ic_lru_push((int)sprite);
+			SDL_UnlockSpinlock(&ic_lock);
+			return &sdli[sprite];
+		}
+
+		__atomic_sub_fetch(&sdli[sprite].pins, 1, __ATOMIC_SEQ_CST);
+		if (state == IMG_FAILED) {
+			return NULL;
+		}
+		if (state == IMG_UNLOADED) {
+			if (sdl_ic_load(sprite) < 0) {
+				return NULL;
+			}
+		} else {
+			SDL_Delay(1);
+		}
+	}
+}
+
+void sdl_ic_put(unsigned int sprite)
+{
+	__atomic_sub_fetch(&sdli[sprite].pins, 1, __ATOMIC_SEQ_CST);
+}
+
+static int ic_over_budget(long long freed)
+{
+	if (sdl_image_budget <= 0) {
+		return 0;
+	}
+	return __atomic_load_n(&mem_png, __ATOMIC_RELAXED) - freed > (long long)sdl_image_budget * 1024 * 1024;
+}
+
+// Evict least recently used images while the decoded images use more than
+// sdl_image_budget. Images used in this or the previous frame are kept, as
+// are pinned ones; the workers making textures from them hold a pin from
+// sdl_ic_get() to the end of stage 2. Stale jobs are dropped by their
+// generation check before they pin anything. Bounded per call like
+// sdl_tx_trim(). Render thread only.
+void sdl_ic_trim(void)
+{
+	int victim[64], cnt = 0;
+	long long freed = 0;
+
+	if (!ic_over_budget(0)) {
+		return;
+	}
+
+	SDL_LockSpinlock(&ic_lock);
+	int sprite = ic_lru_last;
+	while (cnt < 64 && sprite != -1 && ic_over_budget(freed)) {
+		struct sdl_image *si = &sdli[sprite];
+		int prev = si->lru_prev;
+		int expected = IMG_READY;
+
+		// Everything further up the list is even more recent
+		if (sdl_frames - si->used_frame <= 1) {
+			break;
+		}
+		if (__atomic_compare_exchange_n(
+		        &sdli_state[sprite], &expected, IMG_UNLOADING, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+			if (__atomic_load_n(&si->pins, __ATOMIC_SEQ_CST)) {
+				__atomic_store_n(&sdli_state[sprite], IMG_READY, __ATOMIC_RELEASE);
+			} else {
+				ic_lru_unlink(sprite);
+				freed += si->mem;
+				victim[cnt++] = sprite;
+			}
+		}
+		sprite = prev;
+	}
+	SDL_UnlockSpinlock(&ic_lock);
+
+	for (int i = 0; i < cnt; i++) {
+		struct sdl_image *si = &sdli[victim[i]];
+
+#ifdef SDL_FAST_MALLOC
+		FREE(si->pixel);
+		FREE(si->cmask);
+#else
+		if (si->pixel) {
+			xfree(si->pixel);
+		}
+		if (si->cmask) {
+			xfree(si->cmask);
+		}
+#endif
+		si->pixel = NULL;
+		si->cmask = NULL;
+		__atomic_sub_fetch(&mem_png, (long long)si->mem, __ATOMIC_RELAXED);
+		si->mem = 0;
+		__atomic_store_n(&sdli_state[victim[i]], IMG_UNLOADED, __ATOMIC_RELEASE);
+	}
+}
+
+// Stages 1 and 2 of sdl_make() for st, or its pixels from the disk cache.
+// Returns -1 if the image could not be loaded.
+int sdl_make_pixels(struct sdl_texture *st)
+{
+	if (sdl_dc_fetch(st)) {
+		return 0;
+	}
+	struct sdl_image *si = sdl_ic_get(st->sprite);
+	if (!si) {
 		return -1;
 	}
+	sdl_make(st, si, 1);
+	sdl_make(st, si, 2);
+	sdl_ic_put(st->sprite);
+	sdl_dc_store(st);
+
+	return 0;
 }
 
 void sdl_make(struct sdl_texture *st, struct sdl_image *si, int preload)
 {
 	SDL_Texture *texture;
-	int x, y, scale, sink, dropalpha;
-	double ix, iy, low_x, low_y, high_x, high_y, dbr, dbg, dbb, dba;
-	uint32_t irgb;
+	int scale, sink, dropalpha;
+	const uint32_t *src;
+	struct sdl_fx fx;
 #ifdef DEVELOPER
 	Uint64 start = SDL_GetTicks();
 #endif
@@ -797,13 +1217,15 @@ void sdl_make(struct sdl_texture *st, struct sdl_image *si, int preload)
 	// Check JSON config for drop_alpha
 	dropalpha = sprite_config_drop_alpha((unsigned int)st->sprite);
 
-	if (scale != 100) {
+	// Stage 3 keeps the size the pixels were made with, the image need not
+	// be loaded anymore if they came from the disk cache
+	if (preload != 3 && scale != 100) {
 		st->xres = (uint16_t)ceil((si->xres - 1) * (double)scale / 100.0);
 		st->yres = (uint16_t)ceil((si->yres - 1) * (double)scale / 100.0);
 
 		st->xoff = (int16_t)floor(si->xoff * (double)scale / 100.0 + 0.5);
 		st->yoff = (int16_t)floor(si->yoff * (double)scale / 100.0 + 0.5);
-	} else {
+	} else if (preload != 3) {
 		st->xres = (uint16_t)si->xres;
 		st->yres = (uint16_t)si->yres;
 		st->xoff = si->xoff;
@@ -863,217 +1285,39 @@ void sdl_make(struct sdl_texture *st, struct sdl_image *si, int preload)
 		start = SDL_GetTicks();
 #endif
 
-		for (y = 0; y < st->yres * sdl_scale; y++) {
-			for (x = 0; x < st->xres * sdl_scale; x++) {
-				if (scale != 100) {
-					ix = x * 100.0 / scale;
-					iy = y * 100.0 / scale;
-
-					if (ceil(ix) >= si->xres * sdl_scale) {
-						ix = si->xres * sdl_scale - 1.001;
-					}
-
-					if (ceil(iy) >= si->yres * sdl_scale) {
-						iy = si->yres * sdl_scale - 1.001;
-					}
-
-					high_x = ix - floor(ix);
-					high_y = iy - floor(iy);
-					low_x = 1 - high_x;
-					low_y = 1 - high_y;
-
-					irgb = si->pixel[(int)(floor(ix) + floor(iy) * si->xres * sdl_scale)];
-
-					if (st->c1 || st->c2 || st->c3) {
-						irgb = sdl_colorize_pix2(irgb, st->c1, st->c2, st->c3, (int)floor(ix), (int)floor(iy), si->xres,
-						    si->yres, si->pixel, (int)st->sprite);
-					}
-					dba = IGET_A(irgb) * low_x * low_y;
-					dbr = IGET_R(irgb) * low_x * low_y;
-					dbg = IGET_G(irgb) * low_x * low_y;
-					dbb = IGET_B(irgb) * low_x * low_y;
-
-					irgb = si->pixel[(int)(ceil(ix) + floor(iy) * si->xres * sdl_scale)];
-
-					if (st->c1 || st->c2 || st->c3) {
-						irgb = sdl_colorize_pix2(irgb, st->c1, st->c2, st->c3, (int)ceil(ix), (int)floor(iy), si->xres,
-						    si->yres, si->pixel, (int)st->sprite);
-					}
-					dba += IGET_A(irgb) * high_x * low_y;
-					dbr += IGET_R(irgb) * high_x * low_y;
-					dbg += IGET_G(irgb) * high_x * low_y;
-					dbb += IGET_B(irgb) * high_x * low_y;
-
-					irgb = si->pixel[(int)(floor(ix) + ceil(iy) * si->xres * sdl_scale)];
-
-					if (st->c1 || st->c2 || st->c3) {
-						irgb = sdl_colorize_pix2(irgb, st->c1, st->c2, st->c3, (int)floor(ix), (int)ceil(iy), si->xres,
-						    si->yres, si->pixel, (int)st->sprite);
-					}
-					dba += IGET_A(irgb) * low_x * high_y;
-					dbr += IGET_R(irgb) * low_x * high_y;
-					dbg += IGET_G(irgb) * low_x * high_y;
-					dbb += IGET_B(irgb) * low_x * high_y;
-
-					irgb = si->pixel[(int)(ceil(ix) + ceil(iy) * si->xres * sdl_scale)];
-
-					if (st->c1 || st->c2 || st->c3) {
-						irgb = sdl_colorize_pix2(irgb, st->c1, st->c2, st->c3, (int)ceil(ix), (int)ceil(iy), si->xres,
-						    si->yres, si->pixel, (int)st->sprite);
-					}
-					dba += IGET_A(irgb) * high_x * high_y;
-					dbr += IGET_R(irgb) * high_x * high_y;
-					dbg += IGET_G(irgb) * high_x * high_y;
-					dbb += IGET_B(irgb) * high_x * high_y;
-
-					irgb = IRGBA((int)dbr, (int)dbg, (int)dbb, (int)dba);
+		// Scale first, colorizing every source pixel only once, then apply
+		// the effects to the scaled pixels in place
+		if (scale != 100) {
+			int sw = si->xres * sdl_scale, sh = si->yres * sdl_scale;
+			uint32_t *tmp = NULL;
 
+			if (st->c1 || st->c2 || st->c3) {
+				tmp = MALLOC((size_t)sw * (size_t)sh * sizeof(uint32_t));
+				if (tmp) {
+					sdl_colorize_image(tmp, si, st);
 				} else {
-					irgb = si->pixel[x + y * si->xres * sdl_scale];
-					if (st->c1 || st->c2 || st->c3) {
-						irgb = sdl_colorize_pix2(
-						    irgb, st->c1, st->c2, st->c3, x, y, si->xres, si->yres, si->pixel, (int)st->sprite);
-					}
-				}
-
-				if (st->cr || st->cg || st->cb || st->light || st->sat) {
-					irgb = sdl_colorbalance(
-					    irgb, (char)st->cr, (char)st->cg, (char)st->cb, (char)st->light, (char)st->sat);
-				}
-				if (st->shine) {
-					irgb = sdl_shine_pix(irgb, st->shine);
-				}
-
-				if (dropalpha) {
-					if (IGET_A(irgb) < 255) {
-						irgb = 0;
-					}
-				}
-
-				if (st->ll != st->ml || st->rl != st->ml || st->ul != st->ml || st->dl != st->ml) {
-					int r, g, b, a;
-					int r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0;
-					int g1 = 0, g2 = 0, g3 = 0, g4 = 0, g5 = 0;
-					int b1 = 0, b2 = 0, b3 = 0, b4 = 0, b5 = 0;
-					int v1, v2, v3, v4, v5 = 0;
-					int div;
-
-
-					if (y < 10 * sdl_scale + (20 * sdl_scale - abs(20 * sdl_scale - x)) / 2) {
-						// This part calculates a floor tile, or the top of a wall tile
-						if (x / 2 < 20 * sdl_scale - y) {
-							v2 = -(x / 2 - (20 * sdl_scale - y));
-							r2 = IGET_R(sdl_light(st->ll, irgb));
-							g2 = IGET_G(sdl_light(st->ll, irgb));
-							b2 = IGET_B(sdl_light(st->ll, irgb));
-						} else {
-							v2 = 0;
-						}
-						if (x / 2 > 20 * sdl_scale - y) {
-							v3 = (x / 2 - (20 * sdl_scale - y));
-							r3 = IGET_R(sdl_light(st->rl, irgb));
-							g3 = IGET_G(sdl_light(st->rl, irgb));
-							b3 = IGET_B(sdl_light(st->rl, irgb));
-						} else {
-							v3 = 0;
-						}
-						if (x / 2 > y) {
-							v4 = (x / 2 - y);
-							r4 = IGET_R(sdl_light(st->ul, irgb));
-							g4 = IGET_G(sdl_light(st->ul, irgb));
-							b4 = IGET_B(sdl_light(st->ul, irgb));
-						} else {
-							v4 = 0;
-						}
-						if (x / 2 < y) {
-							v5 = -(x / 2 - y);
-							r5 = IGET_R(sdl_light(st->dl, irgb));
-							g5 = IGET_G(sdl_light(st->dl, irgb));
-							b5 = IGET_B(sdl_light(st->dl, irgb));
-						} else {
-							v5 = 0;
-						}
-
-						v1 = 20 * sdl_scale - (v2 + v3 + v4 + v5);
-						r1 = IGET_R(sdl_light(st->ml, irgb));
-						g1 = IGET_G(sdl_light(st->ml, irgb));
-						b1 = IGET_B(sdl_light(st->ml, irgb));
-					} else {
-						// This is for the lower part (left side and front as seen on the screen)
-						if (x < 10 * sdl_scale) {
-							v2 = 10 * sdl_scale - x;
-							r2 = IGET_R(sdl_light(st->ll, irgb));
-							g2 = IGET_G(sdl_light(st->ll, irgb));
-							b2 = IGET_B(sdl_light(st->ll, irgb));
-						} else {
-							v2 = 0;
-						}
-
-						if (x > 10 * sdl_scale && x < 20 * sdl_scale) {
-							v3 = x - 10 * sdl_scale;
-							r3 = IGET_R(sdl_light(st->rl, irgb));
-							g3 = IGET_G(sdl_light(st->rl, irgb));
-							b3 = IGET_B(sdl_light(st->rl, irgb));
-						} else {
-							v3 = 0;
-						}
-
-						if (x >= 20 * sdl_scale && x < 30 * sdl_scale) {
-							v5 = 30 * sdl_scale - x;
-							r5 = IGET_R(sdl_light(st->dl, irgb));
-							g5 = IGET_G(sdl_light(st->dl, irgb));
-							b5 = IGET_B(sdl_light(st->dl, irgb));
-						} else {
-							v5 = 0;
-						}
-
-						if (x > 30 * sdl_scale && x < 40 * sdl_scale) {
-							v4 = x - 30 * sdl_scale;
-							r4 = IGET_R(sdl_light(st->ul, irgb));
-							g4 = IGET_G(sdl_light(st->ul, irgb));
-							b4 = IGET_B(sdl_light(st->ul, irgb));
-						} else {
-							v4 = 0;
-						}
-
-						v1 = 20 * sdl_scale - v2 - v3 - v4 - v5;
-
-						r1 = IGET_R(sdl_light(st->ml, irgb));
-						g1 = IGET_G(sdl_light(st->ml, irgb));
-						b1 = IGET_B(sdl_light(st->ml, irgb));
-					}
-
-					div = v1 + v2 + v3 + v4 + v5;
-
-					if (div == 0) {
-						a = 0;
-						r = g = b = 0;
-					} else {
-						a = IGET_A(irgb);
-						r = (r1 * v1 + r2 * v2 + r3 * v3 + r4 * v4 + r5 * v5) / div;
-						g = (g1 * v1 + g2 * v2 + g3 * v3 + g4 * v4 + g5 * v5) / div;
-						b = (b1 * v1 + b2 * v2 + b3 * v3 + b4 * v4 + b5 * v5) / div;
-					}
-
-					irgb = IRGBA(r, g, b, a);
-
-				} else {
-					irgb = sdl_light(st->ml, irgb);
+					warn("cannot colorize scaled sprite %d: out of memory", st->sprite);
 				}
+			}
+			sdl_resample(
+			    st->pixel, st->xres * sdl_scale, st->yres * sdl_scale, tmp ? tmp : si->pixel, sw, sh, scale);
+			if (tmp) {
+				FREE(tmp);
+			}
+		}
 
-				if (sink) {
-					if (st->yres * sdl_scale - sink * sdl_scale < y) {
-						irgb &= 0xffffff; // zero alpha to make it transparent
-					}
-				}
+		// Colorize reads the neighbours in si->pixel, so it can't run in place
+		src = si->pixel;
+		if (scale != 100) {
+			src = st->pixel;
+		} else if (st->c1 || st->c2 || st->c3) {
+			sdl_colorize_image(st->pixel, si, st);
+			src = st->pixel;
+		}
 
-				if (st->freeze) {
-					irgb = sdl_freeze(st->freeze, irgb);
-				}
+		sdl_fx_prepare(&fx, st, sink, dropalpha);
+		sdl_fx_apply(&fx, st->pixel, src, st->xres * sdl_scale, st->yres * sdl_scale);
 
-				st->pixel[x + y * st->xres * sdl_scale] = irgb;
-			}
-		}
 		uint16_t *flags_ptr = (uint16_t *)&st->flags;
 		__atomic_fetch_or(flags_ptr, SF_DIDMAKE, __ATOMIC_RELEASE);
 
@@ -1107,18 +1351,31 @@ void sdl_make(struct sdl_texture *st, struct sdl_image *si, int preload)
 #endif
 
 		if (st->xres > 0 && st->yres > 0) {
-			texture = SDL_CreateTexture(
-			    sdlren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, st->xres * sdl_scale, st->yres * sdl_scale);
-			if (!texture) {
-				warn("SDL_texture Error: %s in sprite %d (%s, %d,%d) preload=%d", SDL_GetError(), st->sprite, st->text,
-				    st->xres, st->yres, preload);
-				return;
+			int w = st->xres * sdl_scale, h = st->yres * sdl_scale;
+			int pitch = (int)((size_t)w * sizeof(uint32_t));
+
+			// Small sprites go into a shared atlas page, see sdl_atlas_alloc()
+			st->atlas = (int16_t)sdl_atlas_alloc(w, h, &st->atlas_x, &st->atlas_y);
+			if (st->atlas != ATLAS_NONE) {
+				SDL_Rect rc = {st->atlas_x, st->atlas_y, w, h};
+				texture = sdl_atlas[st->atlas].tex;
+				SDL_UpdateTexture(texture, &rc, st->pixel, pitch);
+			} else {
+				texture = SDL_CreateTexture(sdlren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+				if (!texture) {
+					warn("SDL_texture Error: %s in sprite %d (%s, %d,%d) preload=%d", SDL_GetError(), st->sprite,
+					    st->text, st->xres, st->yres, preload);
+					return;
+				}
+				SDL_UpdateTexture(texture, NULL, st->pixel, pitch);
+				SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+			}
+			// Update memory accounting when texture is actually created (at full sdl_scale size).
+			// Atlas pages are counted as a whole when they are made, see sdl_atlas_alloc().
+			if (st->atlas == ATLAS_NONE) {
+				st->mem = (uint32_t)((size_t)w * (size_t)h * sizeof(uint32_t));
+				__atomic_add_fetch(&mem_tex, st->mem, __ATOMIC_RELAXED);
 			}
-			SDL_UpdateTexture(texture, NULL, st->pixel, (int)(st->xres * sizeof(uint32_t) * (size_t)sdl_scale));
-			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
-			// Update memory accounting when texture is actually created
-			extern long long mem_tex;
-			__atomic_add_fetch(&mem_tex, st->xres * st->yres * sizeof(uint32_t), __ATOMIC_RELAXED);
 		} else {
 			texture = NULL;
 		}
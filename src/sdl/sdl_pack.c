@@ -0,0 +1,323 @@
+/*
+ * Part of Astonia Client (c) Daniel Brockhaus. Please read license.txt.
+ *
+ * SDL - Sprite Pack Module
+ *
+ * Loads sprite images from the pre-decoded packs built by mkpack instead of
+ * inflating and decoding PNGs from the zip archives. A pack is mapped into
+ * memory once and shared by all threads, so loading a sprite is a binary
+ * search and a copy. See sdl_pack.h for the file format.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dll.h"
+#include "astonia.h"
+#include "sdl/sdl.h"
+#include "sdl/sdl_private.h"
+#include "sdl/sdl_pack.h"
+
+static struct sdl_mapping pack_map[2]; // PACK_STD, PACK_HIRES
+static const struct sdl_pack_header *pack_head[2];
+static const struct sdl_pack_entry *pack_index[2];
+
+// Map filename read-only. Returns 1 on success, 0 if it doesn't exist or is empty.
+int sdl_map_file(struct sdl_mapping *m, const char *filename)
+{
+	memset(m, 0, sizeof(*m));
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	HANDLE file, map;
+
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+		CloseHandle(file);
+		return 0;
+	}
+	map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!map) {
+		CloseHandle(file);
+		return 0;
+	}
+	m->base = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	if (!m->base) {
+		CloseHandle(map);
+		CloseHandle(file);
+		return 0;
+	}
+	m->data = m->base;
+	m->size = (size_t)size.QuadPart;
+	m->file = file;
+	m->map = map;
+#else
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd == -1) {
+		return 0;
+	}
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return 0;
+	}
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return 0;
+	}
+	m->base = data;
+	m->data = data;
+	m->size = (size_t)st.st_size;
+#endif
+	return 1;
+}
+
+void sdl_unmap_file(struct sdl_mapping *m)
+{
+	if (!m->base) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(m->base);
+	CloseHandle(m->map);
+	CloseHandle(m->file);
+#else
+	munmap(m->base, m->size);
+#endif
+	memset(m, 0, sizeof(*m));
+}
+
+// The archives the pack was built from must not have changed since
+static int pack_current(const struct sdl_pack_header *ph)
+{
+	for (int i = 0; i < PACK_SOURCES; i++) {
+		const struct sdl_pack_source *src = &ph->source[i];
+		SDL_PathInfo info;
+		int64_t size = -1, mtime = 0;
+		char name[sizeof(src->name) + 1];
+
+		memcpy(name, src->name, sizeof(src->name));
+		name[sizeof(src->name)] = 0;
+		if (!name[0]) {
+			continue;
+		}
+		if (SDL_GetPathInfo(name, &info)) {
+			size = (int64_t)info.size;
+			mtime = (int64_t)SDL_NS_TO_SECONDS(info.modify_time);
+		}
+		if (size != src->size || (size != -1 && mtime != src->mtime)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Use the pack in filename for the standard (hires=0) or the high res
+// (hires=1) sprites. Returns 1 if it is valid.
+int sdl_pack_open(int hires, const char *filename)
+{
+	struct sdl_mapping *m = &pack_map[hires];
+	const struct sdl_pack_header *ph;
+
+	sdl_unmap_file(m);
+	pack_head[hires] = NULL;
+	pack_index[hires] = NULL;
+
+	if (!sdl_map_file(m, filename)) {
+		return 0;
+	}
+	ph = (const struct sdl_pack_header *)m->data;
+
+	if (m->size < sizeof(*ph) || ph->magic != PACK_MAGIC || ph->version != PACK_VERSION ||
+	    ph->scale != (uint32_t)(hires ? sdl_scale : 1) ||
+	    (m->size - sizeof(*ph)) / sizeof(struct sdl_pack_entry) < ph->count) {
+		warn("%s is not a valid sprite pack for this client", filename);
+		sdl_unmap_file(m);
+		return 0;
+	}
+	if (!pack_current(ph)) {
+		note("%s is older than the archives it was built from, not using it", filename);
+		sdl_unmap_file(m);
+		return 0;
+	}
+
+	pack_head[hires] = ph;
+	pack_index[hires] = (const struct sdl_pack_entry *)(m->data + sizeof(*ph));
+	note("Using sprite pack %s (%u sprites)", filename, ph->count);
+
+	return 1;
+}
+
+void sdl_pack_init(void)
+{
+	char filename[80];
+
+	sdl_pack_open(0, "res/gx1.pak");
+	if (sdl_scale > 1) {
+		snprintf(filename, sizeof(filename), "res/gx%d.pak", sdl_scale);
+		sdl_pack_open(1, filename);
+	}
+}
+
+void sdl_pack_exit(void)
+{
+	for (int i = 0; i < 2; i++) {
+		sdl_unmap_file(&pack_map[i]);
+		pack_head[i] = NULL;
+		pack_index[i] = NULL;
+	}
+}
+
+// Is there a pack for the standard (hires=0) or high res (hires=1) sprites?
+// If so, it replaces the archives for them.
+int sdl_pack_available(int hires)
+{
+	return pack_head[hires] != NULL;
+}
+
+static const struct sdl_pack_entry *pack_find(int hires, unsigned int sprite)
+{
+	const struct sdl_pack_entry *idx = pack_index[hires];
+	uint32_t lo = 0, hi = pack_head[hires]->count;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (idx[mid].sprite < sprite) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo < pack_head[hires]->count && idx[lo].sprite == sprite) {
+		return &idx[lo];
+	}
+	return NULL;
+}
+
+// Unpack size bytes of PACK_RLE data into n pixels. Returns -1 if the data
+// doesn't fit.
+static int pack_unrle(uint32_t *dst, size_t n, const unsigned char *src, size_t size)
+{
+	size_t pos = 0;
+	uint32_t run[2];
+
+	while (pos < n) {
+		if (size < sizeof(run)) {
+			return -1;
+		}
+		memcpy(run, src, sizeof(run));
+		src += sizeof(run);
+		size -= sizeof(run);
+
+		if ((!run[0] && !run[1]) || run[0] > n - pos || run[1] > n - pos - run[0] ||
+		    run[1] > size / sizeof(uint32_t)) {
+			return -1;
+		}
+		memset(dst + pos, 0, run[0] * sizeof(uint32_t));
+		pos += run[0];
+		memcpy(dst + pos, src, run[1] * sizeof(uint32_t));
+		pos += run[1];
+		src += run[1] * sizeof(uint32_t);
+		size -= run[1] * sizeof(uint32_t);
+	}
+	return 0;
+}
+
+// Blow xres x yres pixels at the start of pixel up by scale, in place.
+// Working backwards never overwrites a pixel that is still needed.
+static void pack_upscale(uint32_t *pixel, int xres, int yres, int scale)
+{
+	int w = xres * scale;
+
+	for (int y = yres - 1; y >= 0; y--) {
+		for (int x = xres - 1; x >= 0; x--) {
+			uint32_t c = pixel[x + y * xres];
+			for (int dy = scale - 1; dy >= 0; dy--) {
+				for (int dx = scale - 1; dx >= 0; dx--) {
+					pixel[x * scale + dx + (y * scale + dy) * w] = c;
+				}
+			}
+		}
+	}
+}
+
+// Load sprite from the standard or high res pack into si, like
+// sdl_load_image_png() or sdl_load_image_png_() would. Returns -1 if the
+// pack doesn't have it.
+int sdl_pack_load(struct sdl_image *si, unsigned int sprite, int hires, int smoothify)
+{
+	const struct sdl_pack_entry *pe;
+	const unsigned char *data;
+	size_t n, total;
+	int scale;
+
+	if (!pack_head[hires] || !(pe = pack_find(hires, sprite))) {
+		return -1;
+	}
+	if (pe->offset > pack_map[hires].size || pe->size > pack_map[hires].size - pe->offset) {
+		warn("sprite pack entry %u is damaged", sprite);
+		return -1;
+	}
+	data = pack_map[hires].data + pe->offset;
+
+	scale = (int)pack_head[hires]->scale;
+	n = (size_t)pe->xres * pe->yres * (size_t)scale * (size_t)scale;
+	total = (size_t)pe->xres * pe->yres * (size_t)sdl_scale * (size_t)sdl_scale;
+
+#ifdef SDL_FAST_MALLOC
+	si->pixel = MALLOC(total * sizeof(uint32_t));
+#else
+	si->pixel = xmalloc(total * sizeof(uint32_t), MEM_SDL_PNG);
+#endif
+	if (!si->pixel && total) {
+		return -1;
+	}
+
+	if (pe->method == PACK_RAW && pe->size == n * sizeof(uint32_t)) {
+		memcpy(si->pixel, data, n * sizeof(uint32_t));
+	} else if (pe->method != PACK_RLE || pack_unrle(si->pixel, n, data, pe->size) < 0) {
+		warn("sprite pack entry %u is damaged", sprite);
+#ifdef SDL_FAST_MALLOC
+		FREE(si->pixel);
+#else
+		xfree(si->pixel);
+#endif
+		si->pixel = NULL;
+		return -1;
+	}
+
+	extern long long mem_png;
+	si->mem = (uint32_t)(total * sizeof(uint32_t));
+	__atomic_add_fetch(&mem_png, (long long)si->mem, __ATOMIC_RELAXED);
+
+	si->flags = 1;
+	si->xres = pe->xres;
+	si->yres = pe->yres;
+	si->xoff = pe->xoff;
+	si->yoff = pe->yoff;
+
+	if (scale < sdl_scale) {
+		pack_upscale(si->pixel, si->xres, si->yres, sdl_scale);
+		if (smoothify) {
+			sdl_smoothify(si->pixel, si->xres * sdl_scale, si->yres * sdl_scale, sdl_scale);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * Part of Astonia Client (c) Daniel Brockhaus. Please read license.txt.
+ *
+ * Sprite pack file format
+ *
+ * A sprite pack holds the images of one gx*.zip set (base, patch and mod
+ * archive) already decoded and cropped, as sdl_load_image() would make them
+ * from the PNGs. It is written by mkpack (src/helper/mkpack.c) and mapped
+ * into memory by the client (src/sdl/sdl_pack.c).
+ *
+ * Layout: header, count entries sorted by sprite, then the pixel data. All
+ * values are little endian.
+ */
+
+#ifndef SDL_PACK_H
+#define SDL_PACK_H
+
+#include <stdint.h>
+
+#define PACK_MAGIC   0x314b5041 // "APK1"
+#define PACK_VERSION 1
+#define PACK_SOURCES 3 // mod, patch and base archive, in the order they are searched
+
+#define PACK_RAW 0 // xres * yres * scale * scale ARGB pixels
+#define PACK_RLE 1 // pairs of uint32 (transparent, copied), each followed by the copied pixels
+
+// Archive the pack was built from. The pack is out of date if the archive
+// size or time changed. An empty name is not checked.
+struct sdl_pack_source {
+	char name[64];
+	int64_t size; // -1 if the archive did not exist
+	int64_t mtime; // seconds since 1970
+};
+
+struct sdl_pack_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t scale; // 1 for gx1, else the sdl_scale the sprites are for
+	uint32_t count;
+	struct sdl_pack_source source[PACK_SOURCES];
+};
+
+struct sdl_pack_entry {
+	uint64_t offset; // from the start of the file
+	uint32_t sprite;
+	uint32_t size; // bytes at offset
+	uint16_t xres, yres; // in sprite pixels, the data has scale times as many in each direction
+	int16_t xoff, yoff;
+	uint8_t method; // PACK_RAW or PACK_RLE
+	uint8_t reserved[7];
+};
+
+#endif
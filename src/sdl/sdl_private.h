@@ -12,12 +12,25 @@
 #include <SDL3_mixer/SDL_mixer.h>
 
 // Fixed upper bound for the texture cache metadata.
-// Statically allocated at compile time
-#define MAX_TEXCACHE 8000
-#define MAX_TEXHASH  8000
+// Statically allocated at compile time. How many of these slots are in use
+// (sdlt_slots) follows the byte budget sdl_cache_budget at runtime.
+#define MAX_TEXCACHE 32768
+#define MIN_TEXCACHE 1000
+// Hash buckets for sdlt_cache[]: the largest prime below MAX_TEXCACHE, so a
+// full table averages one entry per chain and every bit of the hash counts
+#define MAX_TEXHASH 32749
 
 #define STX_NONE (-1)
 
+// The texture cache LRU is segmented: new entries (including everything a
+// prefetch brings in) start on probation, entries drawn again move to the
+// protected list. Eviction takes from probation first, so a one-off scan
+// can't push out what is drawn every frame.
+#define TX_LRU_PROBATION     0
+#define TX_LRU_PROTECTED     1
+#define TX_LRU_LISTS         2
+#define TX_PROTECTED_PERCENT 75 // Max share of the slots on the protected list
+
 #define IGET_A(c)         ((((uint32_t)(c)) >> 24) & 0xFF)
 #define IGET_R(c)         ((((uint32_t)(c)) >> 16) & 0xFF)
 #define IGET_G(c)         ((((uint32_t)(c)) >> 8) & 0xFF)
@@ -32,6 +45,39 @@
 #define SF_DIDMAKE  (1 << 4)
 #define SF_DIDTEX   (1 << 5)
 
+// Light level at which sdl_light() leaves the colours unchanged
+#define TX_LIGHT_NORMAL 15
+
+// Sprite atlas: small sprites are uploaded into shared pages instead of
+// getting their own texture, so that sprites next to each other in the draw
+// order can be drawn with one SDL_RenderGeometry() call. A page is cut into
+// cells of one size class (powers of two from ATLAS_MIN_CELL to
+// ATLAS_MAX_CELL, independent in x and y). All sizes in texture pixels.
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MIN_CELL  16
+#define ATLAS_MAX_CELL  256 // Larger sprites get their own texture
+#define ATLAS_MAX_PAGES 64
+#define ATLAS_MAX_CELLS ((ATLAS_PAGE_SIZE / ATLAS_MIN_CELL) * (ATLAS_PAGE_SIZE / ATLAS_MIN_CELL))
+#define ATLAS_NONE      (-1)
+#define BATCH_MAX_QUADS 1024 // Quads collected before sdl_batch_flush() has to draw
+
+// Text is drawn as quads from a glyph atlas per font variant, see
+// sdl_drawtext(). Strings of TEXT_CACHE_LEN or more characters still get a
+// texture of their own in the texture cache, one quad instead of many.
+#define TEXT_GLYPHS    128 // Characters in a font
+#define TEXT_ATLAS_MAX 16
+#define TEXT_CACHE_LEN 64
+#define TEXT_QUADS     64 // Glyph quads collected before they go to the batch
+
+// Pixels, lines and rectangles become untextured quads in the same batch
+#define PRIM_QUADS 32 // Quads collected before they go to the batch
+
+// Bless and rain particles come from a small atlas, see sdl_particle()
+#define PARTICLE_SHAPES 2
+#define PARTICLE_LAYERS 3 // Colour brightened by 0, 32 or 64
+#define PARTICLE_SIZE   7 // Particles are up to 7x7 screen pixels
+#define PARTICLE_CELL   8 // Atlas cell, with a gap to the next one
+
 // Texture job work state enum
 typedef enum texture_work_state {
 	TX_WORK_IDLE = 0, // no job queued, no worker running
@@ -45,14 +91,23 @@ struct sdl_texture {
 
 	int prev, next;
 	int hprev, hnext;
+	int used_frame; // sdl_frames when last moved to the LRU head
+	uint8_t lru; // TX_LRU_PROBATION or TX_LRU_PROTECTED, the list prev/next belong to
+	// Light levels this entry was drawn with (bit 0 = mixed directional light).
+	// More than one bit means variants share the entry, see texc_collapsed.
+	uint16_t light_seen;
 
 	_Atomic(uint16_t) flags; // Atomic for lock-free reads, writes under mutex
 
 
 	// Versioning and work state for robust job queue
 	uint32_t generation; // Incremented each time this slot is reused (eviction only)
-	// See texture_work_state_t; MUST be modified under g_tex_jobs.mutex
+	// See texture_work_state_t; only changed through the work_state_* helpers
 	_Atomic(uint8_t) work_state;
+	// Priority of the queued job (SDL_PRE_*), valid while TX_WORK_QUEUED
+	uint8_t priority;
+	// Set once the render thread gave up waiting for this entry and said so
+	uint8_t wait_warned;
 
 	// ---------- sprites ------------
 	// fx
@@ -73,6 +128,13 @@ struct sdl_texture {
 	int16_t xoff; // offset to blit position
 	int16_t yoff; // offset to blit position
 
+	// Atlas page holding the sprite (tex is the page texture), or ATLAS_NONE
+	// if tex is its own. atlas_x, atlas_y is its cell in texture pixels.
+	int16_t atlas;
+	uint16_t atlas_x, atlas_y;
+	uint8_t alpha; // Set by sdl_tex_alpha(), atlas pages are shared so it is applied per vertex
+	uint32_t mem; // Bytes of tex counted in mem_tex, taken off again on eviction
+
 	// ---------- text --------------
 	uint16_t text_flags;
 	uint32_t text_color;
@@ -80,16 +142,59 @@ struct sdl_texture {
 	void *text_font;
 };
 
+struct sdl_atlas_page {
+	SDL_Texture *tex; // NULL if the page is not in use
+	uint16_t cell_w, cell_h;
+	int used; // cells in use, the page is destroyed when this drops to 0
+	uint64_t cells[ATLAS_MAX_CELLS / 64]; // one bit per cell in use
+};
+
+// sdli_state[] values. A loaded image can be evicted again by sdl_ic_trim(),
+// which goes READY -> UNLOADING -> UNLOADED; xres and yres stay valid.
+#define IMG_UNLOADED  0
+#define IMG_LOADING   1
+#define IMG_READY     2
+#define IMG_FAILED    3
+#define IMG_UNLOADING 4
+
 struct sdl_image {
 	uint32_t *pixel;
+	uint8_t *cmask; // Colorize mask, made by the first sdl_colorize_image() that needs it
+	uint32_t mem; // Bytes of pixel and cmask, counted in mem_png
 
 	uint16_t flags;
 	uint16_t xres, yres;
 	int16_t xoff, yoff;
+
+	int pins; // Users between sdl_ic_get() and sdl_ic_put(), the image isn't evicted while > 0
+	int lru_prev, lru_next; // Loaded images, most recently used first, -1 at the ends
+	int used_frame; // sdl_frames of the last sdl_ic_get()
+};
+
+// Effects sdl_make() applies after scaling and colorizing, set up once per
+// texture by sdl_fx_prepare() to pick a kernel for just those
+#define FX_BALANCE   (1 << 0) // sdl_colorbalance()
+#define FX_SHINE     (1 << 1)
+#define FX_DROPALPHA (1 << 2)
+#define FX_DIRLIGHT  (1 << 3) // ll, rl, ul, dl differ from ml
+#define FX_FREEZE    (1 << 4) // only with FX_DIRLIGHT, else it is in chan[]
+#define FX_GENERIC   (1 << 5) // light overflows a channel, use sdl_fx_generic()
+
+struct sdl_fx {
+	const struct sdl_texture *st;
+	unsigned int flags;
+	int sink_y; // rows from here on get zero alpha
+	int linear; // uniform light is v * linear / 15 in every channel, 0 if not
+	uint8_t light[5][256]; // sdl_light() of one channel for ml, ll, rl, ul, dl
+	uint8_t chan[3][256]; // uniform light plus freeze for r, g, b
 };
 
 // Texture job queue structures
-#define TEX_JOB_CAPACITY 16384 // Large enough to handle all texture cache entries
+// Jobs are spread over TEX_JOB_QUEUES per-worker queues; worker N owns queue
+// N % TEX_JOB_QUEUES and steals from the others once its own runs dry.
+#define TEX_JOB_QUEUES         16
+#define TEX_JOB_QUEUE_CAPACITY 2048 // per queue and priority, must be a power of two
+#define TEX_JOB_BATCH          4 // max jobs a worker takes per lock
 
 // Texture job kind - makes the job semantics explicit
 typedef enum texture_job_kind {
@@ -98,22 +203,65 @@ typedef enum texture_job_kind {
 	// Room for future job types (TEXTURE_JOB_FREE, TEXTURE_JOB_RELOAD, etc.)
 } texture_job_kind_t;
 
+// One ring per priority level (SDL_PRE_NOW .. SDL_PRE_SPECULATIVE, see sdl.h)
+#define TEX_JOB_PRIORITIES 3
+
 typedef struct texture_job {
 	int cache_index; // index into sdlt[]
 	uint32_t generation; // snapshot of sdlt[cache_index].generation
 	texture_job_kind_t kind; // what operation to perform
 } texture_job_t;
 
-typedef struct texture_job_queue {
-	texture_job_t jobs[TEX_JOB_CAPACITY];
+typedef struct texture_job_ring {
+	texture_job_t jobs[TEX_JOB_QUEUE_CAPACITY];
 	int head; // pop position
 	int tail; // push position
-	int count; // number of jobs in queue
+	int count; // number of jobs in this ring
+} texture_job_ring_t;
+
+typedef struct texture_worker_queue {
+	SDL_Mutex *mutex; // protects rings; only ever held for a push or one batch pop
+	texture_job_ring_t rings[TEX_JOB_PRIORITIES];
+	_Atomic(int) count; // jobs in all rings, readable without the lock
+} texture_worker_queue_t;
 
-	SDL_Mutex *mutex;
-	SDL_Condition *cond;
+typedef struct texture_job_queue {
+	// Workers always take the most urgent priority that has jobs anywhere.
+	// A promoted job is pushed again at the higher priority; the stale copy
+	// left behind is skipped because the slot is no longer TX_WORK_QUEUED.
+	texture_worker_queue_t queues[TEX_JOB_QUEUES];
+	_Atomic(int) pending[TEX_JOB_PRIORITIES]; // jobs per priority in all queues
+	int next_queue; // round-robin push position, main thread only
+
+	// Completion signalling for the render thread (the only waiter).
+	// The waiter publishes the (slot, generation) it blocks on; a worker that
+	// finishes exactly that job signals done_cond under done_mutex.
+	SDL_Mutex *done_mutex;
+	SDL_Condition *done_cond;
+	_Atomic(int) wait_index; // STX_NONE when nobody waits
+	uint32_t wait_generation;
 } texture_job_queue_t;
 
+// Ready queue: cache entries whose CPU work (stages 1+2) is done and that are
+// waiting for the main thread to upload them (stage 3).
+// Lock-free bounded MPSC ring: workers push, only the main thread pops.
+// Must be a power of two. Sized above MAX_TEXCACHE so that a push only fails
+// if many slots are evicted and refilled between two drains; a dropped entry
+// is still uploaded on demand by tex_entry_ensure_ready().
+#define TEX_READY_CAPACITY 65536
+
+typedef struct texture_ready {
+	_Atomic(uint32_t) seq; // cell sequence number (see tex_ready_push/pop)
+	int cache_index; // index into sdlt[]
+	uint32_t generation; // snapshot of sdlt[cache_index].generation
+} texture_ready_t;
+
+typedef struct texture_ready_queue {
+	texture_ready_t cells[TEX_READY_CAPACITY];
+	_Atomic(uint32_t) tail; // push position, claimed by producers with CAS
+	uint32_t head; // pop position, main thread only
+} texture_ready_queue_t;
+
 // Lock-free flag operation helpers
 // These provide consistent atomic ordering across all SDL modules
 // Must be defined after struct sdl_texture is complete
@@ -124,8 +272,9 @@ static inline uint16_t flags_load(struct sdl_texture *st)
 }
 
 // Work state load helper
-// Can be called without mutex for diagnostic reads, but any decision based on
-// the value that affects eviction or queue state MUST be done under mutex.
+// The render thread owns IDLE -> QUEUED; workers only ever move a slot
+// QUEUED -> IN_WORKER (by CAS) and IN_WORKER -> IDLE. So once the render
+// thread sees TX_WORK_IDLE, no worker will touch the slot until it queues it.
 static inline uint8_t work_state_load(struct sdl_texture *st)
 {
 	uint8_t *state_ptr = (uint8_t *)&st->work_state;
@@ -133,14 +282,25 @@ static inline uint8_t work_state_load(struct sdl_texture *st)
 }
 
 // Work state store helper
-// Caller MUST hold g_tex_jobs.mutex.
-// Stores are always coordinated with queue state changes under the mutex.
+// Only for the transitions owned by the caller (see work_state_load).
 static inline void work_state_store(struct sdl_texture *st, texture_work_state_t new_state)
 {
 	uint8_t *state_ptr = (uint8_t *)&st->work_state;
 	__atomic_store_n(state_ptr, (uint8_t)new_state, __ATOMIC_RELEASE);
 }
 
+// Work state claim helper
+// Atomically moves the slot from expected to new_state. Returns 1 on success,
+// 0 if another thread changed the state first.
+static inline int work_state_claim(
+    struct sdl_texture *st, texture_work_state_t expected, texture_work_state_t new_state)
+{
+	uint8_t *state_ptr = (uint8_t *)&st->work_state;
+	uint8_t old_state = (uint8_t)expected;
+	return __atomic_compare_exchange_n(
+	    state_ptr, &old_state, (uint8_t)new_state, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
 #ifndef HAVE_DDFONT
 #define HAVE_DDFONT
 
@@ -152,21 +312,51 @@ struct renderfont {
 
 #define RENDER_TEXT_TERMINATOR '\xB0' // draw text terminator - (zero stays one, too)
 
-struct zip_handles {
-	zip_t *zip1;
-	zip_t *zip2;
-	zip_t *zip1p;
-	zip_t *zip2p;
-	zip_t *zip1m;
-	zip_t *zip2m;
+// A file mapped read-only into memory, see sdl_map_file()
+struct sdl_mapping {
+	const unsigned char *data;
+	size_t size;
+	void *base; // data as the system returned it, to unmap without casting away const
+	void *file, *map; // Windows handles
 };
 
-int sdl_ic_load(unsigned int sprite, struct zip_handles *zips);
+// A zip archive shared by all threads, see sdl_archive.c
+struct sdl_archive_entry {
+	uint32_t offset; // of the local header
+	uint32_t comp_size, size, crc;
+	uint32_t name; // offset of the name in the mapping
+	uint16_t name_len, method, flags;
+};
+
+struct sdl_archive {
+	struct sdl_mapping map;
+	uint32_t count;
+	struct sdl_archive_entry *entry;
+};
+
+// Contents of an archive entry, see sdl_archive_read()
+struct sdl_archive_file {
+	const unsigned char *data;
+	size_t size;
+	void *buf; // inflated data, NULL if data points into the mapping
+};
+
+// Graphics archives: [0] gx1, [1] gx2..gx4 for sdl_scale
+#define GX_BASE    0
+#define GX_PATCH   1
+#define GX_MOD     2
+#define GX_SOURCES 3
+extern struct sdl_archive sdl_gx[2][GX_SOURCES];
+
+int sdl_ic_load(unsigned int sprite);
 int sdl_pre_backgnd(void *ptr);
 int sdl_create_cursors(void);
 SDL_Cursor *sdl_create_cursor(char *filename);
 void sdl_pre_add(unsigned int sprite, signed char sink, unsigned char freeze, unsigned char scale, char cr, char cg,
-    char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl);
+    char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl,
+    int priority);
+void sdl_pre_promote(int cache_index);
+int sdl_pre_help(int cache_index);
 void sdl_lock(void *a);
 int sdl_pre_do(void);
 
@@ -186,28 +376,37 @@ void png_load_helper_exit(struct png_helper *p);
 // ============================================================================
 extern SDL_Window *sdlwnd;
 extern SDL_Renderer *sdlren;
-extern zip_t *sdl_zip1;
-extern zip_t *sdl_zip2;
-extern zip_t *sdl_zip1p;
-extern zip_t *sdl_zip2p;
-extern zip_t *sdl_zip1m;
-extern zip_t *sdl_zip2m;
 extern SDL_Mutex *premutex;
 extern int *sdli_state; // Image loading state machine
 extern texture_job_queue_t g_tex_jobs; // Texture job queue
-extern int sdl_cache_size; // Requested size (for logging / config), not allocation
+extern texture_ready_queue_t g_tex_ready; // Finished jobs waiting for upload
+extern int sdl_cache_size; // Initial number of texture cache slots
+extern int sdl_cache_budget; // Texture cache budget in MB (0 = no limit)
+extern int sdl_image_budget; // Decoded image budget in MB (0 = no limit)
 
 // ============================================================================
 // Shared variables from sdl_texture.c
 // ============================================================================
 extern struct sdl_texture sdlt[MAX_TEXCACHE];
-extern int sdlt_best, sdlt_last;
+struct sdl_lru {
+	int best, last; // Head and tail, STX_NONE if empty
+	int count;
+};
+extern struct sdl_lru sdlt_lru[TX_LRU_LISTS];
+extern int sdlt_slots; // Slots currently linked into the LRU lists
 extern int sdlt_cache[MAX_TEXHASH];
 extern struct sdl_image *sdli;
 
 extern int texc_used;
 extern long long mem_png, mem_tex;
 extern long long texc_hit, texc_miss, texc_pre;
+extern long long texc_hits[TX_LRU_LISTS], texc_evicts[TX_LRU_LISTS];
+extern int texc_collapsed; // Cached variants that share an entry instead of having their own
+extern struct sdl_atlas_page sdl_atlas[ATLAS_MAX_PAGES];
+extern int sdl_atlas_pages; // Pages with a texture
+extern long long mem_atlas; // Texture memory of the atlas pages, also part of mem_tex
+extern long long atlas_blits, atlas_batches; // Atlas sprites drawn, and in how many draw calls
+extern long long dc_hits, dc_stores; // Sprites taken from and written to the disk cache
 
 extern long long sdl_time_preload;
 extern long long sdl_time_make;
@@ -227,13 +426,21 @@ extern int maxpanic;
 // ============================================================================
 // Internal functions from sdl_texture.c
 // ============================================================================
+void sdl_tx_init(void);
 void sdl_tx_best(int cache_index);
+void sdl_tx_trim(void);
 int sdl_tx_load(unsigned int sprite, signed char sink, unsigned char freeze, unsigned char scale, char cr, char cg,
     char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml, char ll, char rl, char ul, char dl,
     const char *text, int text_color, int text_flags, void *text_font, int checkonly, int preload);
 void tex_jobs_init(void);
 void tex_jobs_shutdown(void);
-int tex_jobs_pop(texture_job_t *out_job, int should_block);
+int tex_jobs_push(int cache_index, int priority);
+int tex_jobs_take(int worker_id, texture_job_t *out_jobs, int max_jobs);
+int tex_jobs_urgent(void);
+void tex_jobs_notify_done(int cache_index, uint32_t generation);
+int tex_jobs_wait_done(int cache_index, int timeout_ms);
+int tex_ready_push(int cache_index, uint32_t generation);
+int tex_ready_pop(int *out_cache_index, uint32_t *out_generation);
 
 #ifdef DEVELOPER
 void sdl_dump_spritecache(void);
@@ -244,34 +451,87 @@ void sdl_dump_spritecache(void);
 // ============================================================================
 uint32_t mix_argb(uint32_t c1, uint32_t c2, float w1, float w2);
 void sdl_smoothify(uint32_t *pixel, int xres, int yres, int scale);
+void sdl_resample(uint32_t *dst, int dw, int dh, const uint32_t *src, int sw, int sh, int scale);
 void png_helper_read(png_structp ps, png_bytep buf, png_size_t len);
-int sdl_load_image_png_(struct sdl_image *si, char *filename, zip_t *zip);
-int sdl_load_image_png(struct sdl_image *si, char *filename, zip_t *zip, int smoothify);
+int sdl_load_image_png_(struct sdl_image *si, char *filename, const struct sdl_archive *arch, int64_t index);
+int sdl_load_image_png(
+    struct sdl_image *si, char *filename, const struct sdl_archive *arch, int64_t index, int smoothify);
+void sdl_zip_index_init(void);
 int do_smoothify(int sprite);
-int sdl_load_image(struct sdl_image *si, int sprite, struct zip_handles *zips);
-int sdl_ic_load(unsigned int sprite, struct zip_handles *zips);
+int sdl_load_image(struct sdl_image *si, int sprite);
+int sdl_ic_load(unsigned int sprite);
+struct sdl_image *sdl_ic_get(unsigned int sprite);
+void sdl_ic_put(unsigned int sprite);
+void sdl_ic_trim(void);
+int sdl_make_pixels(struct sdl_texture *st);
 void sdl_make(struct sdl_texture *st, struct sdl_image *si, int preload);
 
 // ============================================================================
 // Internal functions from sdl_effects.c
 // ============================================================================
+void sdl_light_init(void);
+const uint8_t *sdl_light_table(int light);
 uint32_t sdl_light(int light, uint32_t irgb);
+float sdl_light_factor(int light);
 uint32_t sdl_freeze(int freeze, uint32_t irgb);
 uint32_t sdl_shine_pix(uint32_t irgb, unsigned short shine);
 uint32_t sdl_colorize_pix(uint32_t irgb, unsigned short c1v, unsigned short c2v, unsigned short c3v);
 uint32_t sdl_colorize_pix2(uint32_t irgb, unsigned short c1v, unsigned short c2v, unsigned short c3v, int x, int y,
     int xres, int yres, uint32_t *pixel, int sprite);
+void sdl_colorize_image(uint32_t *dst, struct sdl_image *si, const struct sdl_texture *st);
 uint32_t sdl_colorbalance(uint32_t irgb, char cr, char cg, char cb, char light, char sat);
+void sdl_fx_prepare(struct sdl_fx *fx, const struct sdl_texture *st, int sink, int dropalpha);
+void sdl_fx_apply(const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int w, int h);
+void sdl_fx_generic(const struct sdl_fx *fx, uint32_t *dst, const uint32_t *src, int w, int h);
 
 // ============================================================================
-// Internal functions from sdl_draw.c
+// Internal functions from sdl_atlas.c
 // ============================================================================
-SDL_Texture *sdl_maketext(const char *text, struct renderfont *font, uint32_t color, int flags);
+void sdl_atlas_init(void);
+void sdl_atlas_exit(void);
+int sdl_atlas_alloc(int w, int h, uint16_t *x, uint16_t *y);
+void sdl_atlas_free(int page, int x, int y);
+
+// ============================================================================
+// Internal functions from sdl_diskcache.c
+// ============================================================================
+int sdl_dc_init(const char *filename, int megabytes);
+void sdl_dc_exit(void);
+int sdl_dc_fetch(struct sdl_texture *st);
+void sdl_dc_store(struct sdl_texture *st);
+
+// ============================================================================
+// Internal functions from sdl_pack.c
+// ============================================================================
+int sdl_map_file(struct sdl_mapping *m, const char *filename);
+void sdl_unmap_file(struct sdl_mapping *m);
+int sdl_pack_open(int hires, const char *filename);
+void sdl_pack_init(void);
+void sdl_pack_exit(void);
+int sdl_pack_available(int hires);
+int sdl_pack_load(struct sdl_image *si, unsigned int sprite, int hires, int smoothify);
 
 // ============================================================================
-// Internal functions from sdl_core.c
+// Internal functions from sdl_archive.c
+// ============================================================================
+int sdl_archive_open(struct sdl_archive *a, const char *filename);
+void sdl_archive_close(struct sdl_archive *a);
+const char *sdl_archive_name(const struct sdl_archive *a, uint32_t i, int *len);
+int64_t sdl_archive_find(const struct sdl_archive *a, const char *name);
+int sdl_archive_read(const struct sdl_archive *a, uint32_t i, struct sdl_archive_file *f);
+void sdl_archive_release(struct sdl_archive_file *f);
+void sdl_archive_init(void);
+void sdl_archive_exit(void);
+
 // ============================================================================
-int if_single_thread_process_one_job(void);
+// Internal functions from sdl_draw.c
+// ============================================================================
+SDL_Texture *sdl_maketext(const char *text, struct renderfont *font, uint32_t color, int flags);
+void sdl_text_exit(void);
+void sdl_particle_exit(void);
+#define LIGHT_MESH_MAX_QUADS 64
+int sdl_light_mesh(const SDL_FRect *sr, float tex_w, float tex_h, const float *factor, float alpha,
+    SDL_Vertex *vertices, int *indices);
 
 // ============================================================================
 // Test-only functions (compiled only when UNIT_TEST is defined)
@@ -279,6 +539,14 @@ int if_single_thread_process_one_job(void);
 
 #ifdef UNIT_TEST
 
+// libzip handles of the graphics archives, for enumerating sprites in tests
+extern zip_t *sdl_zip1;
+extern zip_t *sdl_zip2;
+extern zip_t *sdl_zip1p;
+extern zip_t *sdl_zip2p;
+extern zip_t *sdl_zip1m;
+extern zip_t *sdl_zip2m;
+
 // Line clipping function (non-static for testing)
 int clip_line(int *x0, int *y0, int *x1, int *y1, int xmin, int ymin, int xmax, int ymax);
 
@@ -313,6 +581,7 @@ uint16_t sdl_texture_get_flags_for_test(int cache_index);
 int sdl_texture_get_sprite_for_test(int cache_index);
 uint8_t sdl_texture_get_work_state_for_test(int cache_index);
 int sdl_get_job_queue_depth_for_test(void);
+int sdl_get_ready_queue_depth_for_test(void);
 
 #endif /* UNIT_TEST */
 
@@ -13,15 +13,24 @@
 #include <SDL3/SDL.h>
 
 #include "../astonia.h" // Must come first for tick_t
+#include "sdl.h"
 #include "sdl_private.h"
 
 // Forward declarations for test-exposed functions
 extern SDL_AtomicInt worker_quit;
 extern SDL_Thread **worker_threads;
-extern struct zip_handles *worker_zips;
 extern int sdl_multi;
 extern SDL_Semaphore *prework;
 
+// libzip handles, only used by the tests to enumerate the sprites. The
+// client itself reads the archives through sdl_archive.c.
+zip_t *sdl_zip1 = NULL;
+zip_t *sdl_zip2 = NULL;
+zip_t *sdl_zip1p = NULL;
+zip_t *sdl_zip2p = NULL;
+zip_t *sdl_zip1m = NULL;
+zip_t *sdl_zip2m = NULL;
+
 // ============================================================================
 // State initialization helpers
 // ============================================================================
@@ -30,37 +39,13 @@ static void sdl_zero_state_for_tests(void)
 {
 	int i;
 
-	// Texture cache - reset to clean state
+	// Texture cache and hash table - reset to clean state
+	sdl_tx_init();
+
 	for (i = 0; i < MAX_TEXCACHE; i++) {
-		// Use atomic store for flags
-		uint16_t *flags_ptr = (uint16_t *)&sdlt[i].flags;
-		__atomic_store_n(flags_ptr, 0, __ATOMIC_RELAXED);
-
-		sdlt[i].tex = NULL;
-		sdlt[i].pixel = NULL;
-		sdlt[i].hnext = STX_NONE;
-		sdlt[i].hprev = STX_NONE;
-		sdlt[i].prev = i - 1;
-		sdlt[i].next = i + 1;
 		sdlt[i].sprite = -1;
 		sdlt[i].xres = 0;
 		sdlt[i].yres = 0;
-		sdlt[i].text = NULL;
-		sdlt[i].generation = 1; // Start at 1 (0 is reserved)
-		sdlt[i].work_state = TX_WORK_IDLE;
-	}
-
-	if (MAX_TEXCACHE > 0) {
-		sdlt[0].prev = STX_NONE;
-		sdlt[MAX_TEXCACHE - 1].next = STX_NONE;
-	}
-
-	sdlt_best = 0;
-	sdlt_last = MAX_TEXCACHE - 1;
-
-	// Hash table - clear all heads
-	for (i = 0; i < MAX_TEXHASH; i++) {
-		sdlt_cache[i] = STX_NONE;
 	}
 
 	// Job queue
@@ -101,6 +86,12 @@ int sdl_init_for_tests(void)
 		return 0;
 	}
 
+	sdl_light_init();
+
+	// Map the archives the client reads from and find the sprites in them
+	sdl_archive_init();
+	sdl_zip_index_init();
+
 	// Initialize job queue
 	tex_jobs_init();
 
@@ -153,9 +144,6 @@ int sdl_init_for_tests_with_workers(int worker_count)
 		return 0;
 	}
 
-	// Don't allocate zip handles for tests - workers will use NULL
-	worker_zips = NULL;
-
 	SDL_SetAtomicInt(&worker_quit, 0);
 
 	for (i = 0; i < worker_count; i++) {
@@ -182,11 +170,6 @@ void sdl_shutdown_for_tests(void)
 	if (sdl_multi && worker_threads) {
 		SDL_SetAtomicInt(&worker_quit, 1);
 
-		// Also signal the job queue condition variable (for any waiting on cond)
-		SDL_LockMutex(g_tex_jobs.mutex);
-		SDL_BroadcastCondition(g_tex_jobs.cond);
-		SDL_UnlockMutex(g_tex_jobs.mutex);
-
 		// Wake up all workers from semaphore wait
 		// Each worker needs one semaphore post to wake from SDL_WaitSemaphore
 		for (i = 0; i < sdl_multi; i++) {
@@ -222,6 +205,9 @@ void sdl_shutdown_for_tests(void)
 	if (sdl_zip2m) {
 		zip_close(sdl_zip2m);
 	}
+	sdl_archive_exit();
+	sdl_text_exit();
+	sdl_particle_exit();
 
 	// Shutdown job queue
 	tex_jobs_shutdown();
@@ -254,7 +240,7 @@ static int sdl_check_texture_entry_invariants(int cache_index)
 
 	// If entry is unused, it should not have resources
 	if (!(flags & SF_USED)) {
-		if (e->tex != NULL) {
+		if (e->tex != NULL || e->atlas != ATLAS_NONE) {
 			fprintf(stderr, "BUG: unused entry %d has tex != NULL\n", cache_index);
 			return -1;
 		}
@@ -302,6 +288,22 @@ static int sdl_check_texture_entry_invariants(int cache_index)
 		}
 	}
 
+	// Atlas entries: a texture that is their page and a cell marked in use
+	if (e->atlas != ATLAS_NONE) {
+		const struct sdl_atlas_page *ap = &sdl_atlas[e->atlas];
+		if (!(flags & SF_DIDTEX) || e->tex == NULL || e->tex != ap->tex) {
+			fprintf(stderr, "BUG: entry %d is on atlas page %d but tex doesn't match\n", cache_index, e->atlas);
+			return -1;
+		}
+		int cell = e->atlas_y / ap->cell_h * (ATLAS_PAGE_SIZE / ap->cell_w) + e->atlas_x / ap->cell_w;
+		if (e->atlas_x % ap->cell_w || e->atlas_y % ap->cell_h || !(ap->cells[cell / 64] & (1ull << (cell % 64))) ||
+		    e->xres * sdl_scale > ap->cell_w || e->yres * sdl_scale > ap->cell_h) {
+			fprintf(stderr, "BUG: entry %d has a bad atlas cell %d,%d on page %d\n", cache_index, e->atlas_x,
+			    e->atlas_y, e->atlas);
+			return -1;
+		}
+	}
+
 	// Sprite entries: must not have text
 	if ((flags & SF_SPRITE) && e->text != NULL) {
 		fprintf(stderr, "BUG: entry %d is SF_SPRITE but text != NULL\n", cache_index);
@@ -355,107 +357,200 @@ static int sdl_check_hash_chain_invariants(void)
 static int sdl_check_lru_list_invariants(void)
 {
 	int idx;
-	int count = 0;
+	int total = 0;
 
-	// Forward walk from sdlt_best
-	idx = sdlt_best;
-	while (idx != STX_NONE) {
-		if (idx < 0 || idx >= MAX_TEXCACHE) {
-			fprintf(stderr, "BUG: LRU forward walk found out-of-range index %d\n", idx);
-			return -1;
-		}
+	for (int list = 0; list < TX_LRU_LISTS; list++) {
+		int count = 0, last = STX_NONE;
 
-		if (count++ > MAX_TEXCACHE) {
-			fprintf(stderr, "BUG: LRU forward walk detected cycle (count=%d)\n", count);
-			return -1;
-		}
+		// Forward walk from the list head
+		idx = sdlt_lru[list].best;
+		while (idx != STX_NONE) {
+			if (idx < 0 || idx >= MAX_TEXCACHE) {
+				fprintf(stderr, "BUG: LRU %d forward walk found out-of-range index %d\n", list, idx);
+				return -1;
+			}
 
-		// Check prev/next consistency
-		int next = sdlt[idx].next;
-		if (next != STX_NONE) {
-			if (next < 0 || next >= MAX_TEXCACHE) {
-				fprintf(stderr, "BUG: LRU entry %d has out-of-range next=%d\n", idx, next);
+			if (count++ > MAX_TEXCACHE) {
+				fprintf(stderr, "BUG: LRU %d forward walk detected cycle (count=%d)\n", list, count);
 				return -1;
 			}
-			if (sdlt[next].prev != idx) {
-				fprintf(stderr, "BUG: LRU entry %d points to next=%d, but that entry's prev=%d\n", idx, next,
-				    sdlt[next].prev);
+
+			if (sdlt[idx].lru != list) {
+				fprintf(stderr, "BUG: LRU %d holds entry %d marked for list %d\n", list, idx, sdlt[idx].lru);
 				return -1;
 			}
+
+			// Check prev/next consistency
+			int next = sdlt[idx].next;
+			if (next != STX_NONE) {
+				if (next < 0 || next >= MAX_TEXCACHE) {
+					fprintf(stderr, "BUG: LRU entry %d has out-of-range next=%d\n", idx, next);
+					return -1;
+				}
+				if (sdlt[next].prev != idx) {
+					fprintf(stderr, "BUG: LRU entry %d points to next=%d, but that entry's prev=%d\n", idx, next,
+					    sdlt[next].prev);
+					return -1;
+				}
+			}
+
+			last = idx;
+			idx = next;
+		}
+
+		if (last != sdlt_lru[list].last) {
+			fprintf(stderr, "BUG: LRU %d ends at %d but its tail is %d\n", list, last, sdlt_lru[list].last);
+			return -1;
 		}
 
-		idx = next;
+		if (count != sdlt_lru[list].count) {
+			fprintf(stderr, "BUG: LRU %d holds %d entries but count=%d\n", list, count, sdlt_lru[list].count);
+			return -1;
+		}
+
+		total += count;
+	}
+
+	if (total != sdlt_slots) {
+		fprintf(stderr, "BUG: LRU lists hold %d entries but sdlt_slots=%d\n", total, sdlt_slots);
+		return -1;
 	}
 
 	return 0;
 }
 
-static int sdl_check_job_queue_invariants(void)
+static int sdl_check_job_ring_invariants(texture_job_ring_t *r, int queue, int prio)
 {
-	texture_job_queue_t *q = &g_tex_jobs;
-
-	SDL_LockMutex(q->mutex);
-
-	// Basic queue state
-	if (q->count < 0 || q->count > TEX_JOB_CAPACITY) {
-		fprintf(stderr, "BUG: job queue count=%d out of range [0, %d]\n", q->count, TEX_JOB_CAPACITY);
-		SDL_UnlockMutex(q->mutex);
+	// Basic ring state
+	if (r->count < 0 || r->count > TEX_JOB_QUEUE_CAPACITY) {
+		fprintf(stderr, "BUG: job queue %d ring %d count=%d out of range [0, %d]\n", queue, prio, r->count,
+		    TEX_JOB_QUEUE_CAPACITY);
 		return -1;
 	}
 
-	if (q->head < 0 || q->head >= TEX_JOB_CAPACITY) {
-		fprintf(stderr, "BUG: job queue head=%d out of range [0, %d)\n", q->head, TEX_JOB_CAPACITY);
-		SDL_UnlockMutex(q->mutex);
+	if (r->head < 0 || r->head >= TEX_JOB_QUEUE_CAPACITY) {
+		fprintf(stderr, "BUG: job queue %d ring %d head=%d out of range [0, %d)\n", queue, prio, r->head,
+		    TEX_JOB_QUEUE_CAPACITY);
 		return -1;
 	}
 
-	if (q->tail < 0 || q->tail >= TEX_JOB_CAPACITY) {
-		fprintf(stderr, "BUG: job queue tail=%d out of range [0, %d)\n", q->tail, TEX_JOB_CAPACITY);
-		SDL_UnlockMutex(q->mutex);
+	if (r->tail < 0 || r->tail >= TEX_JOB_QUEUE_CAPACITY) {
+		fprintf(stderr, "BUG: job queue %d ring %d tail=%d out of range [0, %d)\n", queue, prio, r->tail,
+		    TEX_JOB_QUEUE_CAPACITY);
 		return -1;
 	}
 
 	// Check that queued jobs reference valid cache indices
 	int checked = 0;
-	int idx = q->head;
-	for (int i = 0; i < q->count; i++) {
-		texture_job_t *job = &q->jobs[idx];
+	int idx = r->head;
+	for (int i = 0; i < r->count; i++) {
+		texture_job_t *job = &r->jobs[idx];
 
 		if (job->cache_index < 0 || job->cache_index >= MAX_TEXCACHE) {
-			fprintf(stderr, "BUG: queued job at slot %d has invalid cache_index=%d\n", idx, job->cache_index);
-			SDL_UnlockMutex(q->mutex);
+			fprintf(stderr, "BUG: queued job at queue %d ring %d slot %d has invalid cache_index=%d\n", queue, prio,
+			    idx, job->cache_index);
 			return -1;
 		}
 
 		if (job->generation == 0) {
-			fprintf(stderr, "BUG: queued job at slot %d has generation==0\n", idx);
-			SDL_UnlockMutex(q->mutex);
+			fprintf(stderr, "BUG: queued job at queue %d ring %d slot %d has generation==0\n", queue, prio, idx);
 			return -1;
 		}
 
-		idx = (idx + 1) % TEX_JOB_CAPACITY;
+		idx = (idx + 1) % TEX_JOB_QUEUE_CAPACITY;
 		checked++;
 
-		if (checked > TEX_JOB_CAPACITY) {
-			fprintf(stderr, "BUG: job queue appears to have infinite loop\n");
-			SDL_UnlockMutex(q->mutex);
+		if (checked > TEX_JOB_QUEUE_CAPACITY) {
+			fprintf(stderr, "BUG: job queue %d ring %d appears to have infinite loop\n", queue, prio);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int sdl_check_job_queue_invariants(void)
+{
+	texture_job_queue_t *q = &g_tex_jobs;
+
+	for (int i = 0; i < TEX_JOB_QUEUES; i++) {
+		texture_worker_queue_t *wq = &q->queues[i];
+		int total = 0;
+
+		SDL_LockMutex(wq->mutex);
+
+		for (int prio = 0; prio < TEX_JOB_PRIORITIES; prio++) {
+			if (sdl_check_job_ring_invariants(&wq->rings[prio], i, prio) != 0) {
+				SDL_UnlockMutex(wq->mutex);
+				return -1;
+			}
+			total += wq->rings[prio].count;
+		}
+
+		int count = __atomic_load_n((int *)&wq->count, __ATOMIC_ACQUIRE);
+		SDL_UnlockMutex(wq->mutex);
+
+		if (count != total) {
+			fprintf(stderr, "BUG: job queue %d count=%d but rings hold %d jobs\n", i, count, total);
+			return -1;
+		}
+	}
+
+	// The per-priority totals span all queues and change under running
+	// workers, so only their sign can be checked here
+	for (int prio = 0; prio < TEX_JOB_PRIORITIES; prio++) {
+		int count = __atomic_load_n((int *)&q->pending[prio], __ATOMIC_ACQUIRE);
+		if (count < 0) {
+			fprintf(stderr, "BUG: %d jobs pending at priority %d\n", count, prio);
 			return -1;
 		}
 	}
 
-	SDL_UnlockMutex(q->mutex);
 	return 0;
 }
 
 int sdl_check_invariants_for_tests(void)
 {
-	int i;
+	int i, collapsed = 0, pages = 0;
+	int atlas_used[ATLAS_MAX_PAGES] = {0};
 
 	// 1. Check all texture entries
 	for (i = 0; i < MAX_TEXCACHE; i++) {
 		if (sdl_check_texture_entry_invariants(i) != 0) {
 			return -1;
 		}
+		if (sdlt[i].light_seen) {
+			collapsed += __builtin_popcount(sdlt[i].light_seen) - 1;
+		}
+		if (sdlt[i].atlas != ATLAS_NONE) {
+			atlas_used[sdlt[i].atlas]++;
+		}
+	}
+	if (collapsed != texc_collapsed) {
+		fprintf(stderr, "BUG: entries share %d light variants but texc_collapsed=%d\n", collapsed, texc_collapsed);
+		return -1;
+	}
+
+	// Atlas pages: in use exactly while entries sit on them
+	for (i = 0; i < ATLAS_MAX_PAGES; i++) {
+		int bits = 0;
+		for (int j = 0; j < ATLAS_MAX_CELLS / 64; j++) {
+			bits += __builtin_popcountll(sdl_atlas[i].cells[j]);
+		}
+		if (sdl_atlas[i].tex && (atlas_used[i] != sdl_atlas[i].used || bits != sdl_atlas[i].used || !bits)) {
+			fprintf(stderr, "BUG: atlas page %d has %d entries, %d cells marked, used=%d\n", i, atlas_used[i], bits,
+			    sdl_atlas[i].used);
+			return -1;
+		}
+		if (!sdl_atlas[i].tex && atlas_used[i]) {
+			fprintf(stderr, "BUG: %d entries on freed atlas page %d\n", atlas_used[i], i);
+			return -1;
+		}
+		pages += sdl_atlas[i].tex != NULL;
+	}
+	if (pages != sdl_atlas_pages) {
+		fprintf(stderr, "BUG: %d atlas pages in use but sdl_atlas_pages=%d\n", pages, sdl_atlas_pages);
+		return -1;
 	}
 
 	// 2. Check hash chains
@@ -552,7 +647,8 @@ int sdl_test_get_set_blend_mode_count(void)
 // but STUB GPU operations (which require a real renderer/window)
 
 // Fake SDL_Texture object for tests
-static int dummy_texture;
+#define DUMMY_TEXTURES 1024
+static int dummy_texture[DUMMY_TEXTURES], dummy_texture_next;
 
 // ============================================================================
 // SDL Render Function Stubs with Counters
@@ -651,7 +747,8 @@ SDL_Texture *SDL_CreateTexture(SDL_Renderer *renderer __attribute__((unused)),
     int w __attribute__((unused)), int h __attribute__((unused)))
 {
 	// Return non-NULL pointer (cache code just checks != NULL)
-	return (SDL_Texture *)&dummy_texture;
+	// Distinct pointers, so that sprites on different atlas pages can be told apart
+	return (SDL_Texture *)&dummy_texture[dummy_texture_next++ % DUMMY_TEXTURES];
 }
 
 // Stub: Update texture with pixel data
@@ -721,10 +818,18 @@ uint8_t sdl_texture_get_work_state_for_test(int cache_index)
 // Return rough job queue depth (read-only, no side effects)
 int sdl_get_job_queue_depth_for_test(void)
 {
-	SDL_LockMutex(g_tex_jobs.mutex);
-	int depth = g_tex_jobs.count;
-	SDL_UnlockMutex(g_tex_jobs.mutex);
+	int depth = 0;
+	for (int prio = 0; prio < TEX_JOB_PRIORITIES; prio++) {
+		depth += __atomic_load_n((int *)&g_tex_jobs.pending[prio], __ATOMIC_ACQUIRE);
+	}
 	return depth;
 }
 
+// Return number of finished entries waiting for upload (read-only, no side effects)
+int sdl_get_ready_queue_depth_for_test(void)
+{
+	uint32_t tail = __atomic_load_n((uint32_t *)&g_tex_ready.tail, __ATOMIC_ACQUIRE);
+	return (int)(tail - g_tex_ready.head);
+}
+
 #endif /* UNIT_TEST */
@@ -24,9 +24,15 @@ extern int sockstate; // Declare early for use in wait logging
 
 // Texture cache data (statically allocated)
 struct sdl_texture sdlt[MAX_TEXCACHE];
-int sdlt_best, sdlt_last;
+struct sdl_lru sdlt_lru[TX_LRU_LISTS];
 int sdlt_cache[MAX_TEXHASH];
 
+// Only sdlt_slots entries of sdlt[] are linked into the LRU lists. The others
+// wait in sdlt_spare[] until the cache is full but still under its budget.
+int sdlt_slots;
+static int sdlt_spare[MAX_TEXCACHE];
+static int sdlt_spare_count;
+
 // Image cache
 static struct sdl_image sdli_storage[MAXSPRITE];
 struct sdl_image *sdli = sdli_storage;
@@ -34,11 +40,16 @@ struct sdl_image *sdli = sdli_storage;
 // New texture job queue
 texture_job_queue_t g_tex_jobs;
 
+// Finished jobs waiting for GPU upload
+texture_ready_queue_t g_tex_ready;
+
 // Statistics
 int texc_used = 0;
 long long mem_png = 0;
 long long mem_tex = 0;
 long long texc_hit = 0, texc_miss = 0, texc_pre = 0;
+long long texc_hits[TX_LRU_LISTS], texc_evicts[TX_LRU_LISTS]; // per LRU class
+int texc_collapsed = 0;
 
 #ifdef DEVELOPER
 uint64_t sdl_render_wait = 0;
@@ -65,64 +76,319 @@ int maxpanic = 0;
 // New texture job queue implementation
 // ============================================================================
 
+static void tex_ready_init(void)
+{
+	memset(&g_tex_ready, 0, sizeof(g_tex_ready));
+	for (uint32_t i = 0; i < TEX_READY_CAPACITY; i++) {
+		uint32_t *seq_ptr = (uint32_t *)&g_tex_ready.cells[i].seq;
+		__atomic_store_n(seq_ptr, i, __ATOMIC_RELAXED);
+	}
+}
+
 void tex_jobs_init(void)
 {
+	tex_ready_init();
+
 	memset(&g_tex_jobs, 0, sizeof(g_tex_jobs));
-	g_tex_jobs.mutex = SDL_CreateMutex();
-	g_tex_jobs.cond = SDL_CreateCondition();
-	if (!g_tex_jobs.mutex || !g_tex_jobs.cond) {
+	for (int i = 0; i < TEX_JOB_QUEUES; i++) {
+		g_tex_jobs.queues[i].mutex = SDL_CreateMutex();
+		if (!g_tex_jobs.queues[i].mutex) {
+			fail("Failed to create texture job queue mutex");
+			exit(1);
+		}
+	}
+	g_tex_jobs.done_mutex = SDL_CreateMutex();
+	g_tex_jobs.done_cond = SDL_CreateCondition();
+	if (!g_tex_jobs.done_mutex || !g_tex_jobs.done_cond) {
 		fail("Failed to create texture job queue mutex/cond");
 		exit(1);
 	}
+	__atomic_store_n((int *)&g_tex_jobs.wait_index, STX_NONE, __ATOMIC_RELAXED);
 }
 
 void tex_jobs_shutdown(void)
 {
-	if (g_tex_jobs.mutex) {
-		SDL_DestroyMutex(g_tex_jobs.mutex);
-		g_tex_jobs.mutex = NULL;
+	for (int i = 0; i < TEX_JOB_QUEUES; i++) {
+		if (g_tex_jobs.queues[i].mutex) {
+			SDL_DestroyMutex(g_tex_jobs.queues[i].mutex);
+			g_tex_jobs.queues[i].mutex = NULL;
+		}
+	}
+	if (g_tex_jobs.done_mutex) {
+		SDL_DestroyMutex(g_tex_jobs.done_mutex);
+		g_tex_jobs.done_mutex = NULL;
 	}
-	if (g_tex_jobs.cond) {
-		SDL_DestroyCondition(g_tex_jobs.cond);
-		g_tex_jobs.cond = NULL;
+	if (g_tex_jobs.done_cond) {
+		SDL_DestroyCondition(g_tex_jobs.done_cond);
+		g_tex_jobs.done_cond = NULL;
 	}
 }
 
-int tex_jobs_pop(texture_job_t *out_job, int should_block)
+static int tex_jobs_ring_push(texture_worker_queue_t *wq, int cache_index, uint32_t generation, int priority)
+{
+	texture_job_ring_t *ring = &wq->rings[priority];
+	int ok = 0;
+
+	SDL_LockMutex(wq->mutex);
+	if (ring->count < TEX_JOB_QUEUE_CAPACITY) {
+		texture_job_t *job = &ring->jobs[ring->tail];
+		job->cache_index = cache_index;
+		job->generation = generation;
+		job->kind = TEXTURE_JOB_MAKE_STAGES_1_2;
+
+		ring->tail = (ring->tail + 1) & (TEX_JOB_QUEUE_CAPACITY - 1);
+		ring->count++;
+		__atomic_add_fetch((int *)&wq->count, 1, __ATOMIC_RELEASE);
+		__atomic_add_fetch((int *)&g_tex_jobs.pending[priority], 1, __ATOMIC_RELEASE);
+		ok = 1;
+	}
+	SDL_UnlockMutex(wq->mutex);
+
+	return ok;
+}
+
+// Queue a stage 1+2 job for cache_index at the given priority (SDL_PRE_*).
+// Render thread only; signal prework afterwards.
+// Jobs go round-robin to the queues of the running workers, spilling over
+// to the next queue (running worker or not - all of them get stolen from)
+// when one is full.
+// Returns 1 if queued, 0 if every queue is full at that priority.
+int tex_jobs_push(int cache_index, int priority)
 {
 	texture_job_queue_t *q = &g_tex_jobs;
-	SDL_LockMutex(q->mutex);
+	struct sdl_texture *slot = &sdlt[cache_index];
+	int homes, start, was_idle;
 
-	// Assert queue invariants
-	assert(q->count <= TEX_JOB_CAPACITY && "tex_jobs_pop: count > capacity");
-	assert(q->head < TEX_JOB_CAPACITY && "tex_jobs_pop: head >= capacity");
-	assert(q->tail < TEX_JOB_CAPACITY && "tex_jobs_pop: tail >= capacity");
+	assert(cache_index >= 0 && cache_index < MAX_TEXCACHE && "tex_jobs_push: invalid cache_index");
+	assert(priority >= 0 && priority < TEX_JOB_PRIORITIES && "tex_jobs_push: invalid priority");
 
-	while (q->count == 0) {
-		if (!should_block) {
-			SDL_UnlockMutex(q->mutex);
+	homes = sdl_multi < 1 ? 1 : (sdl_multi > TEX_JOB_QUEUES ? TEX_JOB_QUEUES : sdl_multi);
+	start = q->next_queue % homes;
+	q->next_queue = (start + 1) % homes;
+
+	// Mark as queued before a worker can see the job. A slot that is already
+	// queued (promotion) stays so; its old copy becomes the stale one.
+	was_idle = work_state_load(slot) == TX_WORK_IDLE;
+	if (was_idle) {
+		work_state_store(slot, TX_WORK_QUEUED);
+	}
+
+	for (int i = 0; i < TEX_JOB_QUEUES; i++) {
+		if (tex_jobs_ring_push(&q->queues[(start + i) % TEX_JOB_QUEUES], cache_index, slot->generation, priority)) {
+			slot->priority = (uint8_t)priority;
+			return 1;
+		}
+	}
+
+	// Nobody saw the job, so nobody can have claimed the slot meanwhile
+	if (was_idle) {
+		work_state_store(slot, TX_WORK_IDLE);
+	}
+
+	return 0;
+}
+
+// Take up to max_jobs jobs of one priority from a queue.
+// A thief only takes up to half of the ring, leaving the owner its share.
+static int tex_jobs_ring_take(
+    texture_worker_queue_t *wq, int priority, texture_job_t *out_jobs, int max_jobs, int steal)
+{
+	texture_job_ring_t *ring = &wq->rings[priority];
+	int n;
+
+	SDL_LockMutex(wq->mutex);
+
+	n = steal ? (ring->count + 1) / 2 : ring->count;
+	if (n > max_jobs) {
+		n = max_jobs;
+	}
+
+	for (int i = 0; i < n; i++) {
+		assert(ring->head >= 0 && ring->head < TEX_JOB_QUEUE_CAPACITY && "tex_jobs_take: head out of range");
+		out_jobs[i] = ring->jobs[ring->head];
+
+		// Zero out the popped slot for debugging clarity
+		// (Makes it obvious in debugger/memory dumps when a slot is free vs stale)
+		memset(&ring->jobs[ring->head], 0, sizeof(texture_job_t));
+		ring->head = (ring->head + 1) & (TEX_JOB_QUEUE_CAPACITY - 1);
+
+		// Assert the popped job has valid values
+		assert(out_jobs[i].cache_index >= 0 && out_jobs[i].cache_index < MAX_TEXCACHE &&
+		       "tex_jobs_take: popped invalid cache_index");
+		assert(out_jobs[i].generation != 0 && "tex_jobs_take: popped job with generation=0");
+		assert(out_jobs[i].kind == TEXTURE_JOB_MAKE_STAGES_1_2 && "tex_jobs_take: unknown job kind");
+	}
+
+	if (n) {
+		ring->count -= n;
+		__atomic_sub_fetch((int *)&wq->count, n, __ATOMIC_RELEASE);
+		__atomic_sub_fetch((int *)&g_tex_jobs.pending[priority], n, __ATOMIC_RELEASE);
+	}
+
+	SDL_UnlockMutex(wq->mutex);
+
+	return n;
+}
+
+// Worker side: take up to max_jobs jobs of the most urgent priority that has
+// any, from the worker's own queue first, otherwise stolen from the others.
+// SDL_PRE_NOW jobs are taken one at a time so that they spread over all idle
+// workers instead of queueing up behind one of them.
+// Returns the number of jobs stored in out_jobs (0 if there was no work).
+int tex_jobs_take(int worker_id, texture_job_t *out_jobs, int max_jobs)
+{
+	texture_job_queue_t *q = &g_tex_jobs;
+	int home = worker_id % TEX_JOB_QUEUES;
+
+	for (int priority = 0; priority < TEX_JOB_PRIORITIES; priority++) {
+		if (!__atomic_load_n((int *)&q->pending[priority], __ATOMIC_ACQUIRE)) {
+			continue;
+		}
+
+		int want = priority == SDL_PRE_NOW ? 1 : max_jobs;
+
+		for (int i = 0; i < TEX_JOB_QUEUES; i++) {
+			texture_worker_queue_t *wq = &q->queues[(home + i) % TEX_JOB_QUEUES];
+
+			// Cheap check so that idle workers don't hammer empty queues' locks
+			if (!__atomic_load_n((int *)&wq->count, __ATOMIC_ACQUIRE)) {
+				continue;
+			}
+
+			int n = tex_jobs_ring_take(wq, priority, out_jobs, want, i != 0);
+			if (n) {
+				return n;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// Number of SDL_PRE_NOW jobs waiting in all queues. Workers check this
+// between the jobs of a batch so that the render thread never waits for a
+// batch of speculative work to finish.
+int tex_jobs_urgent(void)
+{
+	return __atomic_load_n((int *)&g_tex_jobs.pending[SDL_PRE_NOW], __ATOMIC_ACQUIRE);
+}
+
+// Called by a worker after it set work_state back to TX_WORK_IDLE.
+// Only takes done_mutex if the render thread is blocked on this very job.
+void tex_jobs_notify_done(int cache_index, uint32_t generation)
+{
+	texture_job_queue_t *q = &g_tex_jobs;
+
+	// Pairs with the fence in tex_jobs_wait_done(): either we see the waiter,
+	// or the waiter sees our work_state store.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n((int *)&q->wait_index, __ATOMIC_RELAXED) != cache_index) {
+		return;
+	}
+
+	SDL_LockMutex(q->done_mutex);
+	if (q->wait_generation == generation) {
+		SDL_SignalCondition(q->done_cond);
+	}
+	SDL_UnlockMutex(q->done_mutex);
+}
+
+// Render thread only: block until the job for cache_index is no longer
+// queued or running. The generation can't change meanwhile, since only the
+// render thread evicts.
+// Returns 1 when finished (check SF_DIDMAKE for success), 0 on timeout.
+int tex_jobs_wait_done(int cache_index, int timeout_ms)
+{
+	texture_job_queue_t *q = &g_tex_jobs;
+	struct sdl_texture *st = &sdlt[cache_index];
+	Uint64 deadline = SDL_GetTicks() + (Uint64)timeout_ms;
+	int done;
+
+	SDL_LockMutex(q->done_mutex);
+	q->wait_generation = st->generation;
+	__atomic_store_n((int *)&q->wait_index, cache_index, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for (;;) {
+		done = work_state_load(st) == TX_WORK_IDLE;
+		if (done) {
+			break;
+		}
+
+		Uint64 now = SDL_GetTicks();
+		if (now >= deadline) {
+			break;
+		}
+		SDL_WaitConditionTimeout(q->done_cond, q->done_mutex, (Sint32)(deadline - now));
+	}
+
+	__atomic_store_n((int *)&q->wait_index, STX_NONE, __ATOMIC_RELAXED);
+	SDL_UnlockMutex(q->done_mutex);
+
+	return done;
+}
+
+// Ready queue (bounded MPSC, after Vyukov's bounded queue)
+//
+// Each cell carries a sequence number. A cell at position pos is free for a
+// producer when seq == pos, and holds a finished entry for the consumer when
+// seq == pos + 1. The consumer hands the cell back for the next lap by
+// setting seq = pos + TEX_READY_CAPACITY.
+//
+// Called by workers (or the main thread in single-threaded mode) after
+// stages 1+2. Returns 1 on success, 0 if the queue is full.
+int tex_ready_push(int cache_index, uint32_t generation)
+{
+	texture_ready_queue_t *q = &g_tex_ready;
+	uint32_t *tail_ptr = (uint32_t *)&q->tail;
+	uint32_t pos = __atomic_load_n(tail_ptr, __ATOMIC_RELAXED);
+	texture_ready_t *cell;
+
+	assert(cache_index >= 0 && cache_index < MAX_TEXCACHE && "tex_ready_push: invalid cache_index");
+
+	for (;;) {
+		cell = &q->cells[pos & (TEX_READY_CAPACITY - 1)];
+		uint32_t seq = __atomic_load_n((uint32_t *)&cell->seq, __ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t)(seq - pos);
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(tail_ptr, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+			// CAS failure reloaded pos, try again
+		} else if (diff < 0) {
+			// Consumer hasn't freed this cell yet: queue is full
 			return 0;
+		} else {
+			pos = __atomic_load_n(tail_ptr, __ATOMIC_RELAXED);
 		}
-		SDL_WaitCondition(q->cond, q->mutex);
 	}
 
-	// Pop job from queue
-	int head_index = q->head;
-	*out_job = q->jobs[head_index];
-	q->head = (q->head + 1) % TEX_JOB_CAPACITY;
-	q->count--;
+	cell->cache_index = cache_index;
+	cell->generation = generation;
+	__atomic_store_n((uint32_t *)&cell->seq, pos + 1, __ATOMIC_RELEASE);
 
-	// Zero out the popped slot for debugging clarity
-	// (Makes it obvious in debugger/memory dumps when a slot is free vs stale)
-	memset(&q->jobs[head_index], 0, sizeof(texture_job_t));
+	return 1;
+}
 
-	// Assert the popped job has valid values
-	assert(
-	    out_job->cache_index >= 0 && out_job->cache_index < MAX_TEXCACHE && "tex_jobs_pop: popped invalid cache_index");
-	assert(out_job->generation != 0 && "tex_jobs_pop: popped job with generation=0");
-	assert(out_job->kind == TEXTURE_JOB_MAKE_STAGES_1_2 && "tex_jobs_pop: unknown job kind");
+// Main thread only. Returns 1 and fills out the entry, or 0 if nothing is
+// ready (queue empty or the next producer has not finished writing yet).
+int tex_ready_pop(int *out_cache_index, uint32_t *out_generation)
+{
+	texture_ready_queue_t *q = &g_tex_ready;
+	uint32_t pos = q->head;
+	texture_ready_t *cell = &q->cells[pos & (TEX_READY_CAPACITY - 1)];
+	uint32_t seq = __atomic_load_n((uint32_t *)&cell->seq, __ATOMIC_ACQUIRE);
+
+	if (seq != pos + 1) {
+		return 0;
+	}
+
+	*out_cache_index = cell->cache_index;
+	*out_generation = cell->generation;
+	q->head = pos + 1;
+	__atomic_store_n((uint32_t *)&cell->seq, pos + TEX_READY_CAPACITY, __ATOMIC_RELEASE);
 
-	SDL_UnlockMutex(q->mutex);
 	return 1;
 }
 
@@ -130,35 +396,161 @@ int tex_jobs_pop(texture_job_t *out_job, int should_block)
 // End of texture job queue implementation
 // ============================================================================
 
+// Reset the texture cache: empty hash table, sdl_cache_size empty slots
+// on the probation list and all others spare.
+void sdl_tx_init(void)
+{
+	int i, slots;
+
+	slots = sdl_cache_size;
+	if (slots < MIN_TEXCACHE) {
+		slots = MIN_TEXCACHE;
+	}
+	if (slots > MAX_TEXCACHE) {
+		slots = MAX_TEXCACHE;
+	}
+
+	for (i = 0; i < MAX_TEXHASH; i++) {
+		sdlt_cache[i] = STX_NONE;
+	}
+
+	for (i = 0; i < MAX_TEXCACHE; i++) {
+		// Initialize flags atomically
+		uint16_t *flags_ptr = (uint16_t *)&sdlt[i].flags;
+		__atomic_store_n(flags_ptr, 0, __ATOMIC_RELAXED);
+		sdlt[i].tex = NULL;
+		sdlt[i].pixel = NULL;
+		sdlt[i].text = NULL;
+		sdlt[i].prev = i < slots ? i - 1 : STX_NONE;
+		sdlt[i].next = i < slots - 1 ? i + 1 : STX_NONE;
+		sdlt[i].lru = TX_LRU_PROBATION;
+		sdlt[i].light_seen = 0;
+		sdlt[i].atlas = ATLAS_NONE;
+		sdlt[i].alpha = 255;
+		sdlt[i].wait_warned = 0;
+		sdlt[i].hnext = STX_NONE;
+		sdlt[i].hprev = STX_NONE;
+		// Generation starts at 1 (0 is reserved for "never valid for jobs")
+		sdlt[i].generation = 1;
+		sdlt[i].work_state = TX_WORK_IDLE;
+	}
+	// All empty slots start on probation, the protected list is empty
+	sdlt_lru[TX_LRU_PROBATION].best = 0;
+	sdlt_lru[TX_LRU_PROBATION].last = slots - 1;
+	sdlt_lru[TX_LRU_PROBATION].count = slots;
+	sdlt_lru[TX_LRU_PROTECTED].best = STX_NONE;
+	sdlt_lru[TX_LRU_PROTECTED].last = STX_NONE;
+	sdlt_lru[TX_LRU_PROTECTED].count = 0;
+	sdlt_slots = slots;
+	texc_collapsed = 0;
+	sdl_atlas_init();
+
+	// Lowest index on top, so the table fills up from the front
+	sdlt_spare_count = 0;
+	for (i = MAX_TEXCACHE - 1; i >= slots; i--) {
+		sdlt_spare[sdlt_spare_count++] = i;
+	}
+}
+
+// Take an entry out of its LRU list
+static void sdl_tx_unlink(int cache_index)
+{
+	struct sdl_lru *lru = &sdlt_lru[sdlt[cache_index].lru];
+	int prev = sdlt[cache_index].prev, next = sdlt[cache_index].next;
+
+	if (prev == STX_NONE) {
+		assert(cache_index == lru->best && "sdl_tx_unlink(): cache_index should be best");
+		lru->best = next;
+	} else {
+		sdlt[prev].next = next;
+	}
+	if (next == STX_NONE) {
+		assert(cache_index == lru->last && "sdl_tx_unlink(): cache_index should be last");
+		lru->last = prev;
+	} else {
+		sdlt[next].prev = prev;
+	}
+	sdlt[cache_index].prev = STX_NONE;
+	sdlt[cache_index].next = STX_NONE;
+	lru->count--;
+}
+
+// Link an unlinked entry in at the head of an LRU list
+static void sdl_tx_link_best(int cache_index, int list)
+{
+	struct sdl_lru *lru = &sdlt_lru[list];
+
+	sdlt[cache_index].lru = (uint8_t)list;
+	sdlt[cache_index].prev = STX_NONE;
+	sdlt[cache_index].next = lru->best;
+	if (lru->best == STX_NONE) {
+		lru->last = cache_index;
+	} else {
+		sdlt[lru->best].prev = cache_index;
+	}
+	lru->best = cache_index;
+	lru->count++;
+}
+
+// Link an unlinked entry in at the tail of an LRU list
+static void sdl_tx_link_last(int cache_index, int list)
+{
+	struct sdl_lru *lru = &sdlt_lru[list];
+
+	sdlt[cache_index].lru = (uint8_t)list;
+	sdlt[cache_index].prev = lru->last;
+	sdlt[cache_index].next = STX_NONE;
+	if (lru->last == STX_NONE) {
+		lru->best = cache_index;
+	} else {
+		sdlt[lru->last].next = cache_index;
+	}
+	lru->last = cache_index;
+	lru->count++;
+}
+
+// A new entry was built in this slot: it starts at the head of the
+// probation list, whatever list the slot was reused from.
+static void sdl_tx_fresh(int cache_index)
+{
+	sdlt[cache_index].used_frame = sdl_frames;
+
+	sdl_tx_unlink(cache_index);
+	sdl_tx_link_best(cache_index, TX_LRU_PROBATION);
+}
+
+// A cached entry is drawn again: move it to the head of the protected list.
+// If that makes the protected list too long, its tail goes back to the head
+// of the probation list and gets another chance there.
 void sdl_tx_best(int cache_index)
 {
 	assert(cache_index != STX_NONE && "sdl_tx_best(): sidx=SIDX_NONE");
 	assert(cache_index < MAX_TEXCACHE && "sdl_tx_best(): sidx>max_systemcache");
 
-	if (sdlt[cache_index].prev == STX_NONE) {
-		assert(cache_index == sdlt_best && "sdl_tx_best(): cache_index should be best");
+	sdlt[cache_index].used_frame = sdl_frames;
 
+	if (cache_index == sdlt_lru[TX_LRU_PROTECTED].best) {
 		return;
-	} else if (sdlt[cache_index].next == STX_NONE) {
-		assert(cache_index == sdlt_last && "sdl_tx_best(): sidx should be last");
+	}
 
-		sdlt_last = sdlt[cache_index].prev;
-		sdlt[sdlt_last].next = STX_NONE;
-		sdlt[sdlt_best].prev = cache_index;
-		sdlt[cache_index].prev = STX_NONE;
-		sdlt[cache_index].next = sdlt_best;
-		sdlt_best = cache_index;
+	sdl_tx_unlink(cache_index);
+	sdl_tx_link_best(cache_index, TX_LRU_PROTECTED);
 
-		return;
-	} else {
-		sdlt[sdlt[cache_index].prev].next = sdlt[cache_index].next;
-		sdlt[sdlt[cache_index].next].prev = sdlt[cache_index].prev;
-		sdlt[cache_index].prev = STX_NONE;
-		sdlt[cache_index].next = sdlt_best;
-		sdlt[sdlt_best].prev = cache_index;
-		sdlt_best = cache_index;
+	if (sdlt_lru[TX_LRU_PROTECTED].count > sdlt_slots * TX_PROTECTED_PERCENT / 100) {
+		int demote = sdlt_lru[TX_LRU_PROTECTED].last;
+		sdl_tx_unlink(demote);
+		sdl_tx_link_best(demote, TX_LRU_PROBATION);
+	}
+}
+
+// Put an entry at the probation tail, making it the next one to be reused
+static void sdl_tx_worst(int cache_index)
+{
+	if (cache_index == sdlt_lru[TX_LRU_PROBATION].last) {
 		return;
 	}
+	sdl_tx_unlink(cache_index);
+	sdl_tx_link_last(cache_index, TX_LRU_PROBATION);
 }
 
 static inline unsigned int hashfunc(unsigned int sprite, int ml, int ll, int rl, int ul, int dl)
@@ -212,7 +604,6 @@ SDL_Texture *sdl_maketext(const char *text, struct renderfont *font, uint32_t co
 
 // Forward declarations
 extern SDL_Mutex *premutex;
-extern int if_single_thread_process_one_job(void); // in sdl_core.c
 
 // ============================================================================
 // Texture Cache Concurrency Invariants
@@ -241,10 +632,12 @@ extern int if_single_thread_process_one_job(void); // in sdl_core.c
 //     - Can evict entries when work_state == TX_WORK_IDLE && flags allow
 //
 //   Background workers:
-//     - WRITES: flags (SF_DIDALLOC, SF_DIDMAKE), work_state, pixel buffer, generation checks
+//     - WRITES: flags (SF_DIDALLOC, SF_DIDMAKE), pixel buffer, generation checks,
+//       work_state (claim QUEUED -> IN_WORKER by CAS, then back to IDLE)
 //     - READS: Non-atomic sprite parameters (sprite, sink, freeze, scale, colors, lights, etc.)
 //     - NEVER touch: LRU pointers, hash chains, tex pointer (GPU texture)
-//     - Only operate on entries with jobs they claimed from the queue
+//     - Only operate on entries whose job they claimed; a job taken from another
+//       worker's queue (stolen) is claimed exactly the same way
 //
 // FLAG COMBINATION RULES:
 //   - SF_DIDTEX => SF_DIDMAKE && SF_DIDALLOC (GPU texture requires completed CPU work)
@@ -258,7 +651,8 @@ extern int if_single_thread_process_one_job(void); // in sdl_core.c
 //   - This establishes happens-before relationship per C11 memory model
 //
 // EVICTION SAFETY:
-//   - Render thread checks work_state under g_tex_jobs.mutex before evicting
+//   - Render thread checks work_state before evicting; workers only move a slot
+//     out of TX_WORK_QUEUED (by CAS), never out of TX_WORK_IDLE
 //   - If work_state != TX_WORK_IDLE, entry cannot be evicted
 //   - Generation counter (uint32_t) invalidates in-flight jobs after eviction
 //   - Workers check generation before writing results to detect stale jobs
@@ -273,8 +667,10 @@ extern int if_single_thread_process_one_job(void); // in sdl_core.c
 // PHASE BOUNDARIES:
 //   1. Render thread creates entry, sets sprite params, sets SF_USED | SF_SPRITE
 //   2. Worker (or render thread) allocates pixels, sets SF_DIDALLOC
-//   3. Worker (or render thread) processes pixels, sets SF_DIDMAKE
-//   4. Render thread (only) uploads to GPU, sets SF_DIDTEX
+//   3. Worker (or render thread) processes pixels, sets SF_DIDMAKE, pushes
+//      (cache_index, generation) onto g_tex_ready
+//   4. Render thread (only) uploads to GPU, sets SF_DIDTEX - either from
+//      sdl_pre_do() draining g_tex_ready, or on demand in tex_entry_ensure_ready()
 //
 // These invariants are tested extensively in test_texture_workers.c
 // ============================================================================
@@ -304,6 +700,27 @@ struct tex_request {
 	char ml, ll, rl, ul, dl;
 };
 
+// Can the light be applied when drawing instead of being baked into the texture?
+// Uniform light is a plain colour modulation and always is. Directional light
+// needs a mesh per draw (see sdl_blit_light()), so only with GO_GPULIGHT.
+// Freeze is applied after the light, and light 0 (bright) is not a modulation.
+// The colour balance and freeze themselves add to the colour and clip, which
+// a modulation can't do, so they stay baked like colourize, shine and sink.
+static int tex_light_at_draw(unsigned char freeze, char ml, char ll, char rl, char ul, char dl)
+{
+	if (freeze || ml <= 0 || ml > TX_LIGHT_NORMAL) {
+		return 0;
+	}
+	if (ll == ml && rl == ml && ul == ml && dl == ml) {
+		return 1;
+	}
+	if (!(game_options & GO_GPULIGHT)) {
+		return 0;
+	}
+	return ll > 0 && ll <= TX_LIGHT_NORMAL && rl > 0 && rl <= TX_LIGHT_NORMAL && ul > 0 && ul <= TX_LIGHT_NORMAL &&
+	       dl > 0 && dl <= TX_LIGHT_NORMAL;
+}
+
 static struct tex_request tex_request_from_args(uint32_t sprite, signed char sink, unsigned char freeze,
     unsigned char scale, char cr, char cg, char cb, char light, char sat, int c1, int c2, int c3, int shine, char ml,
     char ll, char rl, char ul, char dl, const char *text, int text_color, int text_flags, void *text_font,
@@ -339,6 +756,11 @@ static struct tex_request tex_request_from_args(uint32_t sprite, signed char sin
 	r.ul = ul;
 	r.dl = dl;
 
+	// All light combinations share the unlit texture, sdl_blit_light() lights it
+	if (!text && tex_light_at_draw(freeze, ml, ll, rl, ul, dl)) {
+		r.ml = r.ll = r.rl = r.ul = r.dl = TX_LIGHT_NORMAL;
+	}
+
 	return r;
 }
 
@@ -492,6 +914,9 @@ static int tex_entry_build_text(int cache_index, const struct tex_request *r, in
 		SDL_GetTextureSize(sdlt[cache_index].tex, &w, &h);
 		sdlt[cache_index].xres = (uint16_t)w;
 		sdlt[cache_index].yres = (uint16_t)h;
+		// Text textures are made at screen size, no sdl_scale on top
+		sdlt[cache_index].mem = (uint32_t)((size_t)w * (size_t)h * sizeof(uint32_t));
+		__atomic_add_fetch(&mem_tex, sdlt[cache_index].mem, __ATOMIC_RELAXED);
 		// Set flags ONLY if tex creation succeeded
 		uint16_t *flags_ptr = (uint16_t *)&sdlt[cache_index].flags;
 		__atomic_store_n(flags_ptr, SF_USED | SF_TEXT | SF_DIDALLOC | SF_DIDMAKE | SF_DIDTEX, __ATOMIC_RELEASE);
@@ -511,8 +936,8 @@ static int tex_entry_build_text(int cache_index, const struct tex_request *r, in
 	sdlt[cache_index].hnext = ntx;
 	sdlt_cache[hash] = cache_index;
 
-	// Link into LRU (at head)
-	sdl_tx_best(cache_index);
+	// Link into LRU (at probation head)
+	sdl_tx_fresh(cache_index);
 
 	return cache_index;
 }
@@ -523,12 +948,6 @@ static int tex_entry_build_sprite(int cache_index, const struct tex_request *r,
 {
 	int ntx;
 
-	if (r->preload != 1) {
-		if (sdl_ic_load(r->sprite, NULL) < 0) {
-			return STX_NONE;
-		}
-	}
-
 	// Initialize all non-atomic fields first
 	sdlt[cache_index].sprite = r->sprite;
 	sdlt[cache_index].sink = r->sink;
@@ -555,7 +974,12 @@ static int tex_entry_build_sprite(int cache_index, const struct tex_request *r,
 	__atomic_store_n(flags_ptr, SF_USED | SF_SPRITE, __ATOMIC_RELEASE);
 
 	if (r->preload != 1) {
-		sdl_make(sdlt + cache_index, sdli + r->sprite, r->preload);
+		// The disk cache may have the pixels without the image being loaded
+		if (sdl_make_pixels(sdlt + cache_index) < 0) {
+			__atomic_store_n(flags_ptr, 0, __ATOMIC_RELEASE);
+			return STX_NONE;
+		}
+		sdl_make(sdlt + cache_index, sdli + r->sprite, 3);
 	}
 
 	// Link into hash chain
@@ -567,152 +991,241 @@ static int tex_entry_build_sprite(int cache_index, const struct tex_request *r,
 	sdlt[cache_index].hnext = ntx;
 	sdlt_cache[hash] = cache_index;
 
-	// Link into LRU (at head)
-	sdl_tx_best(cache_index);
+	// Link into LRU (at probation head)
+	sdl_tx_fresh(cache_index);
 
 	return cache_index;
 }
 
-// Acquire a slot from the cache (evicting LRU entry if needed)
-// Returns a cache index that is safe to reuse, or STX_NONE if we must bail
-static int texcache_acquire_slot(void)
+static int texcache_over_budget(void)
 {
-	int cache_index = sdlt_last;
-	int ptx, ntx;
+	if (sdl_cache_budget <= 0) {
+		return 0;
+	}
+	return __atomic_load_n(&mem_tex, __ATOMIC_RELAXED) > (long long)sdl_cache_budget * 1024 * 1024;
+}
 
-	// Try to evict an entry, potentially trying multiple LRU candidates if workers are stuck
-#ifdef DEVELOPER
-	static int sdl_eviction_failures = 0;
-#endif
-	for (int eviction_attempts = 0; eviction_attempts < 10; eviction_attempts++) {
-		// delete
-		if (!flags_load(&sdlt[cache_index])) {
-			// Empty slot, just use it
-			break;
-		}
+// Link a spare slot in at the probation tail.
+// Returns the slot, or STX_NONE if all MAX_TEXCACHE slots are in use.
+static int texcache_grow(void)
+{
+	int cache_index;
 
-		int hash2;
-		int can_evict = 1;
-
-		// Check work_state under lock
-		if (sdl_multi && (flags_load(&sdlt[cache_index]) & SF_SPRITE)) {
-			SDL_LockMutex(g_tex_jobs.mutex);
-			if (sdlt[cache_index].work_state != TX_WORK_IDLE) {
-				// Slot has queued or in-progress work, cannot evict
-				SDL_UnlockMutex(g_tex_jobs.mutex);
-				can_evict = 0;
-				int candidate = sdlt[cache_index].prev;
-				if (candidate == STX_NONE) {
-					// No more candidates, give up
-#ifdef DEVELOPER
-					sdl_eviction_failures++;
-					if (sdl_eviction_failures == 1 || (sdl_eviction_failures % 100) == 0) {
-						warn("SDL: texture cache eviction failed %d times; workers may be busy", sdl_eviction_failures);
-					}
-#endif
-					return STX_NONE;
-				}
-				cache_index = candidate;
-				continue;
-			}
-			SDL_UnlockMutex(g_tex_jobs.mutex);
-		}
+	if (!sdlt_spare_count) {
+		return STX_NONE;
+	}
+	cache_index = sdlt_spare[--sdlt_spare_count];
 
-		// If we can't evict this entry, try the next candidate
-		if (!can_evict) {
-			continue;
-		}
+	sdl_tx_link_last(cache_index, TX_LRU_PROBATION);
+	sdlt_slots++;
 
-		uint16_t flags = flags_load(&sdlt[cache_index]);
-		if (flags & SF_SPRITE) {
-			hash2 = (int)hashfunc(sdlt[cache_index].sprite, sdlt[cache_index].ml, sdlt[cache_index].ll,
-			    sdlt[cache_index].rl, sdlt[cache_index].ul, sdlt[cache_index].dl);
-		} else if (flags & SF_TEXT) {
-			hash2 = (int)hashfunc_text(
-			    sdlt[cache_index].text, (int)sdlt[cache_index].text_color, sdlt[cache_index].text_flags);
-		} else {
-			hash2 = 0;
-			warn("weird entry in texture cache!");
-		}
+	return cache_index;
+}
 
-		ntx = sdlt[cache_index].hnext;
-		ptx = sdlt[cache_index].hprev;
+// Free whatever an entry holds and unlink it from its hash chain.
+// The slot stays where it is in the LRU list.
+// Returns 0 if a worker still has a job for it (must not be evicted).
+static int texcache_evict(int cache_index)
+{
+	int hash2, ptx, ntx;
+	uint16_t flags = flags_load(&sdlt[cache_index]);
 
-		if (ptx == STX_NONE) {
-			if (sdlt_cache[hash2] != cache_index) {
-				fail("sdli[sprite].cache_index!=cache_index\n");
-				exit(42);
-			}
-			sdlt_cache[hash2] = ntx;
-		} else {
-			sdlt[ptx].hnext = sdlt[cache_index].hnext;
-		}
+	// Check work_state (workers never move a slot out of TX_WORK_IDLE)
+	if (sdl_multi && (flags & SF_SPRITE) && work_state_load(&sdlt[cache_index]) != TX_WORK_IDLE) {
+		return 0;
+	}
+
+	if (flags) {
+		texc_evicts[sdlt[cache_index].lru]++;
+	}
+	if (sdlt[cache_index].light_seen) {
+		texc_collapsed -= __builtin_popcount(sdlt[cache_index].light_seen) - 1;
+		sdlt[cache_index].light_seen = 0;
+	}
+	sdlt[cache_index].alpha = 255;
+	sdlt[cache_index].wait_warned = 0;
+
+	if (flags & SF_SPRITE) {
+		hash2 = (int)hashfunc(sdlt[cache_index].sprite, sdlt[cache_index].ml, sdlt[cache_index].ll,
+		    sdlt[cache_index].rl, sdlt[cache_index].ul, sdlt[cache_index].dl);
+	} else if (flags & SF_TEXT) {
+		hash2 = (int)hashfunc_text(
+		    sdlt[cache_index].text, (int)sdlt[cache_index].text_color, sdlt[cache_index].text_flags);
+	} else {
+		hash2 = 0;
+		warn("weird entry in texture cache!");
+	}
 
-		if (ntx != STX_NONE) {
-			sdlt[ntx].hprev = sdlt[cache_index].hprev;
+	ntx = sdlt[cache_index].hnext;
+	ptx = sdlt[cache_index].hprev;
+
+	if (ptx == STX_NONE) {
+		if (sdlt_cache[hash2] != cache_index) {
+			fail("sdli[sprite].cache_index!=cache_index\n");
+			exit(42);
 		}
+		sdlt_cache[hash2] = ntx;
+	} else {
+		sdlt[ptx].hnext = sdlt[cache_index].hnext;
+	}
 
-		flags = flags_load(&sdlt[cache_index]);
-		if (flags & SF_DIDTEX) {
-			__atomic_sub_fetch(
-			    &mem_tex, sdlt[cache_index].xres * sdlt[cache_index].yres * sizeof(uint32_t), __ATOMIC_RELAXED);
-			if (sdlt[cache_index].tex) {
-				SDL_DestroyTexture(sdlt[cache_index].tex);
-				sdlt[cache_index].tex = NULL; // Clear pointer after destroying
-			}
-		} else if (flags & SF_DIDALLOC) {
-			if (sdlt[cache_index].pixel) {
+	if (ntx != STX_NONE) {
+		sdlt[ntx].hprev = sdlt[cache_index].hprev;
+	}
+	sdlt[cache_index].hnext = STX_NONE;
+	sdlt[cache_index].hprev = STX_NONE;
+
+	if (flags & SF_DIDTEX) {
+		__atomic_sub_fetch(&mem_tex, sdlt[cache_index].mem, __ATOMIC_RELAXED);
+		sdlt[cache_index].mem = 0;
+		if (sdlt[cache_index].atlas != ATLAS_NONE) {
+			sdl_atlas_free(sdlt[cache_index].atlas, sdlt[cache_index].atlas_x, sdlt[cache_index].atlas_y);
+			sdlt[cache_index].atlas = ATLAS_NONE;
+			sdlt[cache_index].tex = NULL; // The page is shared, sdl_atlas_free() destroys it once empty
+		} else if (sdlt[cache_index].tex) {
+			SDL_DestroyTexture(sdlt[cache_index].tex);
+			sdlt[cache_index].tex = NULL; // Clear pointer after destroying
+		}
+	} else if (flags & SF_DIDALLOC) {
+		if (sdlt[cache_index].pixel) {
 #ifdef SDL_FAST_MALLOC
-				FREE(sdlt[cache_index].pixel);
+			FREE(sdlt[cache_index].pixel);
 #else
-				xfree(sdlt[cache_index].pixel);
+			xfree(sdlt[cache_index].pixel);
 #endif
-				sdlt[cache_index].pixel = NULL;
-			}
+			sdlt[cache_index].pixel = NULL;
 		}
+	}
 #ifdef SDL_FAST_MALLOC
-		if (flags & SF_TEXT) {
-			FREE(sdlt[cache_index].text);
-			sdlt[cache_index].text = NULL;
-		}
+	if (flags & SF_TEXT) {
+		FREE(sdlt[cache_index].text);
+		sdlt[cache_index].text = NULL;
+	}
 #else
-		if (flags & SF_TEXT) {
-			xfree(sdlt[cache_index].text);
-			sdlt[cache_index].text = NULL;
-		}
+	if (flags & SF_TEXT) {
+		xfree(sdlt[cache_index].text);
+		sdlt[cache_index].text = NULL;
+	}
 #endif
 
-		uint16_t *flags_ptr = (uint16_t *)&sdlt[cache_index].flags;
-		__atomic_store_n(flags_ptr, 0, __ATOMIC_RELEASE);
+	uint16_t *flags_ptr = (uint16_t *)&sdlt[cache_index].flags;
+	__atomic_store_n(flags_ptr, 0, __ATOMIC_RELEASE);
+
+	// Bump generation to invalidate any in-flight jobs for old contents
+	// Guard against wraparound: skip 0 which is reserved for "never valid"
+	uint32_t new_gen = sdlt[cache_index].generation + 1;
+	if (new_gen == 0) {
+		new_gen = 1;
+	}
+	sdlt[cache_index].generation = new_gen;
+	// Reset work_state to IDLE (we already verified it was IDLE above, and
+	// workers never leave that state on their own)
+	work_state_store(&sdlt[cache_index], TX_WORK_IDLE);
+
+	return 1;
+}
+
+// Evict least recently used entries while the textures use more than
+// sdl_cache_budget, and return the emptied slots to the spare pool (down to
+// MIN_TEXCACHE slots). Probation goes first, protected entries only when
+// that is not enough. Bounded per call so that lowering the budget doesn't
+// stall a frame. Entries drawn in this or the previous frame are kept even
+// over budget; evicting them would only reload them right away.
+// Render thread only.
+void sdl_tx_trim(void)
+{
+	int evicted = 0;
+
+	for (int list = TX_LRU_PROBATION; list < TX_LRU_LISTS; list++) {
+		int cache_index = sdlt_lru[list].last;
+
+		while (evicted < 64 && cache_index != STX_NONE && texcache_over_budget()) {
+			int prev = sdlt[cache_index].prev;
+			uint16_t flags = flags_load(&sdlt[cache_index]);
+
+			if (flags) {
+				// Everything further up the list is even more recent
+				if (sdl_frames - sdlt[cache_index].used_frame <= 1) {
+					break;
+				}
+				if (!texcache_evict(cache_index)) {
+					cache_index = prev;
+					continue;
+				}
+				evicted++;
+			}
+
+			if (sdlt_slots > MIN_TEXCACHE) {
+				sdl_tx_unlink(cache_index);
+				sdlt_spare[sdlt_spare_count++] = cache_index;
+				sdlt_slots--;
+			} else {
+				sdl_tx_worst(cache_index);
+			}
+
+			cache_index = prev;
+		}
+	}
+}
 
-		// Bump generation to invalidate any in-flight jobs for old contents
-		// Guard against wraparound: skip 0 which is reserved for "never valid"
-		uint32_t new_gen = sdlt[cache_index].generation + 1;
-		if (new_gen == 0) {
-			new_gen = 1;
+// Acquire a slot from the cache (evicting LRU entry if needed)
+// Returns a cache index that is safe to reuse, or STX_NONE if we must bail
+static int texcache_acquire_slot(void)
+{
+	int list = sdlt_lru[TX_LRU_PROBATION].count ? TX_LRU_PROBATION : TX_LRU_PROTECTED;
+	int cache_index = sdlt_lru[list].last;
+
+	// Empty slots sit at the probation tail. If there is none left but the
+	// textures still fit the budget, grow the table instead of evicting.
+	if (flags_load(&sdlt[cache_index]) && !texcache_over_budget()) {
+		int spare = texcache_grow();
+		if (spare != STX_NONE) {
+			cache_index = spare;
 		}
-		sdlt[cache_index].generation = new_gen;
-		// Reset work_state to IDLE (safe without mutex here: we already verified
-		// work_state was IDLE under mutex above, and flags are now cleared so no
-		// worker can queue new jobs for this slot until we reinitialize it)
-		sdlt[cache_index].work_state = TX_WORK_IDLE;
+	}
 
-		break; // Successfully evicted, exit the retry loop
+	// Try to evict an entry, potentially trying multiple LRU candidates if workers are stuck.
+	// Probation entries (seen once, e.g. by a prefetch scan) go before protected ones.
+	for (int eviction_attempts = 0; eviction_attempts < 10; eviction_attempts++) {
+		if (!flags_load(&sdlt[cache_index])) {
+			// Empty slot, just use it
+			break;
+		}
+
+		if (texcache_evict(cache_index)) {
+			break; // Successfully evicted, exit the retry loop
+		}
+
+		// Slot has queued or in-progress work, try the next candidate
+		int candidate = sdlt[cache_index].prev;
+		if (candidate == STX_NONE && list == TX_LRU_PROBATION) {
+			list = TX_LRU_PROTECTED;
+			candidate = sdlt_lru[list].last;
+		}
+		if (candidate == STX_NONE) {
+			break;
+		}
+		cache_index = candidate;
 	}
 
 	// *** SAFETY CHECK ***
 	// If after all that the entry is still non-empty, we failed to get a usable slot.
 	// Do NOT reuse it; that would corrupt the hash chains.
 	if (flags_load(&sdlt[cache_index])) {
+		// Workers hold all candidates: rather go over budget than fail
+		cache_index = texcache_grow();
+		if (cache_index == STX_NONE) {
 #ifdef DEVELOPER
-		sdl_eviction_failures++;
-		if (sdl_eviction_failures == 1 || (sdl_eviction_failures % 100) == 0) {
-			warn("SDL: texture cache eviction failed %d times; workers may be busy", sdl_eviction_failures);
-		}
+			static int sdl_eviction_failures = 0;
+			sdl_eviction_failures++;
+			if (sdl_eviction_failures == 1 || (sdl_eviction_failures % 100) == 0) {
+				warn("SDL: texture cache eviction failed %d times; workers may be busy", sdl_eviction_failures);
+			}
 #endif
-		// Could not free or find an empty entry in the limited attempts.
-		// Safer to bail out than corrupt the cache.
-		return STX_NONE;
+			// Could not free or find an empty entry in the limited attempts.
+			// Safer to bail out than corrupt the cache.
+			return STX_NONE;
+		}
 	}
 
 	// From here on, cache_index is guaranteed empty
@@ -735,37 +1248,45 @@ static int tex_entry_ensure_ready(int cache_index, const struct tex_request *r)
 	/* Sprite path - wait for workers and ensure GPU texture is ready */
 	if (!r->preload && (flags_load(&sdlt[cache_index]) & SF_SPRITE)) {
 		// Wait for background workers to complete processing
-		int panic = 0;
 #ifdef DEVELOPER
 		uint64_t wait_start = 0;
 #endif
-		while (!(flags_load(&sdlt[cache_index]) & SF_DIDMAKE)) {
+		if (!(flags_load(&sdlt[cache_index]) & SF_DIDMAKE)) {
+			int done;
 #ifdef DEVELOPER
-			if (wait_start == 0) {
-				wait_start = SDL_GetTicks();
-				extern uint64_t sdl_render_wait_count;
-				sdl_render_wait_count++;
-			}
+			wait_start = SDL_GetTicks();
+			extern uint64_t sdl_render_wait_count;
+			sdl_render_wait_count++;
 #endif
+			if ((!sdl_multi || (game_options & GO_HELPOUT)) && sdl_pre_help(cache_index)) {
+				// Made it right here, no worker had started on it yet
+				done = 1;
+			} else {
+				// Don't wait behind queued prefetches, then sleep until the worker is done
+				sdl_pre_promote(cache_index);
+				done = tex_jobs_wait_done(cache_index, 1000);
+			}
 
-			// (function guards on sdl_multi internally)
-			if_single_thread_process_one_job();
-
-			SDL_Delay(1);
+			if (!(flags_load(&sdlt[cache_index]) & SF_DIDMAKE)) {
+				// Worker is stuck, too slow or failed - give up this frame rather than corrupting memory.
+				// Said once per entry, the entry is asked for again every frame it is on screen.
+				if (sdlt[cache_index].wait_warned) {
+					return STX_NONE;
+				}
+				sdlt[cache_index].wait_warned = 1;
 
-			if (panic++ > 1000) {
 				uint16_t flags = flags_load(&sdlt[cache_index]);
 				uint8_t wstate = work_state_load(&sdlt[cache_index]);
 				const char *wstate_str = (wstate == TX_WORK_IDLE)        ? "idle"
 				                         : (wstate == TX_WORK_QUEUED)    ? "queued"
 				                         : (wstate == TX_WORK_IN_WORKER) ? "in_worker"
 				                                                         : "unknown";
-				// Worker is stuck or taking too long - give up this frame rather than corrupting memory
-				warn("Render thread timeout waiting for sprite %d (cache_index=%d, work_state=%s, flags=%s%s%s) - "
+				warn("Render thread %s waiting for sprite %d (cache_index=%d, work_state=%s, flags=%s%s%s) - "
 				     "giving up "
 				     "this frame",
-				    sdlt[cache_index].sprite, cache_index, wstate_str, (flags & SF_DIDALLOC) ? "didalloc " : "",
-				    (flags & SF_DIDMAKE) ? "didmake " : "", (flags & SF_DIDTEX) ? "didtex" : "");
+				    done ? "failed" : "timeout", sdlt[cache_index].sprite, cache_index, wstate_str,
+				    (flags & SF_DIDALLOC) ? "didalloc " : "", (flags & SF_DIDMAKE) ? "didmake " : "",
+				    (flags & SF_DIDTEX) ? "didtex" : "");
 				// Return STX_NONE to skip this texture this frame - better than use-after-free
 				return STX_NONE;
 			}
@@ -843,15 +1364,16 @@ int sdl_tx_load(uint32_t sprite, signed char sink, unsigned char freeze, unsigne
 			return STX_NONE;
 		}
 
-		// Promote to head of LRU and hash chain (cache hit optimization)
-		sdl_tx_best(cache_index);
-		texcache_promote_to_hash_head(cache_index, hash);
-
-		// Update statistics
+		// Update statistics (by the LRU list the hit came from)
 		if (!preload) {
 			texc_hit++;
+			texc_hits[sdlt[cache_index].lru]++;
 		}
 
+		// Promote to head of the protected LRU list and hash chain (cache hit optimization)
+		sdl_tx_best(cache_index);
+		texcache_promote_to_hash_head(cache_index, hash);
+
 		return cache_index;
 	}
 	if (checkonly) {
@@ -1000,10 +1522,10 @@ void sdl_dump_spritecache(void)
 			    sdlt[n].text_flags, sdlt[n].text_font, sdlt[n].text, sdlt[n].xres, sdlt[n].yres);
 		}
 
-		size += (double)(sdlt[n].xres) * (double)(sdlt[n].yres) * sizeof(uint32_t);
+		size += (double)(sdlt[n].xres) * (double)(sdlt[n].yres) * sizeof(uint32_t) * sdl_scale * sdl_scale;
 	}
 	fprintf(fp, "\n%d unique sprites, %d sprites + %d texts of %d used. %.2fM texture memory.\n", uni, cnt, text,
-	    MAX_TEXCACHE, size / (1024.0 * 1024.0));
+	    sdlt_slots, size / (1024.0 * 1024.0));
 	fclose(fp);
 	xfree(dumpidx);
 }
@@ -1041,7 +1563,8 @@ int sdl_tex_yres(int cache_index)
 
 void sdl_tex_alpha(int cache_index, int alpha)
 {
-	if (sdlt[cache_index].tex) {
+	sdlt[cache_index].alpha = (uint8_t)alpha;
+	if (sdlt[cache_index].tex && sdlt[cache_index].atlas == ATLAS_NONE) {
 		SDL_SetTextureAlphaMod(sdlt[cache_index].tex, (Uint8)alpha);
 	}
 }
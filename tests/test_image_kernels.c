@@ -0,0 +1,703 @@
+/*
+ * Image Kernel Tests - Pixel processing against reference implementations
+ *
+ * Checks that the optimised pixel kernels in sdl_image.c and sdl_effects.c
+ * give the same result as the straightforward versions they replaced, and
+ * times both.
+ * No SDL init, no I/O.
+ */
+
+#include "../src/astonia.h"
+#include "../src/sdl/sdl_private.h"
+#include "../src/sdl/sdl.h"
+#include "test.h"
+
+#include <math.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+
+static uint32_t rnd_state = 12345;
+
+static uint32_t rnd(void)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 8 ^ rnd_state << 13;
+}
+
+// Random pixels, a quarter of them fully transparent, blown up by scale the
+// way sdl_load_image_png() does it before smoothing.
+static void make_upscaled(uint32_t *pixel, int xres, int yres, int scale)
+{
+	for (int y = 0; y < yres; y += scale) {
+		for (int x = 0; x < xres; x += scale) {
+			uint32_t c = rnd();
+			if (!(c & 0x300)) {
+				c &= 0x00ffffff;
+			}
+			for (int dy = 0; dy < scale && y + dy < yres; dy++) {
+				for (int dx = 0; dx < scale && x + dx < xres; dx++) {
+					pixel[x + dx + (y + dy) * xres] = c;
+				}
+			}
+		}
+	}
+}
+
+static double ms_since(uint64_t start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// ============================================================================
+// sdl_smoothify
+// ============================================================================
+
+// sdl_smoothify() as it was: column by column, float mix_argb()
+static void smoothify_reference(uint32_t *pixel, int xres, int yres, int scale)
+{
+	int x, y;
+	uint32_t c1, c2, c3, c4;
+
+	switch (scale) {
+	case 2:
+		for (x = 0; x < xres - 2; x += 2) {
+			for (y = 0; y < yres - 2; y += 2) {
+				c1 = pixel[x + y * xres];
+				c2 = pixel[x + y * xres + 2];
+				c3 = pixel[x + y * xres + xres * 2];
+				c4 = pixel[x + y * xres + 2 + xres * 2];
+				pixel[x + y * xres + 1] = mix_argb(c1, c2, 0.5f, 0.5f);
+				pixel[x + y * xres + xres] = mix_argb(c1, c3, 0.5f, 0.5f);
+				pixel[x + y * xres + 1 + xres] =
+				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.5f, 0.5f);
+			}
+		}
+		break;
+	case 3:
+		for (x = 0; x < xres - 3; x += 3) {
+			for (y = 0; y < yres - 3; y += 3) {
+				c1 = pixel[x + y * xres];
+				c2 = pixel[x + y * xres + 3];
+				c3 = pixel[x + y * xres + xres * 3];
+				c4 = pixel[x + y * xres + 3 + xres * 3];
+				pixel[x + y * xres + 1] = mix_argb(c1, c2, 0.667f, 0.333f);
+				pixel[x + y * xres + 2] = mix_argb(c1, c2, 0.333f, 0.667f);
+				pixel[x + y * xres + xres * 1] = mix_argb(c1, c3, 0.667f, 0.333f);
+				pixel[x + y * xres + xres * 2] = mix_argb(c1, c3, 0.333f, 0.667f);
+				pixel[x + y * xres + 1 + xres * 1] =
+				    mix_argb(mix_argb(c1, c2, 0.5f, 0.5f), mix_argb(c3, c4, 0.5f, 0.5f), 0.5f, 0.5f);
+				pixel[x + y * xres + 2 + xres * 1] =
+				    mix_argb(mix_argb(c1, c2, 0.333f, 0.667f), mix_argb(c3, c4, 0.333f, 0.667f), 0.667f, 0.333f);
+				pixel[x + y * xres + 1 + xres * 2] =
+				    mix_argb(mix_argb(c1, c2, 0.667f, 0.333f), mix_argb(c3, c4, 0.667f, 0.333f), 0.333f, 0.667f);
+				pixel[x + y * xres + 2 + xres * 2] =
+				    mix_argb(mix_argb(c1, c2, 0.333f, 0.667f), mix_argb(c3, c4, 0.333f, 0.667f), 0.333f, 0.667f);
+			}
+		}
+		break;
+	case 4:
+		for (x = 0; x < xres - 4; x += 4) {
+			for (y = 0; y < yres - 4; y += 4) {
+				static const float w[4] = {1.0f, 0.75f, 0.5f, 0.25f};
+				c1 = pixel[x + y * xres];
+				c2 = pixel[x + y * xres + 4];
+				c3 = pixel[x + y * xres + xres * 4];
+				c4 = pixel[x + y * xres + 4 + xres * 4];
+				for (int i = 1; i < 4; i++) {
+					pixel[x + y * xres + i] = mix_argb(c1, c2, w[i], 1.0f - w[i]);
+					pixel[x + y * xres + xres * i] = mix_argb(c1, c3, w[i], 1.0f - w[i]);
+				}
+				for (int i = 1; i < 4; i++) {
+					for (int j = 1; j < 4; j++) {
+						pixel[x + i + y * xres + xres * j] = mix_argb(mix_argb(c1, c2, w[i], 1.0f - w[i]),
+						    mix_argb(c3, c4, w[i], 1.0f - w[i]), w[j], 1.0f - w[j]);
+					}
+				}
+			}
+		}
+		break;
+	}
+}
+
+TEST(test_smoothify_matches_reference)
+{
+	static const int size[][2] = {{1, 1}, {2, 3}, {5, 5}, {17, 9}, {40, 64}, {101, 77}};
+
+	fprintf(stderr, "  → Comparing sdl_smoothify with the float version...\n");
+
+	for (int scale = 2; scale <= 4; scale++) {
+		for (int s = 0; s < (int)(sizeof(size) / sizeof(size[0])); s++) {
+			int xres = size[s][0] * scale, yres = size[s][1] * scale;
+			size_t n = (size_t)xres * (size_t)yres;
+			uint32_t *a = MALLOC((size_t)(xres + 1) * (size_t)(yres + 1) * sizeof(uint32_t));
+			uint32_t *b = MALLOC((size_t)(xres + 1) * (size_t)(yres + 1) * sizeof(uint32_t));
+			ASSERT_PTR_NOT_NULL(a);
+			ASSERT_PTR_NOT_NULL(b);
+
+			make_upscaled(a, xres, yres, scale);
+			memcpy(b, a, n * sizeof(uint32_t));
+			smoothify_reference(a, xres, yres, scale);
+			sdl_smoothify(b, xres, yres, scale);
+			ASSERT_TRUE(memcmp(a, b, n * sizeof(uint32_t)) == 0);
+
+			// Sizes that are not a multiple of scale are left alone the same way
+			make_upscaled(a, xres + 1, yres - 1, scale);
+			memcpy(b, a, (size_t)(xres + 1) * (size_t)(yres - 1) * sizeof(uint32_t));
+			smoothify_reference(a, xres + 1, yres - 1, scale);
+			sdl_smoothify(b, xres + 1, yres - 1, scale);
+			ASSERT_TRUE(memcmp(a, b, (size_t)(xres + 1) * (size_t)(yres - 1) * sizeof(uint32_t)) == 0);
+
+			FREE(a);
+			FREE(b);
+		}
+	}
+
+	fprintf(stderr, "  ✓ sdl_smoothify output is identical at scale 2, 3 and 4\n");
+}
+
+TEST(test_smoothify_benchmark)
+{
+	const int xres = 256, yres = 256, rounds = 20;
+
+	fprintf(stderr, "  → Timing sdl_smoothify on %dx%d sprites...\n", xres, yres);
+
+	for (int scale = 2; scale <= 4; scale++) {
+		int w = xres * scale, h = yres * scale;
+		size_t n = (size_t)w * (size_t)h;
+		uint32_t *src = MALLOC(n * sizeof(uint32_t));
+		uint32_t *dst = MALLOC(n * sizeof(uint32_t));
+		double t_ref = 0, t_new = 0;
+		uint64_t start;
+		ASSERT_PTR_NOT_NULL(src);
+		ASSERT_PTR_NOT_NULL(dst);
+
+		make_upscaled(src, w, h, scale);
+		for (int r = 0; r < rounds; r++) {
+			memcpy(dst, src, n * sizeof(uint32_t));
+			start = SDL_GetPerformanceCounter();
+			smoothify_reference(dst, w, h, scale);
+			t_ref += ms_since(start);
+
+			memcpy(dst, src, n * sizeof(uint32_t));
+			start = SDL_GetPerformanceCounter();
+			sdl_smoothify(dst, w, h, scale);
+			t_new += ms_since(start);
+		}
+		fprintf(stderr, "    scale %d: reference %.3f ms, sdl_smoothify %.3f ms, %.1fx\n", scale, t_ref / rounds,
+		    t_new / rounds, t_new > 0 ? t_ref / t_new : 0.0);
+
+		FREE(src);
+		FREE(dst);
+	}
+}
+
+// ============================================================================
+// sdl_resample
+// ============================================================================
+
+// The bilinear scaling sdl_make() did per output pixel, in double
+static void resample_reference(uint32_t *dst, int dw, int dh, const uint32_t *src, int sw, int sh, int scale)
+{
+	for (int y = 0; y < dh; y++) {
+		for (int x = 0; x < dw; x++) {
+			double ix = x * 100.0 / scale, iy = y * 100.0 / scale;
+			double dba = 0, dbr = 0, dbg = 0, dbb = 0;
+
+			if (ceil(ix) >= sw) {
+				ix = sw - 1.001;
+			}
+			if (ceil(iy) >= sh) {
+				iy = sh - 1.001;
+			}
+			double high_x = ix - floor(ix), high_y = iy - floor(iy);
+			double low_x = 1 - high_x, low_y = 1 - high_y;
+			int x0 = (int)floor(ix), x1 = (int)ceil(ix), y0 = (int)floor(iy), y1 = (int)ceil(iy);
+			uint32_t c[4] = {src[x0 + y0 * sw], src[x1 + y0 * sw], src[x0 + y1 * sw], src[x1 + y1 * sw]};
+			double w[4] = {low_x * low_y, high_x * low_y, low_x * high_y, high_x * high_y};
+
+			for (int i = 0; i < 4; i++) {
+				dba += IGET_A(c[i]) * w[i];
+				dbr += IGET_R(c[i]) * w[i];
+				dbg += IGET_G(c[i]) * w[i];
+				dbb += IGET_B(c[i]) * w[i];
+			}
+			dst[x + y * dw] = IRGBA((int)dbr, (int)dbg, (int)dbb, (int)dba);
+		}
+	}
+}
+
+static int channel_diff(uint32_t a, uint32_t b)
+{
+	int d = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		d = max(d, abs((int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff)));
+	}
+	return d;
+}
+
+TEST(test_resample_matches_reference)
+{
+	static const int scales[] = {25, 50, 66, 85, 99, 101, 120, 150, 200};
+	static const int size[][2] = {{2, 2}, {3, 7}, {40, 40}, {97, 61}};
+	int worst = 0;
+
+	fprintf(stderr, "  → Comparing sdl_resample with the double version...\n");
+
+	for (int k = 0; k < (int)(sizeof(scales) / sizeof(scales[0])); k++) {
+		for (int s = 0; s < (int)(sizeof(size) / sizeof(size[0])); s++) {
+			int scale = scales[k], sw = size[s][0], sh = size[s][1];
+			int dw = (int)ceil((sw - 1) * (double)scale / 100.0), dh = (int)ceil((sh - 1) * (double)scale / 100.0);
+			uint32_t *src = MALLOC((size_t)sw * (size_t)sh * sizeof(uint32_t));
+			uint32_t *a = MALLOC((size_t)dw * (size_t)dh * sizeof(uint32_t) + 1);
+			uint32_t *b = MALLOC((size_t)dw * (size_t)dh * sizeof(uint32_t) + 1);
+			ASSERT_PTR_NOT_NULL(src);
+			ASSERT_PTR_NOT_NULL(a);
+			ASSERT_PTR_NOT_NULL(b);
+
+			make_upscaled(src, sw, sh, 1);
+			resample_reference(a, dw, dh, src, sw, sh, scale);
+			sdl_resample(b, dw, dh, src, sw, sh, scale);
+			for (int i = 0; i < dw * dh; i++) {
+				worst = max(worst, channel_diff(a[i], b[i]));
+			}
+
+			FREE(src);
+			FREE(a);
+			FREE(b);
+		}
+	}
+	ASSERT_TRUE(worst <= 1);
+
+	fprintf(stderr, "  ✓ sdl_resample is within %d of the double version\n", worst);
+}
+
+TEST(test_resample_benchmark)
+{
+	static const int scales[] = {50, 85, 150};
+	const int sw = 400, sh = 400, rounds = 10;
+
+	fprintf(stderr, "  → Timing sdl_resample on %dx%d sprites...\n", sw, sh);
+
+	uint32_t *src = MALLOC((size_t)sw * (size_t)sh * sizeof(uint32_t));
+	ASSERT_PTR_NOT_NULL(src);
+	make_upscaled(src, sw, sh, 1);
+
+	for (int k = 0; k < (int)(sizeof(scales) / sizeof(scales[0])); k++) {
+		int scale = scales[k];
+		int dw = (int)ceil((sw - 1) * (double)scale / 100.0), dh = (int)ceil((sh - 1) * (double)scale / 100.0);
+		uint32_t *dst = MALLOC((size_t)dw * (size_t)dh * sizeof(uint32_t));
+		double t_ref = 0, t_new = 0;
+		uint64_t start;
+		ASSERT_PTR_NOT_NULL(dst);
+
+		for (int r = 0; r < rounds; r++) {
+			start = SDL_GetPerformanceCounter();
+			resample_reference(dst, dw, dh, src, sw, sh, scale);
+			t_ref += ms_since(start);
+
+			start = SDL_GetPerformanceCounter();
+			sdl_resample(dst, dw, dh, src, sw, sh, scale);
+			t_new += ms_since(start);
+		}
+		fprintf(stderr, "    scale %3d%%: reference %.3f ms, sdl_resample %.3f ms, %.1fx\n", scale, t_ref / rounds,
+		    t_new / rounds, t_new > 0 ? t_ref / t_new : 0.0);
+
+		FREE(dst);
+	}
+	FREE(src);
+}
+
+// ============================================================================
+// sdl_light
+// ============================================================================
+
+// sdl_light() as it was, calculating every channel
+static uint32_t light_reference(int light, uint32_t irgb)
+{
+	int c[3] = {(int)IGET_R(irgb), (int)IGET_G(irgb), (int)IGET_B(irgb)};
+
+	for (int i = 0; i < 3; i++) {
+		if (light == 0) {
+			c[i] = min(255, c[i] * 2 + 4);
+		} else if (game_options & (GO_LIGHTER | GO_LIGHTER2)) {
+			int v1 = c[i] * light / 15, v2 = (int)(c[i] * sqrt(light) / 3.87), m = 3, d = 4;
+			if (game_options & GO_LIGHTER) {
+				m--;
+				d--;
+			}
+			if (game_options & GO_LIGHTER2) {
+				m -= 2;
+				d -= 2;
+			}
+			c[i] = (v1 * m + v2) / d;
+		} else {
+			c[i] = c[i] * light / 15;
+		}
+	}
+	return IRGBA(c[0], c[1], c[2], IGET_A(irgb));
+}
+
+TEST(test_light_tables_match_formula)
+{
+	static const uint64_t options[] = {0, GO_LIGHTER, GO_LIGHTER2, GO_LIGHTER | GO_LIGHTER2};
+	uint64_t old_options = game_options;
+	int bad = 0;
+
+	fprintf(stderr, "  → Comparing the sdl_light() tables with the formula...\n");
+
+	sdl_light_init();
+	for (int o = 0; o < 4; o++) {
+		game_options = options[o];
+		for (int light = 0; light <= 20; light++) {
+			for (int v = 0; v < 256; v++) {
+				uint32_t irgb = IRGBA(v, 255 - v, v / 2, 0x80);
+				bad += light_reference(light, irgb) != sdl_light(light, irgb);
+			}
+		}
+		ASSERT_EQ_INT((int)IGET_R(light_reference(7, IRGB(255, 0, 0))), (int)(sdl_light_factor(7) * 255.0f + 0.5f));
+	}
+	game_options = old_options;
+	ASSERT_EQ_INT(0, bad);
+
+	fprintf(stderr, "  ✓ sdl_light() matches for all option sets and levels 0-20\n");
+}
+
+TEST(test_light_benchmark)
+{
+	const int n = 400 * 400, rounds = 10;
+	uint32_t *pixel = MALLOC((size_t)n * sizeof(uint32_t));
+	uint64_t old_options = game_options, start;
+	double t_ref = 0, t_new = 0;
+	uint32_t sum = 0;
+	ASSERT_PTR_NOT_NULL(pixel);
+
+	fprintf(stderr, "  → Timing sdl_light() with GO_LIGHTER on %d pixels...\n", n);
+
+	sdl_light_init();
+	game_options = GO_LIGHTER;
+	make_upscaled(pixel, 400, 400, 1);
+	for (int r = 0; r < rounds; r++) {
+		start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < n; i++) {
+			sum += light_reference(1 + (i & 7), pixel[i]);
+		}
+		t_ref += ms_since(start);
+
+		start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < n; i++) {
+			sum += sdl_light(1 + (i & 7), pixel[i]);
+		}
+		t_new += ms_since(start);
+	}
+	game_options = old_options;
+	FREE(pixel);
+
+	fprintf(stderr, "    formula %.3f ms, tables %.3f ms, %.1fx (%08x)\n", t_ref / rounds, t_new / rounds,
+	    t_new > 0 ? t_ref / t_new : 0.0, sum);
+}
+
+// ============================================================================
+// sdl_fx_apply
+// ============================================================================
+
+struct fx_case {
+	const char *name;
+	int8_t ml, ll, rl, ul, dl;
+	int16_t cr, cg, cb, light, sat;
+	uint16_t shine;
+	uint8_t freeze;
+	int sink, dropalpha;
+	uint64_t options;
+};
+
+static const struct fx_case fx_cases[] = {
+    {"plain", 15, 15, 15, 15, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {"light", 9, 9, 9, 9, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {"light, dropalpha", 4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0},
+    {"light 0", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {"lighter", 7, 7, 7, 7, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, GO_LIGHTER},
+    {"lighter2", 12, 12, 12, 12, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0, GO_LIGHTER | GO_LIGHTER2},
+    {"light, sink, freeze", 11, 11, 11, 11, 11, 0, 0, 0, 0, 0, 0, 3, 6, 0, 0},
+    {"directional", 10, 3, 15, 0, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {"directional, all", 10, 3, 15, 0, 7, 20, -10, 5, 8, 4, 30, 2, 5, 1, GO_LIGHTER},
+    {"balance", 15, 15, 15, 15, 15, 12, -6, 20, -4, 6, 0, 0, 0, 0, 0},
+    {"shine", 13, 13, 13, 13, 13, 0, 0, 0, 0, 0, 50, 0, 0, 0, 0},
+    {"overflow", 40, 40, 40, 40, 40, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+static void fx_setup(struct sdl_texture *st, const struct fx_case *c, int w, int h)
+{
+	memset(st, 0, sizeof(*st));
+	st->ml = c->ml;
+	st->ll = c->ll;
+	st->rl = c->rl;
+	st->ul = c->ul;
+	st->dl = c->dl;
+	st->cr = c->cr;
+	st->cg = c->cg;
+	st->cb = c->cb;
+	st->light = c->light;
+	st->sat = c->sat;
+	st->shine = c->shine;
+	st->freeze = c->freeze;
+	st->sink = (int8_t)c->sink;
+	st->xres = (uint16_t)(w / sdl_scale);
+	st->yres = (uint16_t)(h / sdl_scale);
+	game_options = c->options;
+}
+
+TEST(test_effects_match_generic)
+{
+	// Wider and taller than a tile, and narrower with a ragged end
+	static const int size[][2] = {{48, 60}, {37, 23}};
+	const int max_n = 48 * 2 * 60 * 2;
+	uint32_t *src = MALLOC((size_t)max_n * sizeof(uint32_t));
+	uint32_t *a = MALLOC((size_t)max_n * sizeof(uint32_t));
+	uint32_t *b = MALLOC((size_t)max_n * sizeof(uint32_t));
+	int old_scale = sdl_scale;
+	uint64_t old_options = game_options;
+	ASSERT_PTR_NOT_NULL(src);
+	ASSERT_PTR_NOT_NULL(a);
+	ASSERT_PTR_NOT_NULL(b);
+
+	fprintf(stderr, "  → Comparing the effect kernels with sdl_fx_generic()...\n");
+
+	for (int s = 1; s <= 2; s++) {
+		sdl_scale = s;
+		sdl_light_init();
+		for (int i = 0; i < max_n; i++) {
+			uint32_t c = rnd();
+			// Mostly opaque or transparent, like sprites
+			src[i] = (c & 0x30000000) ? c | 0xff000000 : (c & 0x40000000) ? c & 0x00ffffff : c;
+		}
+		for (int z = 0; z < (int)(sizeof(size) / sizeof(size[0])); z++) {
+			int w = size[z][0] * s, h = size[z][1] * s;
+			size_t bytes = (size_t)w * (size_t)h * sizeof(uint32_t);
+
+			for (int k = 0; k < (int)(sizeof(fx_cases) / sizeof(fx_cases[0])); k++) {
+				struct sdl_texture st;
+				struct sdl_fx fx;
+
+				fx_setup(&st, &fx_cases[k], w, h);
+				sdl_fx_prepare(&fx, &st, st.sink, fx_cases[k].dropalpha);
+				sdl_fx_generic(&fx, a, src, w, h);
+				sdl_fx_apply(&fx, b, src, w, h);
+				if (memcmp(a, b, bytes)) {
+					fprintf(stderr, "  ✗ %s differs at %dx%d, scale %d\n", fx_cases[k].name, w, h, s);
+					ASSERT_TRUE(0);
+				}
+
+				// In place, as sdl_make() does after colorizing
+				memcpy(b, src, bytes);
+				sdl_fx_apply(&fx, b, b, w, h);
+				ASSERT_TRUE(memcmp(a, b, bytes) == 0);
+			}
+		}
+	}
+
+	sdl_scale = old_scale;
+	sdl_light_init();
+	game_options = old_options;
+	FREE(src);
+	FREE(a);
+	FREE(b);
+
+	fprintf(stderr, "  ✓ All %d effect combinations match at scale 1 and 2\n",
+	    (int)(sizeof(fx_cases) / sizeof(fx_cases[0])));
+}
+
+TEST(test_effects_benchmark)
+{
+	static const int bench[] = {1, 2, 4, 7, 8, 9};
+	// As many pixels as 400x400, in the shape of a long column of tiles
+	const int w = 40, h = 4000, rounds = 10;
+	uint32_t *src = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+	uint32_t *dst = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+	uint64_t old_options = game_options;
+	ASSERT_PTR_NOT_NULL(src);
+	ASSERT_PTR_NOT_NULL(dst);
+
+	fprintf(stderr, "  → Timing the effect kernels on %dx%d sprites...\n", w, h);
+
+	sdl_light_init();
+	make_upscaled(src, w, h, 1);
+	for (int k = 0; k < (int)(sizeof(bench) / sizeof(bench[0])); k++) {
+		const struct fx_case *c = &fx_cases[bench[k]];
+		struct sdl_texture st;
+		struct sdl_fx fx;
+		double t_ref = 0, t_new = 0;
+		uint64_t start;
+
+		fx_setup(&st, c, w, h);
+		for (int r = 0; r < rounds; r++) {
+			start = SDL_GetPerformanceCounter();
+			sdl_fx_prepare(&fx, &st, st.sink, c->dropalpha);
+			sdl_fx_generic(&fx, dst, src, w, h);
+			t_ref += ms_since(start);
+
+			start = SDL_GetPerformanceCounter();
+			sdl_fx_prepare(&fx, &st, st.sink, c->dropalpha);
+			sdl_fx_apply(&fx, dst, src, w, h);
+			t_new += ms_since(start);
+		}
+		fprintf(stderr, "    %-20s generic %.3f ms, kernel %.3f ms, %.1fx\n", c->name, t_ref / rounds, t_new / rounds,
+		    t_new > 0 ? t_ref / t_new : 0.0);
+	}
+
+	game_options = old_options;
+	FREE(src);
+	FREE(dst);
+}
+
+// ============================================================================
+// sdl_colorize_image
+// ============================================================================
+
+// Pixels for colorizing: strong and weak green, blue and red next to grey
+// and transparent ones, in blobs so that the neighbours matter
+static void make_colorizable(uint32_t *pixel, int w, int h)
+{
+	static const uint32_t col[] = {0xff10e020, 0xff60b050, 0xff1020f0, 0xff5070c0, 0xffe01010, 0xffc06050,
+	    0xff808080, 0x00000000, 0xff30ff30, 0x80ff2020};
+
+	for (int y = 0; y < h; y += 3) {
+		for (int x = 0; x < w; x += 3) {
+			uint32_t c = col[rnd() % (sizeof(col) / sizeof(col[0]))];
+			for (int dy = 0; dy < 3 && y + dy < h; dy++) {
+				for (int dx = 0; dx < 3 && x + dx < w; dx++) {
+					pixel[x + dx + (y + dy) * w] = (rnd() & 3) ? c : col[rnd() % (sizeof(col) / sizeof(col[0]))];
+				}
+			}
+		}
+	}
+}
+
+static const uint16_t palette[][3] = {
+    {0x7c00, 0, 0}, {0, 0x03e0, 0}, {0, 0, 0x001f}, {0x1234, 0x4321, 0x7fff}, {0x8000 | 0x2a5, 0x15a, 0x7000},
+    {0, 0x1111, 0x2222}, {0x3333, 0, 0x4444}, {0x0421, 0x0842, 0}};
+
+TEST(test_colorize_mask_matches_per_pixel)
+{
+	const int xres = 41, yres = 37;
+	int old_scale = sdl_scale;
+
+	fprintf(stderr, "  → Comparing sdl_colorize_image() with sdl_colorize_pix2()...\n");
+
+	for (int s = 1; s <= 3; s += 2) {
+		const int w = xres * s, h = yres * s;
+		struct sdl_image si = {0};
+		uint32_t *a = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+		uint32_t *b = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+		uint8_t *mask = NULL;
+		ASSERT_PTR_NOT_NULL(a);
+		ASSERT_PTR_NOT_NULL(b);
+
+		sdl_scale = s;
+		si.pixel = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+		ASSERT_PTR_NOT_NULL(si.pixel);
+		si.xres = (uint16_t)xres;
+		si.yres = (uint16_t)yres;
+		make_colorizable(si.pixel, w, h);
+
+		for (int k = 0; k < (int)(sizeof(palette) / sizeof(palette[0])); k++) {
+			for (int sprite = 100000; sprite <= 220000; sprite += 120000) {
+				struct sdl_texture st = {0};
+				st.sprite = (uint32_t)sprite;
+				st.c1 = palette[k][0];
+				st.c2 = palette[k][1];
+				st.c3 = palette[k][2];
+
+				for (int y = 0; y < h; y++) {
+					for (int x = 0; x < w; x++) {
+						a[x + y * w] = sdl_colorize_pix2(
+						    si.pixel[x + y * w], st.c1, st.c2, st.c3, x, y, xres, yres, si.pixel, sprite);
+					}
+				}
+				sdl_colorize_image(b, &si, &st);
+				ASSERT_TRUE(memcmp(a, b, (size_t)w * (size_t)h * sizeof(uint32_t)) == 0);
+			}
+			// Built once, then shared by the other palettes
+			ASSERT_PTR_NOT_NULL(si.cmask);
+			if (!mask) {
+				mask = si.cmask;
+			}
+			ASSERT_TRUE(si.cmask == mask);
+		}
+
+		FREE(si.cmask);
+		FREE(si.pixel);
+		FREE(a);
+		FREE(b);
+	}
+	sdl_scale = old_scale;
+
+	fprintf(stderr, "  ✓ Masked colorize matches for %d palettes at scale 1 and 3\n",
+	    (int)(sizeof(palette) / sizeof(palette[0])));
+}
+
+TEST(test_colorize_benchmark)
+{
+	const int w = 200, h = 200, n = (int)(sizeof(palette) / sizeof(palette[0]));
+	struct sdl_image si = {0};
+	uint32_t *dst = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+	double t_ref = 0, t_new = 0;
+	uint64_t start;
+	ASSERT_PTR_NOT_NULL(dst);
+
+	fprintf(stderr, "  → Timing %d colour variants of a %dx%d sprite...\n", n, w, h);
+
+	si.pixel = MALLOC((size_t)w * (size_t)h * sizeof(uint32_t));
+	ASSERT_PTR_NOT_NULL(si.pixel);
+	si.xres = (uint16_t)(w / sdl_scale);
+	si.yres = (uint16_t)(h / sdl_scale);
+	make_colorizable(si.pixel, w, h);
+
+	for (int k = 0; k < n; k++) {
+		struct sdl_texture st = {0};
+		st.sprite = 220000;
+		st.c1 = palette[k][0];
+		st.c2 = palette[k][1];
+		st.c3 = palette[k][2];
+
+		start = SDL_GetPerformanceCounter();
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				dst[x + y * w] = sdl_colorize_pix2(
+				    si.pixel[x + y * w], st.c1, st.c2, st.c3, x, y, si.xres, si.yres, si.pixel, (int)st.sprite);
+			}
+		}
+		t_ref += ms_since(start);
+
+		start = SDL_GetPerformanceCounter();
+		sdl_colorize_image(dst, &si, &st);
+		t_new += ms_since(start);
+	}
+	fprintf(stderr, "    per pixel %.3f ms, with mask %.3f ms (mask built once), %.1fx\n", t_ref, t_new,
+	    t_new > 0 ? t_ref / t_new : 0.0);
+
+	FREE(si.cmask);
+	FREE(si.pixel);
+	FREE(dst);
+}
+
+TEST_MAIN(
+    fprintf(stderr, "\n=== Smoothing ===\n");
+    test_smoothify_matches_reference();
+    test_smoothify_benchmark();
+
+    fprintf(stderr, "\n=== Scaling ===\n");
+    test_resample_matches_reference();
+    test_resample_benchmark();
+
+    fprintf(stderr, "\n=== Light ===\n");
+    test_light_tables_match_formula();
+    test_light_benchmark();
+
+    fprintf(stderr, "\n=== Effects ===\n");
+    test_effects_match_generic();
+    test_effects_benchmark();
+
+    fprintf(stderr, "\n=== Colorize ===\n");
+    test_colorize_mask_matches_per_pixel();
+    test_colorize_benchmark();
+)
@@ -11,8 +11,15 @@
 #include "../src/astonia.h"
 #include "../src/sdl/sdl_private.h"
 #include "../src/sdl/sdl.h"
+// sdl_private.h has the 32 bit colour macros, the tests use the game's 15 bit ones
+#undef IGET_R
+#undef IGET_G
+#undef IGET_B
+#undef IRGB
+#include "../src/game/game.h"
 #include "test.h"
 
+#include <math.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -20,10 +27,6 @@
 #define TEST_XOFF 0
 #define TEST_YOFF 0
 
-// IRGB macro for 15-bit color (game format, not 32-bit SDL format)
-#undef IRGB
-#define IRGB(r, g, b) (((r) << 10) | ((g) << 5) | ((b) << 0))
-
 // ============================================================================
 // Test: Basic Primitives (pixel, line)
 // ============================================================================
@@ -43,9 +46,9 @@ TEST(test_pixel_primitives)
 	sdl_pixel_alpha(0, 0, 0x7FFF, 0, TEST_XOFF, TEST_YOFF);
 	sdl_pixel_alpha(0, 0, 0x7FFF, 255, TEST_XOFF, TEST_YOFF);
 
-	// Verify render calls were made (points are rendered via SDL_RenderPoints)
-	ASSERT_TRUE(sdl_test_get_render_point_count() >= 5);
-	ASSERT_TRUE(sdl_test_get_set_draw_color_count() >= 5);
+	// Verify render calls were made (pixels are quads, drawn right away outside a batch)
+	ASSERT_EQ_INT(5, sdl_test_get_render_geometry_count());
+	ASSERT_EQ_INT(0, sdl_test_get_render_point_count());
 
 	fprintf(stderr, "     Pixel primitives OK\n");
 }
@@ -55,8 +58,8 @@ TEST(test_line_primitives)
 	fprintf(stderr, "  → Testing line primitives...\n");
 
 	// Line functions verified by code inspection:
-	// - sdl_line: clips coordinates, calls SDL_RenderLine
-	// - sdl_line_alpha: uses clip_line() for proper clipping, calls SDL_RenderLine
+	// - sdl_line: clips coordinates, queues a one pixel thick quad
+	// - sdl_line_alpha: uses clip_line() for proper clipping, queues a one pixel thick quad
 	// - sdl_line_aa: Xiaolin Wu algorithm, draws individual anti-aliased points
 	// - sdl_thick_line_alpha: uses SDL_RenderGeometry for GPU-accelerated quad
 	// This test verifies they don't crash with various inputs.
@@ -483,9 +486,8 @@ TEST(test_stress_many_draws)
 
 	// Verify all render calls were made
 	// 100 circles + 100 lines + 50 rects = 250 minimum total render calls
-	ASSERT_TRUE(sdl_test_get_render_point_count() >= 100);  // circles use points
-	ASSERT_TRUE(sdl_test_get_render_line_count() >= 100);   // lines
-	ASSERT_TRUE(sdl_test_get_render_fill_rect_count() >= 50); // rectangles
+	ASSERT_TRUE(sdl_test_get_render_point_count() >= 100);   // circles use points
+	ASSERT_TRUE(sdl_test_get_render_geometry_count() >= 150); // lines and rectangles are quads
 
 	fprintf(stderr, "     Stress test OK\n");
 }
@@ -625,6 +627,190 @@ TEST(test_thick_line_clipping)
 	fprintf(stderr, "     Thick line clipping OK\n");
 }
 
+// ============================================================================
+// Test: Directional Light Mesh
+// ============================================================================
+
+TEST(test_light_mesh)
+{
+	fprintf(stderr, "  → Testing directional light mesh...\n");
+
+	SDL_Vertex vertices[LIGHT_MESH_MAX_QUADS * 4];
+	int indices[LIGHT_MESH_MAX_QUADS * 6];
+	const float same[5] = {0.6f, 0.6f, 0.6f, 0.6f, 0.6f};
+	const float mixed[5] = {1.0f, 0.2f, 0.6f, 0.4f, 0.8f};
+	const SDL_FRect rects[3] = {{0, 0, 40, 60}, {3, 2, 30, 13}, {0, 0, 40, 12}};
+	int old_scale = sdl_scale;
+
+	for (int scale = 1; scale <= 2; scale++) {
+		sdl_scale = scale;
+		for (int r = 0; r < 3; r++) {
+			SDL_FRect sr = {rects[r].x * (float)scale, rects[r].y * (float)scale, rects[r].w * (float)scale,
+			    rects[r].h * (float)scale};
+
+			// Equal lights give an evenly lit mesh
+			int quads = sdl_light_mesh(&sr, 40.0f * (float)scale, 60.0f * (float)scale, same, 1.0f, vertices, indices);
+			ASSERT_IN_RANGE(quads, 1, LIGHT_MESH_MAX_QUADS);
+			for (int i = 0; i < quads * 4; i++) {
+				ASSERT_TRUE(vertices[i].color.r > 0.59f && vertices[i].color.r < 0.61f);
+			}
+
+			// The cells tile the clip rect exactly: no gaps, no overlap
+			quads = sdl_light_mesh(&sr, 40.0f * (float)scale, 60.0f * (float)scale, mixed, 1.0f, vertices, indices);
+			ASSERT_IN_RANGE(quads, 1, LIGHT_MESH_MAX_QUADS);
+			double area = 0;
+			for (int t = 0; t < quads * 2; t++) {
+				SDL_FPoint a = vertices[indices[t * 3]].position;
+				SDL_FPoint b = vertices[indices[t * 3 + 1]].position;
+				SDL_FPoint c = vertices[indices[t * 3 + 2]].position;
+				area += fabs((double)((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y))) / 2;
+			}
+			ASSERT_TRUE(fabs(area - (double)(sr.w * sr.h)) < 0.01);
+
+			for (int i = 0; i < quads * 4; i++) {
+				ASSERT_TRUE(vertices[i].position.x >= sr.x && vertices[i].position.x <= sr.x + sr.w);
+				ASSERT_TRUE(vertices[i].position.y >= sr.y && vertices[i].position.y <= sr.y + sr.h);
+				ASSERT_TRUE(vertices[i].color.r >= 0.2f && vertices[i].color.r <= 1.0f);
+			}
+		}
+	}
+
+	sdl_scale = old_scale;
+
+	fprintf(stderr, "     Light mesh OK\n");
+}
+
+// ============================================================================
+// Test: Text From The Glyph Atlas
+// ============================================================================
+
+TEST(test_text_glyph_atlas)
+{
+	fprintf(stderr, "  → Testing text drawn from the glyph atlas...\n");
+
+	static unsigned char glyph[] = {0, 254, 0, 254, 1, 255};
+	static unsigned char blank[] = {255};
+	struct renderfont font[TEXT_GLYPHS];
+	char longtext[TEXT_CACHE_LEN + 1];
+	int old_scale = sdl_scale, texts = 0;
+
+	sdl_scale = 1;
+	for (int i = 0; i < TEXT_GLYPHS; i++) {
+		font[i].dim = 4;
+		font[i].raw = i == ' ' ? blank : glyph;
+	}
+
+	// A whole string is one batch, and no texture cache entry
+	sdl_test_reset_render_counters();
+	ASSERT_EQ_INT(10 + 11 * 4, sdl_drawtext(10, 10, IRGB(31, 0, 0), 0, "Hello world", font, 0, 0, 800, 600, 0, 0));
+	ASSERT_EQ_INT(1, sdl_test_get_render_geometry_count());
+	ASSERT_EQ_INT(30, sdl_drawtext(30, 10, IRGB(0, 31, 0), RENDER_TEXT_RIGHT, "Hello", font, 0, 0, 800, 600, 0, 0));
+	ASSERT_EQ_INT(2, sdl_test_get_render_geometry_count());
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		ASSERT_TRUE(!(flags_load(&sdlt[i]) & SF_TEXT));
+	}
+
+	// Clipped away entirely, nothing is drawn
+	sdl_test_reset_render_counters();
+	sdl_drawtext(10, 10, IRGB(31, 0, 0), 0, "Hello", font, 0, 0, 5, 5, 0, 0);
+	ASSERT_EQ_INT(0, sdl_test_get_render_geometry_count());
+
+	// Long strings still get a texture of their own
+	memset(longtext, 'x', TEXT_CACHE_LEN);
+	longtext[TEXT_CACHE_LEN] = 0;
+	sdl_test_reset_render_counters();
+	sdl_drawtext(10, 10, IRGB(31, 0, 0), 0, longtext, font, 0, 0, 800, 600, 0, 0);
+	ASSERT_EQ_INT(0, sdl_test_get_render_geometry_count());
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		if (flags_load(&sdlt[i]) & SF_TEXT) {
+			texts++;
+		}
+	}
+	ASSERT_EQ_INT(1, texts);
+
+	// Uncached text of any length comes from the atlas as well
+	sdl_test_reset_render_counters();
+	sdl_drawtext(10, 10, IRGB(31, 0, 0), RENDER_TEXT_NOCACHE, longtext, font, 0, 0, 800, 600, 0, 0);
+	ASSERT_TRUE(sdl_test_get_render_geometry_count() > 0);
+	for (int i = 0, n = 0; i < MAX_TEXCACHE; i++) {
+		if (flags_load(&sdlt[i]) & SF_TEXT) {
+			n++;
+		}
+		ASSERT_TRUE(n <= texts);
+	}
+
+	// The atlas is keyed by the font, which lives on this stack frame
+	sdl_text_exit();
+	sdl_scale = old_scale;
+
+	fprintf(stderr, "     Glyph atlas text OK\n");
+}
+
+// ============================================================================
+// Test: Batched Pixels, Lines And Particles
+// ============================================================================
+
+TEST(test_primitive_batch)
+{
+	fprintf(stderr, "  → Testing batched pixels, lines and particles...\n");
+
+	int old_scale = sdl_scale;
+
+	sdl_scale = 2;
+	sdl_reset_blend_mode();
+
+	// Pixels and lines in a batch are one draw call
+	sdl_test_reset_render_counters();
+	sdl_batch_begin();
+	for (int i = 0; i < 300; i++) {
+		sdl_pixel(100 + i, 140, IRGB(31, 31, 31), TEST_XOFF, TEST_YOFF);
+	}
+	for (int i = 0; i < 20; i++) {
+		sdl_line(10, 10 + i, 300, 50 + i, IRGB(31, 31, 31), 0, 0, 800, 600, TEST_XOFF, TEST_YOFF);
+	}
+	ASSERT_EQ_INT(0, sdl_test_get_render_geometry_count());
+	sdl_batch_end();
+	ASSERT_EQ_INT(1, sdl_test_get_render_geometry_count());
+	ASSERT_EQ_INT(0, sdl_test_get_render_point_count());
+	ASSERT_EQ_INT(0, sdl_test_get_render_line_count());
+
+	// Bless and rain particles come from the particle atlas, one more
+	sdl_test_reset_render_counters();
+	sdl_batch_begin();
+	for (int i = 0; i < 100; i++) {
+		sdl_pretty_pixel(100 + i, 100, IRGB(24, 24, 31), TEST_XOFF, TEST_YOFF);
+		sdl_rain_pixel(100 + i, 120, IRGB(31, 24, 16), TEST_XOFF, TEST_YOFF);
+	}
+	ASSERT_EQ_INT(0, sdl_test_get_render_geometry_count());
+	sdl_batch_end();
+	ASSERT_EQ_INT(1, sdl_test_get_render_geometry_count());
+
+	// Outside a batch every particle is drawn right away, also at scale 1
+	sdl_test_reset_render_counters();
+	sdl_pretty_pixel(100, 100, IRGB(24, 24, 31), TEST_XOFF, TEST_YOFF);
+	sdl_scale = 1;
+	sdl_rain_pixel(100, 120, IRGB(31, 24, 16), TEST_XOFF, TEST_YOFF);
+	ASSERT_EQ_INT(2, sdl_test_get_render_geometry_count());
+	ASSERT_EQ_INT(0, sdl_test_get_render_point_count());
+	sdl_scale = 2;
+
+	// A different blend mode starts a new group
+	sdl_test_reset_render_counters();
+	sdl_batch_begin();
+	sdl_pixel(10, 10, IRGB(31, 0, 0), TEST_XOFF, TEST_YOFF);
+	sdl_pixel(11, 10, IRGB(31, 0, 0), TEST_XOFF, TEST_YOFF);
+	sdl_set_blend_mode(1); // BLEND_ADDITIVE
+	sdl_pixel(12, 10, IRGB(31, 0, 0), TEST_XOFF, TEST_YOFF);
+	sdl_set_blend_mode(0); // BLEND_NORMAL
+	sdl_batch_end();
+	ASSERT_EQ_INT(2, sdl_test_get_render_geometry_count());
+	ASSERT_EQ_INT(0, sdl_get_blend_mode());
+
+	sdl_scale = old_scale;
+
+	fprintf(stderr, "     Batched pixels, lines and particles OK\n");
+}
+
 // ============================================================================
 // Test: Mod Texture Path Validation Security
 // ============================================================================
@@ -683,6 +869,9 @@ TEST_MAIN(
 	test_circle_scaling();
 	test_line_clipping_slope();
 	test_thick_line_clipping();
+	test_light_mesh();
+	test_text_glyph_atlas();
+	test_primitive_batch();
 	test_mod_texture_path_validation();
 
 	sdl_shutdown_for_tests();
@@ -11,6 +11,8 @@
 
 #include "../src/astonia.h"  // Must come first for tick_t and other typedefs
 #include "../src/sdl/sdl_private.h"
+#include "../src/sdl/sdl.h"
+#include "../src/sdl/sdl_pack.h"
 #include "test.h"
 
 #include <string.h>
@@ -85,7 +87,7 @@ static void build_valid_sprite_list(void)
 
 			// Step 2: Try to actually load it with sdl_ic_load
 			// This validates the PNG can be decoded and has valid dimensions
-			if (sdl_ic_load(sprite_num, NULL) < 0) {
+			if (sdl_ic_load(sprite_num) < 0) {
 				filtered_load_failed++;
 				continue;
 			}
@@ -253,10 +255,404 @@ TEST(test_different_parameters_different_slots)
 	sdl_shutdown_for_tests();
 }
 
+TEST(test_light_variants_share_unlit_texture)
+{
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing light applied at draw time...\n");
+
+	unsigned int sprite = get_valid_sprite(0);
+
+	// Uniform light is a colour modulation: all levels share the unlit entry
+	int unlit = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, NULL, 0, 0, NULL, 0, 0);
+	int lit9 = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9, 9, 9, 9, 9, NULL, 0, 0, NULL, 0, 0);
+	ASSERT_IN_RANGE(unlit, 0, MAX_TEXCACHE - 1);
+	ASSERT_EQ_INT(unlit, lit9);
+	ASSERT_EQ_INT(TX_LIGHT_NORMAL, sdlt[unlit].ml);
+	ASSERT_EQ_INT(TX_LIGHT_NORMAL, sdlt[unlit].dl);
+
+	// Directional light is baked unless GO_GPULIGHT: each combination is its own entry
+	int baked1 = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 5, 12, 3, 15, NULL, 0, 0, NULL, 0, 0);
+	int baked2 = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 5, 4, 5, 4, NULL, 0, 0, NULL, 0, 0);
+	ASSERT_NE_INT(unlit, baked1);
+	ASSERT_NE_INT(baked1, baked2);
+
+	game_options |= GO_GPULIGHT;
+	int mixed1 = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 5, 12, 3, 15, NULL, 0, 0, NULL, 0, 0);
+	int mixed2 = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 5, 4, 5, 4, NULL, 0, 0, NULL, 0, 0);
+	ASSERT_EQ_INT(unlit, mixed1);
+	ASSERT_EQ_INT(unlit, mixed2);
+
+	// Freeze and light 0 (bright) can't be applied later, they stay baked
+	int frozen = sdl_tx_load(sprite, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, NULL, 0, 0, NULL, 0, 0);
+	int bright = sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0);
+	ASSERT_NE_INT(unlit, frozen);
+	ASSERT_NE_INT(unlit, bright);
+	ASSERT_EQ_INT(4, sdlt[frozen].ml);
+	game_options &= ~GO_GPULIGHT;
+
+	// Drawing the shared entry with three different lights counts two collapsed variants
+	ASSERT_EQ_INT(0, texc_collapsed);
+	sdl_blit_light(unlit, 4, 4, 4, 4, 4, 0, 0, 0, 0, 800, 600, 0, 0);
+	sdl_blit_light(unlit, 9, 9, 9, 9, 9, 0, 0, 0, 0, 800, 600, 0, 0);
+	sdl_blit_light(unlit, 10, 5, 12, 3, 15, 0, 0, 0, 0, 800, 600, 0, 0);
+	sdl_blit_light(unlit, 9, 9, 9, 9, 9, 0, 0, 0, 0, 800, 600, 0, 0);
+	sdl_blit_light(frozen, 4, 4, 4, 4, 4, 0, 0, 0, 0, 800, 600, 0, 0);
+	ASSERT_EQ_INT(2, texc_collapsed);
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	fprintf(stderr, "  ✓ Light variants share one unlit texture\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_atlas_cells_are_reused)
+{
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing atlas cell allocation...\n");
+
+	uint16_t x1, y1, x2, y2, x3, y3;
+
+	// Same size class, same page, different cells
+	int p1 = sdl_atlas_alloc(40, 20, &x1, &y1);
+	int p2 = sdl_atlas_alloc(64, 32, &x2, &y2);
+	ASSERT_IN_RANGE(p1, 0, ATLAS_MAX_PAGES - 1);
+	ASSERT_EQ_INT(p1, p2);
+	ASSERT_TRUE(x1 != x2 || y1 != y2);
+	ASSERT_EQ_INT(2, sdl_atlas[p1].used);
+
+	// Another size class starts its own page, too large ones get none
+	int p3 = sdl_atlas_alloc(40, 100, &x3, &y3);
+	ASSERT_NE_INT(p1, p3);
+	ASSERT_EQ_INT(ATLAS_NONE, sdl_atlas_alloc(ATLAS_MAX_CELL + 1, 20, &x3, &y3));
+	ASSERT_EQ_INT(2, sdl_atlas_pages);
+
+	// A freed cell is handed out again, an empty page goes away
+	sdl_atlas_free(p1, x1, y1);
+	ASSERT_EQ_INT(p1, sdl_atlas_alloc(50, 30, &x3, &y3));
+	ASSERT_EQ_INT(x1, x3);
+	ASSERT_EQ_INT(y1, y3);
+	sdl_atlas_free(p1, x2, y2);
+	sdl_atlas_free(p1, x3, y3);
+	ASSERT_TRUE(sdl_atlas[p1].tex == NULL);
+	ASSERT_EQ_INT(1, sdl_atlas_pages);
+
+	fprintf(stderr, "  ✓ Atlas cells are reused and empty pages freed\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_atlas_sprites_draw_in_batches)
+{
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing batched atlas blits...\n");
+
+	int idx[40], n = 0, on_atlas = 0, runs = 0;
+	SDL_Texture *last = NULL;
+
+	for (int i = 0; i < 40; i++) {
+		idx[n] = sdl_tx_load(
+		    get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 15, 15, 15, 15, 15, NULL, 0, 0, NULL, 0, 0);
+		if (idx[n] < 0 || !sdlt[idx[n]].tex) {
+			continue;
+		}
+		if (sdlt[idx[n]].atlas != ATLAS_NONE) {
+			ASSERT_TRUE(sdlt[idx[n]].xres * sdl_scale <= ATLAS_MAX_CELL);
+			on_atlas++;
+			if (sdlt[idx[n]].tex != last) {
+				runs++;
+			}
+			last = sdlt[idx[n]].tex;
+		} else {
+			ASSERT_TRUE(
+			    sdlt[idx[n]].xres * sdl_scale > ATLAS_MAX_CELL || sdlt[idx[n]].yres * sdl_scale > ATLAS_MAX_CELL);
+			last = NULL; // Drawn directly, so it ends the run before it
+		}
+		n++;
+	}
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	// Drawn one by one, every atlas sprite is a draw call of its own
+	sdl_test_reset_render_counters();
+	for (int i = 0; i < n; i++) {
+		sdl_blit_light(idx[i], 15, 15, 15, 15, 15, 0, 0, 0, 0, 800, 600, 0, 0);
+	}
+	ASSERT_EQ_INT(on_atlas, sdl_test_get_render_geometry_count());
+
+	// Batched, consecutive sprites on a page share one, lit or not. The
+	// last run is drawn by sdl_batch_end().
+	sdl_test_reset_render_counters();
+	sdl_batch_begin();
+	for (int i = 0; i < n; i++) {
+		sdl_blit_light(idx[i], 15, 15, 15, 15, 15, 0, 0, 0, 0, 800, 600, 0, 0);
+		sdl_blit_light(idx[i], 7, 7, 7, 7, 7, 0, 0, 0, 0, 800, 600, 0, 0);
+	}
+	ASSERT_EQ_INT(runs ? runs - 1 : 0, sdl_test_get_render_geometry_count());
+	sdl_batch_end();
+	ASSERT_EQ_INT(runs, sdl_test_get_render_geometry_count());
+
+	fprintf(stderr, "  ✓ %d of %d sprites on the atlas, drawn in %d batches\n", on_atlas, n, runs);
+
+	sdl_shutdown_for_tests();
+}
+
 // ============================================================================
 // Hash chain tests
 // ============================================================================
 
+#define DC_TEST_FILE "test_spritecache.dat"
+
+// Make the pixels of sprite into st, a stand-in for a cache entry
+static int dc_test_make(struct sdl_texture *st, unsigned int sprite)
+{
+	memset(st, 0, sizeof(*st));
+	st->sprite = sprite;
+	st->scale = 100;
+	st->ml = st->ll = st->rl = st->ul = st->dl = 15;
+	st->atlas = ATLAS_NONE;
+	st->alpha = 255;
+	__atomic_store_n((uint16_t *)&st->flags, SF_USED | SF_SPRITE, __ATOMIC_RELEASE);
+
+	return sdl_make_pixels(st);
+}
+
+static void dc_test_free(struct sdl_texture *st)
+{
+	FREE(st->pixel);
+	st->pixel = NULL;
+}
+
+TEST(test_disk_cache_roundtrip)
+{
+	ASSERT_TRUE(sdl_init_for_tests());
+	remove(DC_TEST_FILE);
+
+	fprintf(stderr, "  → Testing sprite disk cache...\n");
+
+	struct sdl_texture a, b;
+	unsigned int sprite = get_valid_sprite(3);
+	long long hits = dc_hits, stores = dc_stores;
+
+	ASSERT_TRUE(sdl_dc_init(DC_TEST_FILE, 4));
+
+	// Stored the second time it is made, not the first
+	ASSERT_EQ_INT(0, dc_test_make(&a, sprite));
+	ASSERT_EQ_INT(0, (int)(dc_stores - stores));
+	dc_test_free(&a);
+	ASSERT_EQ_INT(0, dc_test_make(&a, sprite));
+	ASSERT_EQ_INT(1, (int)(dc_stores - stores));
+
+	// The third time the pixels come from the cache, same as made
+	ASSERT_EQ_INT(0, dc_test_make(&b, sprite));
+	ASSERT_EQ_INT(1, (int)(dc_hits - hits));
+	ASSERT_TRUE(flags_load(&b) & SF_DIDMAKE);
+	ASSERT_EQ_INT(a.xres, b.xres);
+	ASSERT_EQ_INT(a.yres, b.yres);
+	ASSERT_EQ_INT(a.xoff, b.xoff);
+	ASSERT_EQ_INT(a.yoff, b.yoff);
+	size_t size = (size_t)a.xres * a.yres * sizeof(uint32_t) * (size_t)(sdl_scale * sdl_scale);
+	ASSERT_EQ_INT(0, memcmp(a.pixel, b.pixel, size));
+	dc_test_free(&b);
+
+	// Another sprite is not a hit
+	ASSERT_EQ_INT(0, dc_test_make(&b, get_valid_sprite(4)));
+	ASSERT_EQ_INT(1, (int)(dc_hits - hits));
+	dc_test_free(&b);
+
+	// And it is still there after a restart
+	sdl_dc_exit();
+	ASSERT_TRUE(sdl_dc_init(DC_TEST_FILE, 4));
+	ASSERT_EQ_INT(0, dc_test_make(&b, sprite));
+	ASSERT_EQ_INT(2, (int)(dc_hits - hits));
+	dc_test_free(&b);
+
+	// Unless the size changed, which starts over
+	sdl_dc_exit();
+	ASSERT_TRUE(sdl_dc_init(DC_TEST_FILE, 1));
+	ASSERT_EQ_INT(0, dc_test_make(&b, sprite));
+	ASSERT_EQ_INT(2, (int)(dc_hits - hits));
+	dc_test_free(&b);
+	ASSERT_EQ_INT(0, dc_test_make(&b, sprite));
+	dc_test_free(&b);
+
+	// Writing more than fits overwrites the oldest pixels
+	long long written = 0;
+	for (int i = 5; i < 5 + 2000 && written < 3 * 1024 * 1024; i++) {
+		for (int n = 0; n < 2; n++) {
+			stores = dc_stores;
+			if (dc_test_make(&b, get_valid_sprite(i)) == 0 && dc_stores != stores) {
+				written += (long long)b.xres * b.yres * (long long)sizeof(uint32_t) * sdl_scale * sdl_scale;
+			}
+			dc_test_free(&b);
+		}
+	}
+	ASSERT_TRUE(written >= 3 * 1024 * 1024);
+	hits = dc_hits;
+	ASSERT_EQ_INT(0, dc_test_make(&b, sprite));
+	ASSERT_EQ_INT(0, (int)(dc_hits - hits));
+	dc_test_free(&b);
+
+	dc_test_free(&a);
+	sdl_dc_exit();
+	remove(DC_TEST_FILE);
+
+	fprintf(stderr, "  ✓ Disk cache hits after admission, persists, and wraps\n");
+
+	sdl_shutdown_for_tests();
+}
+
+#define PACK_TEST_FILE "test_sprites.pak"
+
+TEST(test_sprite_pack_loads_raw_and_rle)
+{
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing sprite pack loading...\n");
+
+	// A 3x2 sprite stored raw and the same one run length encoded
+	uint32_t image[6] = {0, 0xff102030, 0xff405060, 0, 0, 0x80ffffff};
+	uint32_t rle[] = {1, 2, 0xff102030, 0xff405060, 2, 1, 0x80ffffff};
+	uint32_t broken[] = {0, 0};
+	struct sdl_pack_header ph;
+	struct sdl_pack_entry pe[3];
+
+	memset(&ph, 0, sizeof(ph));
+	memset(pe, 0, sizeof(pe));
+	ph.magic = PACK_MAGIC;
+	ph.version = PACK_VERSION;
+	ph.scale = 1;
+	ph.count = 3;
+	for (int i = 0; i < 3; i++) {
+		pe[i].sprite = 100 + (uint32_t)i * 10;
+		pe[i].xres = 3;
+		pe[i].yres = 2;
+		pe[i].xoff = -1;
+		pe[i].yoff = -2;
+	}
+	pe[0].offset = sizeof(ph) + sizeof(pe);
+	pe[0].size = sizeof(image);
+	pe[0].method = PACK_RAW;
+	pe[1].offset = pe[0].offset + pe[0].size;
+	pe[1].size = sizeof(rle);
+	pe[1].method = PACK_RLE;
+	pe[2].offset = pe[1].offset + pe[1].size;
+	pe[2].size = sizeof(broken);
+	pe[2].method = PACK_RLE;
+
+	FILE *fp = fopen(PACK_TEST_FILE, "wb");
+	ASSERT_PTR_NOT_NULL(fp);
+	fwrite(&ph, sizeof(ph), 1, fp);
+	fwrite(pe, sizeof(pe), 1, fp);
+	fwrite(image, sizeof(image), 1, fp);
+	fwrite(rle, sizeof(rle), 1, fp);
+	fwrite(broken, sizeof(broken), 1, fp);
+	fclose(fp);
+
+	ASSERT_TRUE(sdl_pack_open(0, PACK_TEST_FILE));
+	ASSERT_TRUE(sdl_pack_available(0));
+	ASSERT_FALSE(sdl_pack_available(1));
+
+	for (int i = 0; i < 2; i++) {
+		struct sdl_image si;
+		memset(&si, 0, sizeof(si));
+		ASSERT_EQ_INT(0, sdl_pack_load(&si, pe[i].sprite, 0, 0));
+		ASSERT_EQ_INT(3, si.xres);
+		ASSERT_EQ_INT(2, si.yres);
+		ASSERT_EQ_INT(-1, si.xoff);
+		ASSERT_EQ_INT(-2, si.yoff);
+		for (int y = 0; y < 2 * sdl_scale; y++) {
+			for (int x = 0; x < 3 * sdl_scale; x++) {
+				ASSERT_TRUE(si.pixel[x + y * 3 * sdl_scale] == image[x / sdl_scale + y / sdl_scale * 3]);
+			}
+		}
+		FREE(si.pixel);
+	}
+
+	// Sprites not in the pack and damaged entries are not loaded
+	struct sdl_image si;
+	ASSERT_EQ_INT(-1, sdl_pack_load(&si, 105, 0, 0));
+	ASSERT_EQ_INT(-1, sdl_pack_load(&si, pe[2].sprite, 0, 0));
+
+	sdl_pack_exit();
+	ASSERT_FALSE(sdl_pack_available(0));
+
+	// A pack for another scale is refused
+	ph.scale = 2;
+	fp = fopen(PACK_TEST_FILE, "r+b");
+	ASSERT_PTR_NOT_NULL(fp);
+	fwrite(&ph, sizeof(ph), 1, fp);
+	fclose(fp);
+	ASSERT_FALSE(sdl_pack_open(0, PACK_TEST_FILE));
+	remove(PACK_TEST_FILE);
+
+	fprintf(stderr, "  ✓ Sprite pack entries load raw and run length encoded\n");
+
+	sdl_shutdown_for_tests();
+}
+
+#define ARCHIVE_TEST_FILE "test_archive.zip"
+
+TEST(test_shared_archive_reads_stored_and_deflated)
+{
+	fprintf(stderr, "  → Testing shared archive reads...\n");
+
+	static char text[20000];
+	static const char *name[2] = {"00000001.png", "00000002.png"};
+	struct sdl_archive arch;
+	zip_t *zip;
+
+	for (int i = 0; i < (int)sizeof(text); i++) {
+		text[i] = (char)('a' + i % 7 + i / 1000);
+	}
+
+	// One entry stored, one deflated, as zip tools write them
+	zip = zip_open(ARCHIVE_TEST_FILE, ZIP_CREATE | ZIP_TRUNCATE, NULL);
+	ASSERT_PTR_NOT_NULL(zip);
+	for (int i = 0; i < 2; i++) {
+		zip_source_t *src = zip_source_buffer(zip, text, sizeof(text), 0);
+		ASSERT_PTR_NOT_NULL(src);
+		zip_int64_t idx = zip_file_add(zip, name[i], src, ZIP_FL_OVERWRITE);
+		ASSERT_TRUE(idx >= 0);
+		zip_set_file_compression(zip, (zip_uint64_t)idx, i ? ZIP_CM_DEFLATE : ZIP_CM_STORE, 0);
+	}
+	ASSERT_EQ_INT(0, zip_close(zip));
+
+	ASSERT_TRUE(sdl_archive_open(&arch, ARCHIVE_TEST_FILE));
+	ASSERT_EQ_INT(2, (int)arch.count);
+
+	for (int i = 0; i < 2; i++) {
+		struct sdl_archive_file f;
+		int64_t idx = sdl_archive_find(&arch, name[i]);
+		int len;
+
+		ASSERT_TRUE(idx >= 0);
+		ASSERT_TRUE(memcmp(sdl_archive_name(&arch, (uint32_t)idx, &len), name[i], 12) == 0);
+		ASSERT_EQ_INT(12, len);
+		ASSERT_EQ_INT(0, sdl_archive_read(&arch, (uint32_t)idx, &f));
+		ASSERT_TRUE(f.size == sizeof(text));
+		ASSERT_TRUE(memcmp(f.data, text, sizeof(text)) == 0);
+		// Stored entries come straight from the mapping
+		ASSERT_TRUE((f.buf == NULL) == (arch.entry[idx].method == 0));
+		sdl_archive_release(&f);
+	}
+	ASSERT_TRUE(sdl_archive_find(&arch, "00000003.png") < 0);
+
+	sdl_archive_close(&arch);
+	remove(ARCHIVE_TEST_FILE);
+
+	// Not an archive
+	FILE *fp = fopen(ARCHIVE_TEST_FILE, "wb");
+	ASSERT_PTR_NOT_NULL(fp);
+	fwrite(text, 100, 1, fp);
+	fclose(fp);
+	ASSERT_FALSE(sdl_archive_open(&arch, ARCHIVE_TEST_FILE));
+	remove(ARCHIVE_TEST_FILE);
+
+	fprintf(stderr, "  ✓ Shared archive reads stored and deflated entries\n");
+}
+
 TEST(test_hash_chains_no_corruption_after_insertions)
 {
 	ASSERT_TRUE(sdl_init_for_tests());
@@ -376,6 +772,183 @@ TEST(test_full_cache_stress)
 	sdl_shutdown_for_tests();
 }
 
+TEST(test_cache_grows_and_trims_to_budget)
+{
+	int saved_size = sdl_cache_size;
+	int saved_budget = sdl_cache_budget;
+
+	// Start with the smallest table and no budget pressure
+	sdl_cache_size = MIN_TEXCACHE;
+	sdl_cache_budget = 0;
+	ASSERT_TRUE(sdl_init_for_tests());
+	ASSERT_EQ_INT(MIN_TEXCACHE, sdlt_slots);
+
+	fprintf(stderr, "  → Testing byte-budgeted slot table growth and trimming...\n");
+
+	// Filling past the initial table grows it instead of evicting
+	unsigned int first_sprite = get_valid_sprite(0);
+	int first = sdl_tx_load(first_sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0);
+	ASSERT_IN_RANGE(first, 0, MAX_TEXCACHE - 1);
+
+	for (int i = 1; i < MIN_TEXCACHE + 500; i++) {
+		int scale = 1 + (i % 3);
+		int idx = sdl_tx_load(get_valid_sprite(i), 0, 0, (unsigned char)scale, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		    0, NULL, 0, 0, NULL, 0, 0);
+		ASSERT_IN_RANGE(idx, 0, MAX_TEXCACHE - 1);
+	}
+	ASSERT_TRUE(sdlt_slots > MIN_TEXCACHE);
+	ASSERT_EQ_INT(first_sprite, sdl_texture_get_sprite_for_test(first));
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	// Two frames later only the first sprite is drawn again
+	sdl_frames += 2;
+	ASSERT_EQ_INT(
+	    first, sdl_tx_load(first_sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0));
+
+	// Pretend the textures outgrew a 1 MB budget (tests have no renderer,
+	// so nothing is really uploaded)
+	sdl_cache_budget = 1;
+	mem_tex = 2 * 1024 * 1024;
+	for (int i = 0; i < 100; i++) {
+		sdl_tx_trim();
+	}
+
+	// The table shrank back, everything old is gone, the drawn sprite stayed
+	ASSERT_EQ_INT(MIN_TEXCACHE, sdlt_slots);
+	ASSERT_TRUE(sdl_texture_get_flags_for_test(first) & SF_USED);
+	ASSERT_EQ_INT(first_sprite, sdl_texture_get_sprite_for_test(first));
+
+	int used = 0;
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		if (sdl_texture_get_flags_for_test(i) & SF_USED) {
+			used++;
+		}
+	}
+	ASSERT_EQ_INT(1, used);
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	mem_tex = 0;
+	sdl_cache_size = saved_size;
+	sdl_cache_budget = saved_budget;
+
+	fprintf(stderr, "  ✓ Cache grows under budget and trims LRU entries over budget\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_prefetch_scan_keeps_protected_entries)
+{
+	int saved_size = sdl_cache_size;
+	int saved_budget = sdl_cache_budget;
+	const int hot = 100;
+
+	// A full table that may not grow: every miss has to evict
+	sdl_cache_size = MIN_TEXCACHE;
+	sdl_cache_budget = 1;
+	ASSERT_TRUE(sdl_init_for_tests());
+	mem_tex = 2 * 1024 * 1024;
+	memset(texc_hits, 0, sizeof(texc_hits));
+	memset(texc_evicts, 0, sizeof(texc_evicts));
+
+	fprintf(stderr, "  → Testing that a prefetch scan doesn't evict repeatedly drawn entries...\n");
+
+	// Draw a working set twice: the second draw moves it to the protected list
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < hot; i++) {
+			int idx = sdl_tx_load(
+			    get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0);
+			ASSERT_IN_RANGE(idx, 0, MAX_TEXCACHE - 1);
+			ASSERT_EQ_INT(pass ? TX_LRU_PROTECTED : TX_LRU_PROBATION, sdlt[idx].lru);
+		}
+	}
+	ASSERT_EQ_INT(hot, (int)texc_hits[TX_LRU_PROBATION]);
+	ASSERT_EQ_INT(hot, sdlt_lru[TX_LRU_PROTECTED].count);
+
+	// Prefetch three times as many other entries as the table holds
+	for (int i = 0; i < 3 * MIN_TEXCACHE; i++) {
+		(void)sdl_tx_load(
+		    get_valid_sprite(hot + i), 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 1);
+	}
+	ASSERT_EQ_INT(MIN_TEXCACHE, sdlt_slots);
+	ASSERT_TRUE(texc_evicts[TX_LRU_PROBATION] > 0);
+	ASSERT_EQ_INT(0, (int)texc_evicts[TX_LRU_PROTECTED]);
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	// The working set is still cached
+	for (int i = 0; i < hot; i++) {
+		ASSERT_EQ_INT(1, sdl_tx_load(get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0,
+		                     0, NULL, 1, 0));
+	}
+
+	mem_tex = 0;
+	sdl_cache_size = saved_size;
+	sdl_cache_budget = saved_budget;
+
+	fprintf(stderr, "  ✓ Prefetched entries stay on probation and are evicted first\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_images_trim_to_budget)
+{
+	int saved_budget = sdl_image_budget;
+
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing eviction and reload of decoded images...\n");
+
+	unsigned int pinned = get_valid_sprite(0);
+	unsigned int other = get_valid_sprite(1);
+	ASSERT_TRUE(sdl_ic_get(other) != NULL);
+	sdl_ic_put(other);
+	uint16_t xres = sdli[other].xres, yres = sdli[other].yres;
+
+	// A worker holds one image while everything goes out of date
+	struct sdl_image *si = sdl_ic_get(pinned);
+	ASSERT_PTR_NOT_NULL(si);
+	sdl_frames += 2;
+
+	// Pretend the images outgrew a 1 MB budget
+	sdl_image_budget = 1;
+	mem_png = 1LL << 40;
+	for (int i = 0; i < MAXSPRITE / 64 + 1; i++) {
+		sdl_ic_trim();
+	}
+
+	// The pinned image stayed, the other one is gone but keeps its size
+	ASSERT_EQ_INT(IMG_READY, sdli_state[pinned]);
+	ASSERT_PTR_NOT_NULL(si->pixel);
+	ASSERT_EQ_INT(IMG_UNLOADED, sdli_state[other]);
+	ASSERT_TRUE(sdli[other].pixel == NULL);
+	ASSERT_EQ_INT(xres, sdli[other].xres);
+	ASSERT_TRUE(mem_png < 1LL << 40);
+	sdl_ic_put(pinned);
+
+	// Getting it again reloads it
+	mem_png = 0;
+	si = sdl_ic_get(other);
+	ASSERT_PTR_NOT_NULL(si);
+	ASSERT_EQ_INT(IMG_READY, sdli_state[other]);
+	ASSERT_PTR_NOT_NULL(si->pixel);
+	ASSERT_EQ_INT(xres, si->xres);
+	ASSERT_EQ_INT(yres, si->yres);
+	ASSERT_EQ_INT((int)si->mem, (int)mem_png);
+	sdl_ic_put(other);
+
+	// And textures are made from evicted images as before
+	int idx = sdl_tx_load(
+	    get_valid_sprite(2), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0);
+	ASSERT_IN_RANGE(idx, 0, MAX_TEXCACHE - 1);
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	mem_png = 0;
+	sdl_image_budget = saved_budget;
+
+	fprintf(stderr, "  ✓ Unpinned images are evicted over budget and reload on demand\n");
+
+	sdl_shutdown_for_tests();
+}
+
 // ============================================================================
 // Cache deduplication test
 // ============================================================================
@@ -449,9 +1022,7 @@ TEST(test_eviction_refuses_in_flight_jobs)
 	ASSERT_IN_RANGE(idx, 0, MAX_TEXCACHE - 1);
 
 	// Simulate a worker taking the job (set work_state to IN_WORKER)
-	SDL_LockMutex(g_tex_jobs.mutex);
-	sdlt[idx].work_state = TX_WORK_IN_WORKER;
-	SDL_UnlockMutex(g_tex_jobs.mutex);
+	work_state_store(&sdlt[idx], TX_WORK_IN_WORKER);
 
 	// Now try to evict this entry by loading many other sprites
 	// The eviction logic should skip this entry because work_state != IDLE
@@ -465,9 +1036,7 @@ TEST(test_eviction_refuses_in_flight_jobs)
 	ASSERT_EQ_INT(TX_WORK_IN_WORKER, sdlt[idx].work_state);
 
 	// Clean up
-	SDL_LockMutex(g_tex_jobs.mutex);
-	sdlt[idx].work_state = TX_WORK_IDLE;
-	SDL_UnlockMutex(g_tex_jobs.mutex);
+	work_state_store(&sdlt[idx], TX_WORK_IDLE);
 
 	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
 
@@ -504,6 +1073,127 @@ TEST(test_generation_invalidates_stale_jobs)
 	sdl_shutdown_for_tests();
 }
 
+// Find the cache slot holding a sprite (default fx), or STX_NONE
+static int find_sprite_slot(unsigned int sprite)
+{
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		if ((sdl_texture_get_flags_for_test(i) & SF_SPRITE) && sdl_texture_get_sprite_for_test(i) == (int)sprite) {
+			return i;
+		}
+	}
+	return STX_NONE;
+}
+
+TEST(test_promotion_jumps_queue)
+{
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing render-critical promotion of queued prefetch jobs...\n");
+
+	// Queue jobs without any workers running so the order can be inspected
+	sdl_multi = 1;
+
+	unsigned int first = get_valid_sprite(0);
+	unsigned int last = get_valid_sprite(2);
+	sdl_pre_add(first, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
+	sdl_pre_add(get_valid_sprite(1), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_NEXT_TICK);
+	sdl_pre_add(last, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
+	ASSERT_EQ_INT(3, sdl_get_job_queue_depth_for_test());
+
+	int idx = find_sprite_slot(last);
+	ASSERT_IN_RANGE(idx, 0, MAX_TEXCACHE - 1);
+	ASSERT_EQ_INT(TX_WORK_QUEUED, sdl_texture_get_work_state_for_test(idx));
+
+	// Render path needs the last one: it must come out first
+	sdl_pre_promote(idx);
+	ASSERT_EQ_INT(4, sdl_get_job_queue_depth_for_test());
+
+	// Promoting again is a no-op
+	sdl_pre_promote(idx);
+	ASSERT_EQ_INT(4, sdl_get_job_queue_depth_for_test());
+
+	texture_job_t job;
+	ASSERT_TRUE(tex_jobs_take(0, &job, 1));
+	ASSERT_EQ_INT(idx, job.cache_index);
+
+	// Then "next tick" before "speculative"
+	ASSERT_TRUE(tex_jobs_take(0, &job, 1));
+	ASSERT_EQ_INT(find_sprite_slot(get_valid_sprite(1)), job.cache_index);
+	ASSERT_TRUE(tex_jobs_take(0, &job, 1));
+	ASSERT_EQ_INT(find_sprite_slot(first), job.cache_index);
+
+	// The stale low-priority copy is still queued; workers skip it by work_state
+	ASSERT_TRUE(tex_jobs_take(0, &job, 1));
+	ASSERT_EQ_INT(idx, job.cache_index);
+	ASSERT_FALSE(tex_jobs_take(0, &job, 1));
+
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	// Nothing runs these jobs - put the slots back to idle before teardown
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		sdlt[i].work_state = TX_WORK_IDLE;
+	}
+	sdl_multi = 0;
+
+	fprintf(stderr, "  ✓ Promoted job is popped before queued prefetches\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_job_batches_and_stealing)
+{
+	texture_job_t jobs[TEX_JOB_BATCH];
+
+	ASSERT_TRUE(sdl_init_for_tests());
+
+	fprintf(stderr, "  → Testing batched job takes and work stealing...\n");
+
+	// Two worker queues, nobody running them
+	sdl_multi = 2;
+
+	// Round-robin: queue 0 and queue 1 get two jobs each
+	for (int i = 0; i < 4; i++) {
+		sdl_pre_add(get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
+	}
+	ASSERT_EQ_INT(4, sdl_get_job_queue_depth_for_test());
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	// Worker 0 empties its own queue in one batch
+	ASSERT_EQ_INT(2, tex_jobs_take(0, jobs, TEX_JOB_BATCH));
+	ASSERT_EQ_INT(find_sprite_slot(get_valid_sprite(0)), jobs[0].cache_index);
+	ASSERT_EQ_INT(find_sprite_slot(get_valid_sprite(2)), jobs[1].cache_index);
+
+	// Then steals half of worker 1's queue, oldest first
+	ASSERT_EQ_INT(1, tex_jobs_take(0, jobs, TEX_JOB_BATCH));
+	ASSERT_EQ_INT(find_sprite_slot(get_valid_sprite(1)), jobs[0].cache_index);
+
+	// Render-critical jobs are handed out one at a time, ahead of the rest
+	int idx = find_sprite_slot(get_valid_sprite(0));
+	work_state_store(&sdlt[idx], TX_WORK_IDLE);
+	sdl_pre_promote(idx);
+	ASSERT_EQ_INT(1, tex_jobs_urgent());
+	ASSERT_EQ_INT(1, tex_jobs_take(1, jobs, TEX_JOB_BATCH));
+	ASSERT_EQ_INT(idx, jobs[0].cache_index);
+	ASSERT_EQ_INT(0, tex_jobs_urgent());
+
+	ASSERT_EQ_INT(1, tex_jobs_take(1, jobs, TEX_JOB_BATCH));
+	ASSERT_EQ_INT(find_sprite_slot(get_valid_sprite(3)), jobs[0].cache_index);
+	ASSERT_EQ_INT(0, tex_jobs_take(1, jobs, TEX_JOB_BATCH));
+	ASSERT_EQ_INT(0, sdl_get_job_queue_depth_for_test());
+
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	// Nothing runs these jobs - put the slots back to idle before teardown
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		sdlt[i].work_state = TX_WORK_IDLE;
+	}
+	sdl_multi = 0;
+
+	fprintf(stderr, "  ✓ Jobs are taken in batches and stolen across queues\n");
+
+	sdl_shutdown_for_tests();
+}
+
 // ============================================================================
 // Fuzz test - random operations
 // ============================================================================
@@ -545,7 +1235,7 @@ TEST(test_fuzz_random_cache_operations)
 			// Random preload with valid sprite ID
 			int sprite_idx = test_rng_range(0, num_valid_sprites - 1);
 			unsigned int sprite = get_valid_sprite(sprite_idx);
-			sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+			sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
 			break;
 		}
 		case 2: {
@@ -578,6 +1268,12 @@ TEST_MAIN(
     test_basic_insert_and_lookup();
     test_different_sprites_different_slots();
     test_different_parameters_different_slots();
+    test_light_variants_share_unlit_texture();
+    test_atlas_cells_are_reused();
+    test_atlas_sprites_draw_in_batches();
+    test_disk_cache_roundtrip();
+    test_sprite_pack_loads_raw_and_rle();
+    test_shared_archive_reads_stored_and_deflated();
     test_cache_deduplication();
 
     fprintf(stderr, "\n=== Hash Chain Tests ===\n");
@@ -590,9 +1286,14 @@ TEST_MAIN(
     fprintf(stderr, "\n=== Concurrency Edge Cases (Sequential Simulation) ===\n");
     test_eviction_refuses_in_flight_jobs();
     test_generation_invalidates_stale_jobs();
+    test_promotion_jumps_queue();
+    test_job_batches_and_stealing();
 
     fprintf(stderr, "\n=== Full Cache Stress Test ===\n");
     test_full_cache_stress();
+    test_cache_grows_and_trims_to_budget();
+    test_prefetch_scan_keeps_protected_entries();
+    test_images_trim_to_budget();
 
     fprintf(stderr, "\n=== Fuzz Tests ===\n");
     test_fuzz_random_cache_operations();
@@ -7,6 +7,7 @@
 
 #include "../src/astonia.h"  // Must come first for tick_t and other typedefs
 #include "../src/sdl/sdl_private.h"
+#include "../src/sdl/sdl.h"
 #include "test.h"
 
 #include <string.h>
@@ -80,7 +81,7 @@ static void enumerate_valid_sprites(void)
 
 			// Step 2: Try to actually load it with sdl_ic_load
 			// This validates the PNG can be decoded and has valid dimensions
-			if (sdl_ic_load(sprite_num, NULL) < 0) {
+			if (sdl_ic_load(sprite_num) < 0) {
 				filtered_load_failed++;
 				continue;
 			}
@@ -139,7 +140,7 @@ TEST(test_single_thread_pipeline)
 	ASSERT_TRUE(flags & SF_DIDALLOC);
 
 	// Now simulate a prefetch of same sprite
-	sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
 
 	// Pump pipeline
 	for (int i = 0; i < 100; i++) {
@@ -183,7 +184,7 @@ TEST(test_workers_process_jobs)
 		ASSERT_IN_RANGE(cache_indices[i], 0, MAX_TEXCACHE - 1);
 
 		// Queue prefetch for this sprite (workers will process)
-		sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
 	}
 
 	// Pump pipeline with workers running
@@ -233,7 +234,7 @@ TEST(test_workers_saturate_cache)
 		if (idx != STX_NONE) {
 			loaded++;
 			// Queue prefetch for background processing
-			sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+			sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
 		}
 		
 		// Progress indicator
@@ -283,6 +284,121 @@ TEST(test_workers_saturate_cache)
 	sdl_shutdown_for_tests();
 }
 
+// Prefetch a burst, then draw every sprite right away so the render thread
+// has to wait on (or help with) jobs that are still queued or running
+static void render_waits_on_prefetch_burst(int count)
+{
+	for (int i = 0; i < count; i++) {
+		sdl_pre_add(get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
+	}
+
+	for (int i = count - 1; i >= 0; i--) {
+		int idx =
+		    sdl_tx_load(get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0);
+		ASSERT_IN_RANGE(idx, 0, MAX_TEXCACHE - 1);
+
+		uint16_t flags = sdl_texture_get_flags_for_test(idx);
+		ASSERT_TRUE(flags & SF_DIDMAKE);
+		ASSERT_TRUE(flags & SF_DIDTEX);
+	}
+}
+
+TEST(test_render_waits_for_workers)
+{
+	ASSERT_TRUE(sdl_init_for_tests_with_workers(4));
+	enumerate_valid_sprites();
+
+	fprintf(stderr, "  → Testing render thread blocking on queued prefetches...\n");
+
+	Uint64 start = SDL_GetTicks();
+	render_waits_on_prefetch_burst(2000);
+	fprintf(stderr, "  → 2000 sprites drawn in %llu ms\n", (unsigned long long)(SDL_GetTicks() - start));
+
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	fprintf(stderr, "  ✓ Render thread woke up for every awaited sprite\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_render_helps_out)
+{
+	ASSERT_TRUE(sdl_init_for_tests_with_workers(2));
+	enumerate_valid_sprites();
+
+	fprintf(stderr, "  → Testing render thread stealing queued jobs (GO_HELPOUT)...\n");
+
+	game_options |= GO_HELPOUT;
+
+	Uint64 start = SDL_GetTicks();
+	render_waits_on_prefetch_burst(2000);
+	fprintf(stderr, "  → 2000 sprites drawn in %llu ms\n", (unsigned long long)(SDL_GetTicks() - start));
+
+	// Let workers skip the stale copies of stolen jobs
+	for (int tick = 0; tick < 200 && sdl_get_job_queue_depth_for_test() > 0; tick++) {
+		sdl_pre_tick_for_tests();
+		SDL_Delay(1);
+	}
+	ASSERT_EQ_INT(0, sdl_get_job_queue_depth_for_test());
+
+	game_options &= ~GO_HELPOUT;
+
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	fprintf(stderr, "  ✓ Render thread made stolen sprites itself\n");
+
+	sdl_shutdown_for_tests();
+}
+
+TEST(test_workers_ready_queue_uploads)
+{
+	ASSERT_TRUE(sdl_init_for_tests_with_workers(4));
+	enumerate_valid_sprites();
+
+	fprintf(stderr, "  → Testing prefetch-only sprites reach the GPU via the ready queue...\n");
+
+	// Prefetch only - nothing is drawn, so stage 3 must come from sdl_pre_do()
+	for (int i = 0; i < 500; i++) {
+		sdl_pre_add(get_valid_sprite(i), 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
+	}
+
+	for (int tick = 0; tick < 2000; tick++) {
+		sdl_pre_tick_for_tests();
+		SDL_Delay(1);
+
+		if (sdl_get_job_queue_depth_for_test() == 0 && sdl_get_ready_queue_depth_for_test() == 0 && tick > 100) {
+			break;
+		}
+	}
+
+	// Drain whatever the workers finished after the last tick
+	for (int tick = 0; tick < 100; tick++) {
+		sdl_pre_tick_for_tests();
+	}
+
+	int made = 0, pending = 0;
+	for (int i = 0; i < MAX_TEXCACHE; i++) {
+		uint16_t flags = sdl_texture_get_flags_for_test(i);
+		if (!(flags & SF_SPRITE) || !(flags & SF_DIDMAKE)) {
+			continue;
+		}
+		made++;
+		if (!(flags & SF_DIDTEX)) {
+			pending++;
+		}
+	}
+
+	fprintf(stderr, "  → %d sprites made, %d still waiting for upload\n", made, pending);
+	ASSERT_TRUE(made > 0);
+	ASSERT_EQ_INT(0, pending);
+	ASSERT_EQ_INT(0, sdl_get_ready_queue_depth_for_test());
+	ASSERT_EQ_INT(0, sdl_check_invariants_for_tests());
+
+	fprintf(stderr, "  ✓ Ready queue uploaded all finished prefetches\n");
+
+	sdl_shutdown_for_tests();
+}
+
 // ============================================================================
 // Concurrency edge cases (eviction during worker processing)
 // ============================================================================
@@ -300,7 +416,7 @@ TEST(test_workers_with_eviction)
 	for (int i = 0; i < num_sprites && i < num_valid_sprites; i++) {
 		unsigned int sprite = get_valid_sprite(i);
 		sdl_tx_load(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0, 0);
-		sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		sdl_pre_add(sprite, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
 		
 		// Progress
 		if ((i % 5000) == 0 && i > 0) {
@@ -388,7 +504,7 @@ TEST(test_worker_fuzz)
 			int cg = test_rng_range(0, 255);
 		int cb = test_rng_range(0, 255);
 
-		sdl_pre_add(sprite, 0, 0, scale, cr, cg, cb, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		sdl_pre_add(sprite, 0, 0, scale, cr, cg, cb, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, SDL_PRE_SPECULATIVE);
 		break;
 		}
 	case 2: { // Pipeline tick
@@ -428,6 +544,9 @@ TEST_MAIN(
     fprintf(stderr, "\n=== Multi-Threaded Worker Tests ===\n");
     test_workers_process_jobs();
     test_workers_saturate_cache();
+    test_workers_ready_queue_uploads();
+    test_render_waits_for_workers();
+    test_render_helps_out();
 
     fprintf(stderr, "\n=== Concurrency Edge Cases ===\n");
     test_workers_with_eviction();